@@ -0,0 +1,18 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+// Process-wide heap allocation counter used by the benchmark modes.
+// Counting replaces the allocator, so it is only built in with the
+// COUNT_ALLOCATIONS CMake option. On glibc every malloc/calloc/realloc is
+// counted (Qt containers allocate through malloc directly); elsewhere
+// only the operator new family is seen.
+class AllocationCounter
+{
+public:
+    static bool isEnabled();
+    static quint64 count();
+};
+
+#endif // ALLOCCOUNTER_H
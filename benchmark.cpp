@@ -0,0 +1,1056 @@
+#include "benchmark.h"
+#include "alloccounter.h"
+#include "colorswatch.h"
+#include "dockmanager.h"
+#include "docksizesolver.h"
+#include "floatingoverlay.h"
+#include "framescheduler.h"
+#include "layoutwriter.h"
+#include "liveresize.h"
+#include "logview.h"
+#include "mainwindow.h"
+#include "textsearch.h"
+#include "themestyle.h"
+#include "widgetstate.h"
+#include "pixmapatlas.h"
+#include <QApplication>
+#include <QBuffer>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QMainWindow>
+#include <QPushButton>
+#include <QSet>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include <QTextEdit>
+#include <QTabBar>
+#include <QTimer>
+#include <QToolBar>
+#include <QTextStream>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+static const QSize kPaintSizes[] = {
+    QSize(160, 120),
+    QSize(640, 480),
+    QSize(1920, 1080)
+};
+
+static const qreal kPaintRatios[] = { 1.0, 2.0 };
+
+qint64 Benchmark::percentile(QVector<qint64> sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    std::sort(sorted.begin(), sorted.end());
+    int index = int(std::ceil(p / 100.0 * sorted.size())) - 1;
+    return sorted.at(qBound(0, index, int(sorted.size()) - 1));
+}
+
+static QString sizeLabel(const QSize &size, qreal dpr)
+{
+    return QString("%1x%2@%3x").arg(size.width()).arg(size.height()).arg(dpr);
+}
+
+static QImage frameImage(const QSize &size, qreal dpr)
+{
+    QImage image(size * dpr, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+    return image;
+}
+
+// Paint cost of the dock content, the custom title bar and a full window grab
+static void paintSuite(Benchmark &benchmark)
+{
+    QMainWindow host;
+    ColorSwatch swatch("Blue", &host);
+    host.addDockWidget(Qt::LeftDockWidgetArea, &swatch);
+    ColorDock *dock = qobject_cast<ColorDock*>(swatch.widget());
+
+    BlueTitleBar *titleBar = new BlueTitleBar(&swatch);
+    swatch.setTitleBarWidget(titleBar);
+
+    for (const QSize &size : kPaintSizes) {
+        for (qreal dpr : kPaintRatios) {
+            QImage image = frameImage(size, dpr);
+            dock->resize(size);
+            benchmark.measure(QString("ColorDock::paintEvent %1").arg(sizeLabel(size, dpr)), [&]() {
+                dock->render(&image);
+            });
+        }
+    }
+
+    // A tooltip-sized expose against a full repaint of the same swatch
+    {
+        const QSize size(640, 480);
+        const QRegion exposed(QRect(200, 150, 64, 48));
+        QImage image = frameImage(size, 1.0);
+        dock->resize(size);
+
+        ColorDock::resetPaintedArea();
+        benchmark.measure("ColorDock full expose 640x480", [&]() {
+            dock->render(&image);
+        });
+        benchmark.note("ColorDock full expose painted area",
+                       QString("%1 px/paint").arg(ColorDock::totalPaintedArea() / qMax<quint64>(1, ColorDock::totalPaintCount())));
+
+        ColorDock::resetPaintedArea();
+        benchmark.measure("ColorDock partial expose 64x48 in 640x480", [&]() {
+            dock->render(&image, QPoint(), exposed);
+        });
+        benchmark.note("ColorDock partial expose painted area",
+                       QString("%1 px/paint").arg(ColorDock::totalPaintedArea() / qMax<quint64>(1, ColorDock::totalPaintCount())));
+    }
+
+    for (const QSize &size : kPaintSizes) {
+        for (qreal dpr : kPaintRatios) {
+            const QSize barSize(size.width(), titleBar->sizeHint().height());
+            QImage image = frameImage(barSize, dpr);
+            titleBar->resize(barSize);
+            benchmark.measure(QString("BlueTitleBar::paintEvent %1").arg(sizeLabel(barSize, dpr)), [&]() {
+                titleBar->render(&image);
+            });
+        }
+    }
+
+    // Title bars share decoded pixmaps, so construction cost stays flat
+    const int decodesBefore = PixmapAtlas::decodeCount();
+    benchmark.measure("BlueTitleBar construction x100", qMax(1, benchmark.frames() / 10), [&]() {
+        QWidget parent;
+        for (int i = 0; i < 100; ++i)
+            new BlueTitleBar(&parent);
+    });
+    benchmark.note("BlueTitleBar PNG decodes",
+                   QString::number(PixmapAtlas::decodeCount() - decodesBefore));
+
+    MainWindow window;
+    window.show();
+    for (const QSize &size : kPaintSizes) {
+        window.resize(size);
+        QCoreApplication::processEvents();
+        for (qreal dpr : kPaintRatios) {
+            QImage image = frameImage(window.size(), dpr);
+            benchmark.measure(QString("MainWindow grab %1").arg(sizeLabel(window.size(), dpr)), [&]() {
+                window.render(&image);
+            });
+        }
+    }
+}
+
+// The layout toolbar as it was styled before ThemeStyle, kept for comparison
+static const char *const kLegacyToolBarStyle =
+    "QToolBar {"
+    "   background: #f0f0f0;"
+    "   border-top: 1px solid #ccc;"
+    "   border-bottom: 1px solid #ccc;"
+    "   spacing: 5px;"
+    "   padding: 3px;"
+    "}"
+    "QToolButton {"
+    "   padding: 5px;"
+    "   margin: 2px;"
+    "}";
+
+static const char *const kLegacyButtonStyle =
+    "QPushButton {"
+    "   padding: 6px;"
+    "   margin: 2px;"
+    "   min-width: 80px;"
+    "   background: #e0e0e0;"
+    "   border: 1px solid #aaa;"
+    "   border-radius: 3px;"
+    "}"
+    "QPushButton:hover {"
+    "   background: #d0d0d0;"
+    "}"
+    "QPushButton:pressed {"
+    "   background: #c0c0c0;"
+    "}";
+
+static QToolBar *createLayoutToolBar(bool styleSheets)
+{
+    QToolBar *toolBar = new QToolBar;
+    if (styleSheets)
+        toolBar->setStyleSheet(kLegacyToolBarStyle);
+    else
+        ThemeStyle::apply(toolBar, ThemeStyle::LayoutToolBar);
+
+    for (int i = 0; i < 7; ++i) {
+        QPushButton *button = new QPushButton(QString("Layout %1").arg(i + 1), toolBar);
+        if (styleSheets)
+            button->setStyleSheet(kLegacyButtonStyle);
+        else
+            ThemeStyle::apply(button, ThemeStyle::ToolBarButton);
+        toolBar->addWidget(button);
+    }
+    toolBar->adjustSize();
+    return toolBar;
+}
+
+static void setHovered(QWidget *widget, bool hovered)
+{
+    widget->setAttribute(Qt::WA_UnderMouse, hovered);
+    QEvent event(hovered ? QEvent::HoverEnter : QEvent::HoverLeave);
+    QCoreApplication::sendEvent(widget, &event);
+}
+
+// Style-sheet toolbar against the ThemeStyle one: build cost and hover repaints
+static void themeSuite(Benchmark &benchmark)
+{
+    const int buildFrames = qMax(1, benchmark.frames() / 4);
+    for (bool styleSheets : { true, false }) {
+        const QString variant = styleSheets ? "style sheet" : "ThemeStyle";
+
+        benchmark.measure(QString("toolbar startup (%1)").arg(variant), buildFrames, [&]() {
+            QToolBar *toolBar = createLayoutToolBar(styleSheets);
+            QImage image = frameImage(toolBar->size(), 1.0);
+            toolBar->render(&image);
+            delete toolBar;
+        });
+
+        QToolBar *toolBar = createLayoutToolBar(styleSheets);
+        QPushButton *button = toolBar->findChild<QPushButton*>();
+        QImage image = frameImage(button->size(), 1.0);
+        button->render(&image);
+        benchmark.measure(QString("button hover repaint (%1)").arg(variant), [&]() {
+            setHovered(button, true);
+            button->render(&image);
+            setHovered(button, false);
+            button->render(&image);
+        });
+        delete toolBar;
+    }
+}
+
+// N docks spread over the four areas, a few side by side per row
+static QList<QDockWidget*> populateDocks(QMainWindow *host, int count)
+{
+    static const Qt::DockWidgetArea areas[] = {
+        Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+    };
+    QList<QDockWidget*> docks;
+    for (int i = 0; i < count; ++i) {
+        QDockWidget *dock = new QDockWidget(QString("Dock %1").arg(i), host);
+        dock->setObjectName(QString("Dock%1").arg(i));
+        QWidget *content = new QWidget(dock);
+        content->setMinimumSize(8, 8);
+        dock->setWidget(content);
+        const Qt::DockWidgetArea area = areas[i % 4];
+        if (i >= 4 && (i / 4) % 3 == 2)
+            host->splitDockWidget(docks.at(i - 4), dock, area == Qt::LeftDockWidgetArea || area == Qt::RightDockWidgetArea
+                                                           ? Qt::Horizontal : Qt::Vertical);
+        else
+            host->addDockWidget(area, dock);
+        docks.append(dock);
+    }
+    return docks;
+}
+
+// Window resize frames with pinned dock sizes against the proportional solver
+static void resizeSuite(Benchmark &benchmark)
+{
+    for (int count : { 50, 500 }) {
+        for (bool solver : { false, true }) {
+            QMainWindow host;
+            QWidget *central = new QWidget(&host);
+            central->setMinimumSize(100, 100);
+            host.setCentralWidget(central);
+            const QList<QDockWidget*> docks = populateDocks(&host, count);
+            DockSizeSolver *sizeSolver = new DockSizeSolver(&host);
+            host.resize(1600, 1200);
+            host.show();
+            QCoreApplication::processEvents();
+
+            if (solver) {
+                sizeSolver->setEnabled(true);
+            } else {
+                for (QDockWidget *dock : docks) {
+                    dock->setMinimumSize(dock->size());
+                    dock->setMaximumSize(dock->size());
+                }
+            }
+
+            // An interactive drag: the window grows and shrinks a few pixels per frame
+            int frame = 0;
+            benchmark.measure(QString("window resize %1 docks (%2)").arg(count).arg(solver ? "solver" : "pinned"), [&]() {
+                const int offset = (frame++ % 100) * 4;
+                host.resize(1400 + offset, 1000 + offset / 2);
+                QCoreApplication::sendPostedEvents();
+            });
+
+            if (solver) {
+                QList<QDockWidget*> solved;
+                QList<int> widths;
+                QList<int> heights;
+                sizeSolver->invalidate();
+                benchmark.measure(QString("solve only %1 docks").arg(count), [&]() {
+                    sizeSolver->solve(QSize(1500, 1100), &solved, &widths, &heights);
+                });
+            }
+        }
+    }
+}
+
+// Per dock area its thickness over the window width or height, docks and
+// central widget only
+static QVector<double> areaShares(QMainWindow *host)
+{
+    static const Qt::DockWidgetArea areas[] = {
+        Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+    };
+    QRect region = host->centralWidget()->geometry();
+    QRect areaRects[4];
+    for (QDockWidget *dock : host->findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly)) {
+        if (dock->isFloating() || !dock->isVisible())
+            continue;
+        region |= dock->geometry();
+        for (int i = 0; i < 4; ++i) {
+            if (host->dockWidgetArea(dock) == areas[i])
+                areaRects[i] |= dock->geometry();
+        }
+    }
+    QVector<double> shares;
+    for (int i = 0; i < 4; ++i) {
+        const bool vertical = i < 2;
+        const int dimension = vertical ? region.width() : region.height();
+        const int thickness = vertical ? areaRects[i].width() : areaRects[i].height();
+        shares.append(dimension > 0 ? double(thickness) / dimension : 0.0);
+    }
+    return shares;
+}
+
+// Real window resizes of the DockManager docks with fixed sizes: the area
+// shares after a user change have to survive them
+static void dockSharesSuite(Benchmark &benchmark)
+{
+    static const double kTolerance = 0.02;
+    static const QSize kWindowSizes[] = { QSize(1600, 1100), QSize(1000, 700), QSize(1400, 900) };
+
+    QMainWindow host;
+    QWidget *central = new QWidget(&host);
+    central->setMinimumSize(100, 100);
+    host.setCentralWidget(central);
+    DockManager manager(&host);
+    manager.setSizesFixed(true);
+    host.resize(1200, 800);
+    host.show();
+    // Proportions are captured on the idle turn after a change
+    auto settle = []() {
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+    };
+    settle();
+
+    // The user widens the first docked dock
+    for (QDockWidget *dock : manager.allDockWidgets()) {
+        if (dock->isFloating() || !dock->isVisible())
+            continue;
+        const Qt::DockWidgetArea area = host.dockWidgetArea(dock);
+        const bool vertical = area == Qt::LeftDockWidgetArea || area == Qt::RightDockWidgetArea;
+        host.resizeDocks({ dock }, { (vertical ? dock->width() : dock->height()) + 60 },
+                         vertical ? Qt::Horizontal : Qt::Vertical);
+        break;
+    }
+    settle();
+    const QVector<double> expected = areaShares(&host);
+
+    for (const QSize &size : kWindowSizes) {
+        host.resize(size);
+        settle();
+        const QVector<double> shares = areaShares(&host);
+        double deviation = 0.0;
+        for (int i = 0; i < shares.size(); ++i)
+            deviation = qMax(deviation, qAbs(shares.at(i) - expected.at(i)));
+        benchmark.check(QString("area shares at %1x%2").arg(size.width()).arg(size.height()),
+                        deviation <= kTolerance,
+                        QString("max deviation %1").arg(deviation, 0, 'f', 3));
+    }
+
+    int frame = 0;
+    benchmark.measure("window resize DockManager docks", [&]() {
+        const int offset = (frame++ % 100) * 4;
+        host.resize(1200 + offset, 800 + offset / 2);
+        QCoreApplication::sendPostedEvents();
+    });
+}
+
+// Synthetic window drag over color docks: full repaints against snapshots
+static void liveResizeSuite(Benchmark &benchmark)
+{
+    static const char *const colors[] = { "Black", "White", "Red", "Green", "Blue", "Yellow", "Cyan", "Magenta" };
+    static const Qt::DockWidgetArea areas[] = {
+        Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+    };
+
+    for (bool live : { false, true }) {
+        const QString variant = live ? "live resize" : "full repaint";
+        QMainWindow host;
+        host.setCentralWidget(new QWidget(&host));
+        LiveResizeFilter filter;
+        // The drag below is made of programmatic resizes
+        filter.setRequiresDrag(false);
+        for (int i = 0; i < 8; ++i) {
+            ColorSwatch *swatch = new ColorSwatch(colors[i], &host);
+            host.addDockWidget(areas[i % 4], swatch);
+            if (live)
+                filter.watch(swatch->widget());
+        }
+        host.resize(1200, 800);
+        host.show();
+        host.repaint();
+        QCoreApplication::processEvents();
+
+        int frame = 0;
+        ColorDock::resetPaintedArea();
+        benchmark.measure(QString("drag frame (%1)").arg(variant), [&]() {
+            const int offset = (frame++ % 50) * 6;
+            host.resize(1200 + offset, 800 + offset / 2);
+            QCoreApplication::sendPostedEvents();
+            host.repaint();
+        });
+        benchmark.note(QString("drag ColorDock paints/frame (%1)").arg(variant),
+                       QString::number(double(ColorDock::totalPaintCount()) / qMax(1, frame), 'f', 2));
+
+        // Let the drag settle, then time the one real repaint
+        QEventLoop loop;
+        QTimer::singleShot(filter.settleDelay() + 50, &loop, &QEventLoop::quit);
+        loop.exec();
+        QElapsedTimer timer;
+        timer.start();
+        host.repaint();
+        benchmark.note(QString("settle repaint (%1)").arg(variant),
+                       QString("%1 us").arg(timer.nsecsElapsed() / 1000.0, 0, 'f', 1));
+    }
+}
+
+// Saving and restoring the properties of many dock content widgets
+static void widgetStateSuite(Benchmark &benchmark)
+{
+    static const char *const colors[] = { "Black", "White", "Red", "Green", "Blue", "Yellow", "Cyan", "Magenta" };
+
+    for (int count : { 1000, 5000 }) {
+        QWidget host;
+        QVector<ColorDock*> docks;
+        docks.reserve(count);
+        for (int i = 0; i < count; ++i)
+            docks.append(new ColorDock(colors[i % 8], &host));
+
+        LayoutWriter writer;
+        benchmark.measure(QString("save %1 widgets").arg(count), [&]() {
+            writer.reset();
+            writer.writeStartElement("Widgets");
+            for (ColorDock *dock : qAsConst(docks)) {
+                writer.writeStartElement("WidgetProperties");
+                WidgetState::save(writer, dock);
+                writer.writeEndElement();
+            }
+            writer.writeEndElement();
+        });
+        const QByteArray data = writer.toByteArray();
+        benchmark.note(QString("save %1 widgets output").arg(count), QString("%1 KiB").arg(data.size() / 1024));
+
+        benchmark.measure(QString("restore %1 widgets").arg(count), [&]() {
+            QXmlStreamReader xmlReader(data);
+            xmlReader.readNextStartElement();
+            int index = 0;
+            while (xmlReader.readNextStartElement()) {
+                ColorDock *dock = docks.at(index++ % count);
+                while (xmlReader.readNextStartElement())
+                    WidgetState::load(xmlReader, dock);
+            }
+        });
+    }
+    benchmark.note("property tables built", QString::number(WidgetState::cachedClassCount()));
+}
+
+// The dock section as it was written before LayoutWriter, for comparison
+static void writeDocksWithStreamWriter(QXmlStreamWriter &xmlWriter, QMainWindow *host, const QList<QDockWidget*> &docks)
+{
+    xmlWriter.writeStartElement("DockWidgets");
+    QSet<QDockWidget*> savedDockWidgets;
+    for (QDockWidget *dockWidget : docks) {
+        if (savedDockWidgets.contains(dockWidget)) continue;
+        xmlWriter.writeStartElement("DockWidget");
+        xmlWriter.writeAttribute("name", dockWidget->objectName());
+
+        QWidget *widget = dockWidget->widget();
+        xmlWriter.writeStartElement("WidgetProperties");
+        xmlWriter.writeTextElement("ObjectName", widget->objectName());
+        xmlWriter.writeTextElement("Geometry", QString("%1,%2,%3,%4")
+                                                   .arg(widget->geometry().x()).arg(widget->geometry().y())
+                                                   .arg(widget->geometry().width()).arg(widget->geometry().height()));
+        xmlWriter.writeTextElement("MinimumSize", QString("%1,%2")
+                                                      .arg(widget->minimumSize().width()).arg(widget->minimumSize().height()));
+        xmlWriter.writeTextElement("MaximumSize", QString("%1,%2")
+                                                      .arg(widget->maximumSize().width()).arg(widget->maximumSize().height()));
+        xmlWriter.writeTextElement("Color", widget->property("colorName").toString());
+        xmlWriter.writeEndElement();
+
+        QSize size = dockWidget->frameGeometry().size();
+        xmlWriter.writeStartElement("Size");
+        xmlWriter.writeTextElement("width", QString::number(size.width()));
+        xmlWriter.writeTextElement("height", QString::number(size.height()));
+        xmlWriter.writeEndElement();
+        xmlWriter.writeTextElement("Title", dockWidget->windowTitle());
+        xmlWriter.writeTextElement("Visible", dockWidget->isVisible() ? "true" : "false");
+        xmlWriter.writeTextElement("Floating", dockWidget->isFloating() ? "true" : "false");
+        xmlWriter.writeTextElement("Features", QString::number(static_cast<int>(dockWidget->features())));
+        xmlWriter.writeTextElement("AllowedAreas", QString::number(static_cast<int>(dockWidget->allowedAreas())));
+        xmlWriter.writeTextElement("DockArea", QString::number(host->dockWidgetArea(dockWidget)));
+
+        QList<QDockWidget*> tabbedGroup = host->tabifiedDockWidgets(dockWidget);
+        if (!tabbedGroup.isEmpty()) {
+            xmlWriter.writeStartElement("TabbedGroup");
+            for (QDockWidget *tabbedDock : tabbedGroup) {
+                xmlWriter.writeTextElement("DockWidget", tabbedDock->objectName());
+                savedDockWidgets.insert(tabbedDock);
+            }
+            xmlWriter.writeEndElement();
+        }
+        xmlWriter.writeEndElement();
+    }
+    xmlWriter.writeEndElement();
+}
+
+// Saving the dock section of a layout: allocations per save should stay
+// flat as the dock count grows with LayoutWriter, and grow with it before
+static void layoutSaveSuite(Benchmark &benchmark)
+{
+    static const char *const colors[] = { "Black", "White", "Red", "Green", "Blue", "Yellow", "Cyan", "Magenta" };
+    static const Qt::DockWidgetArea areas[] = {
+        Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+    };
+
+    for (int count : { 50, 500 }) {
+        QMainWindow host;
+        host.setCentralWidget(new QWidget(&host));
+        QList<QDockWidget*> docks;
+        for (int i = 0; i < count; ++i) {
+            ColorSwatch *swatch = new ColorSwatch(colors[i % 8], &host);
+            swatch->setObjectName(QString("Swatch%1").arg(i));
+            // Every third dock joins the tab group of the one before it
+            if (i % 3 == 2)
+                host.tabifyDockWidget(docks.last(), swatch);
+            else
+                host.addDockWidget(areas[i % 4], swatch);
+            docks.append(swatch);
+        }
+        host.resize(1600, 1200);
+
+        QByteArray data;
+        benchmark.measure(QString("%1 docks (QXmlStreamWriter)").arg(count), [&]() {
+            data.clear();
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            QXmlStreamWriter xmlWriter(&buffer);
+            xmlWriter.setAutoFormatting(true);
+            writeDocksWithStreamWriter(xmlWriter, &host, docks);
+        });
+        benchmark.note(QString("%1 docks output (QXmlStreamWriter)").arg(count), QString("%1 bytes").arg(data.size()));
+
+        for (bool compact : { false, true }) {
+            const QString variant = compact ? "LayoutWriter, compact" : "LayoutWriter";
+            LayoutWriter writer(compact);
+            benchmark.measure(QString("%1 docks (%2)").arg(count).arg(variant), [&]() {
+                writer.reset();
+                DockManager::writeDockWidgets(writer, &host, docks);
+            });
+            benchmark.note(QString("%1 docks output (%2)").arg(count).arg(variant),
+                           QString("%1 bytes, buffer %2").arg(writer.size()).arg(writer.capacity()));
+        }
+    }
+}
+
+static ColorFrame feedFrame(quint64 sequence)
+{
+    ColorFrame frame;
+    frame.background = qRgb(int(sequence * 7 % 256), int(sequence * 13 % 256), 128);
+    frame.level = float(sequence % 1000) / 1000.0f;
+    frame.sequence = sequence;
+    return frame;
+}
+
+// Content published from a producer thread: the triple buffer against
+// posting one queued call to the GUI thread per frame
+static void publishSuite(Benchmark &benchmark)
+{
+    static const int kRunMs = 1000;
+
+    {
+        ColorFeed feed;
+        quint64 sequence = 0;
+        benchmark.measure("publish 1000 frames", [&]() {
+            for (int i = 0; i < 1000; ++i)
+                feed.publish(feedFrame(++sequence));
+        });
+    }
+
+    for (bool posted : { false, true }) {
+        const QString variant = posted ? "posted events" : "triple buffer";
+        QMainWindow host;
+        host.setCentralWidget(new QWidget(&host));
+        ColorSwatch *swatch = new ColorSwatch("Red", &host);
+        host.addDockWidget(Qt::LeftDockWidgetArea, swatch);
+        ColorDock *dock = qobject_cast<ColorDock*>(swatch->widget());
+        host.resize(800, 600);
+        host.show();
+        QCoreApplication::processEvents();
+
+        ColorFeed feed;
+        ColorFeed guiFeed;
+        FrameScheduler scheduler;
+        dock->setFeed(posted ? &guiFeed : &feed);
+        if (!posted) {
+            scheduler.add(swatch, dock);
+            scheduler.setFeed(dock, &feed);
+        }
+
+        std::atomic<bool> running { true };
+        std::atomic<quint64> delivered { 0 };
+        quint64 published = 0;
+        std::thread producer([&]() {
+            while (running.load(std::memory_order_relaxed)) {
+                const ColorFrame frame = feedFrame(++published);
+                if (posted) {
+                    // What a dock had to do before: one event per frame
+                    QMetaObject::invokeMethod(dock, [&, frame]() {
+                        guiFeed.publish(frame);
+                        dock->update();
+                        delivered.fetch_add(1, std::memory_order_relaxed);
+                    }, Qt::QueuedConnection);
+                } else {
+                    feed.publish(frame);
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        });
+
+        ColorDock::resetPaintedArea();
+        QEventLoop loop;
+        QTimer::singleShot(kRunMs, &loop, &QEventLoop::quit);
+        loop.exec();
+        running = false;
+        producer.join();
+
+        // Posted frames still queued have to be drained before the GUI is idle
+        QElapsedTimer drain;
+        drain.start();
+        QCoreApplication::processEvents();
+        const qint64 drainUs = drain.nsecsElapsed() / 1000;
+
+        benchmark.note(QString("frames published (%1)").arg(variant), QString::number(published));
+        benchmark.note(QString("dock paints (%1)").arg(variant), QString::number(ColorDock::totalPaintCount()));
+        if (posted) {
+            benchmark.note(QString("events delivered (%1)").arg(variant), QString::number(delivered.load()));
+        } else {
+            benchmark.note(QString("frames consumed (%1)").arg(variant), QString::number(feed.consumedCount()));
+            benchmark.note(QString("frames dropped (%1)").arg(variant), QString::number(feed.droppedCount()));
+            benchmark.note(QString("frames coalesced (%1)").arg(variant), QString::number(feed.coalescedCount()));
+        }
+        benchmark.note(QString("drain after producer stops (%1)").arg(variant), QString("%1 us").arg(drainUs));
+        dock->setFeed(nullptr);
+    }
+}
+
+// 32 swatches of which 8 are on screen, 16 are background tabs and 8 are
+// closed; every dock changes three times per frame
+static void frameSchedulerSuite(Benchmark &benchmark)
+{
+    static const char *const colors[] = { "Black", "White", "Red", "Green", "Blue", "Yellow", "Cyan", "Magenta" };
+    static const Qt::DockWidgetArea areas[] = {
+        Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+    };
+
+    for (bool scheduled : { false, true }) {
+        const QString variant = scheduled ? "frame scheduler" : "repaint when told";
+        QMainWindow host;
+        host.setCentralWidget(new QWidget(&host));
+        FrameScheduler scheduler;
+        QVector<ColorDock*> contents;
+        ColorSwatch *front = nullptr;
+        for (int i = 0; i < 32; ++i) {
+            ColorSwatch *swatch = new ColorSwatch(colors[i % 8], &host);
+            swatch->setObjectName(QString("Swatch%1").arg(i));
+            if (i % 4 == 0) {
+                host.addDockWidget(areas[(i / 4) % 4], swatch);
+                front = swatch;
+            } else if (i % 4 == 3) {
+                host.addDockWidget(areas[(i / 4) % 4], swatch);
+                swatch->close();
+            } else {
+                host.tabifyDockWidget(front, swatch);
+            }
+            ColorDock *content = qobject_cast<ColorDock*>(swatch->widget());
+            scheduler.add(swatch, content);
+            contents.append(content);
+        }
+        // tabifyDockWidget leaves the newest tab in front
+        for (QTabBar *tabBar : host.findChildren<QTabBar*>())
+            tabBar->setCurrentIndex(0);
+        host.resize(1400, 1000);
+        host.show();
+        QCoreApplication::processEvents();
+
+        ColorDock::resetPaintedArea();
+        int frames = 0;
+        benchmark.measure(QString("frame (%1)").arg(variant), [&]() {
+            ++frames;
+            for (int change = 0; change < 3; ++change) {
+                for (ColorDock *content : qAsConst(contents)) {
+                    if (scheduled)
+                        scheduler.markDirty(content);
+                    else
+                        content->repaint();
+                }
+            }
+            if (scheduled)
+                scheduler.runFrame();
+        });
+        benchmark.note(QString("dock paints/frame (%1)").arg(variant),
+                       QString::number(double(ColorDock::totalPaintCount()) / qMax(1, frames), 'f', 2));
+        if (scheduled) {
+            const FrameScheduler::Totals totals = scheduler.totals();
+            benchmark.note("hidden skips/frame", QString::number(double(totals.hiddenSkips) / qMax<quint64>(1, totals.frames), 'f', 2));
+            benchmark.note("frames over budget", QString::number(totals.overBudgetFrames));
+        }
+    }
+}
+
+static bool writeLogFile(const QString &fileName, qint64 bytes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QByteArray chunk;
+    for (int line = 0; chunk.size() < 1024 * 1024; ++line)
+        chunk += QString("2024-01-01 12:00:%1.%2 INFO  worker-%3 processed request %4 in %5 ms\n")
+                     .arg(line % 60, 2, 10, QLatin1Char('0')).arg(line % 1000, 3, 10, QLatin1Char('0'))
+                     .arg(line % 16).arg(line).arg(line % 97).toLatin1();
+    for (qint64 written = 0; written < bytes; written += chunk.size()) {
+        if (file.write(chunk) != chunk.size())
+            return false;
+    }
+    return true;
+}
+
+static void logViewSuite(Benchmark &benchmark)
+{
+    QTemporaryDir directory;
+    const QString smallLog = directory.filePath("small.log");
+    const QString largeLog = directory.filePath("large.log");
+    if (!directory.isValid() || !writeLogFile(smallLog, 4 * 1024 * 1024) || !writeLogFile(largeLog, 256 * 1024 * 1024)) {
+        benchmark.note("skipped", "cannot write temporary logs");
+        return;
+    }
+
+    // What the central widget did before: the whole file as a document
+    {
+        QFile file(smallLog);
+        file.open(QIODevice::ReadOnly);
+        const QString text = QString::fromUtf8(file.readAll());
+        QTextEdit textEdit;
+        textEdit.setReadOnly(true);
+        textEdit.resize(800, 600);
+        textEdit.show();
+        benchmark.measure("open to first paint (text edit, 4 MB)", 3, [&]() {
+            textEdit.setPlainText(text);
+            textEdit.viewport()->repaint();
+        });
+        benchmark.note("memory (text edit, 4 MB)",
+                       QString("%1 KiB").arg(qint64(textEdit.document()->characterCount()) * qint64(sizeof(QChar)) * 2 / 1024));
+    }
+
+    LogView logView;
+    logView.resize(800, 600);
+    logView.show();
+    for (const QString &fileName : { smallLog, largeLog }) {
+        const QString size = fileName == smallLog ? "4 MB" : "256 MB";
+        benchmark.measure(QString("open to first paint (log view, %1)").arg(size), 3, [&]() {
+            logView.openFile(fileName);
+            while (logView.lineCount() == 0)
+                QCoreApplication::processEvents();
+            logView.viewport()->repaint();
+        });
+        benchmark.measure(QString("full index (log view, %1)").arg(size), 3, [&]() {
+            QEventLoop loop;
+            QObject::connect(&logView, &LogView::indexingFinished, &loop, &QEventLoop::quit);
+            logView.openFile(fileName);
+            loop.exec();
+        });
+        benchmark.note(QString("memory (log view, %1)").arg(size),
+                       QString("%1 KiB for %2 lines").arg(logView.indexBytes() / 1024).arg(logView.lineCount()));
+    }
+
+    // Scrolling decodes only the lines that come into view
+    int line = 0;
+    benchmark.measure("page down (log view, 256 MB)", [&]() {
+        line = (line + 9973) % qMax(1, logView.lineCount());
+        logView.setTopLine(line);
+        logView.viewport()->repaint();
+    });
+    logView.closeFile();
+}
+
+static void searchSuite(Benchmark &benchmark)
+{
+    QTemporaryDir directory;
+    const QString log = directory.filePath("search.log");
+    const qint64 bytes = 256 * 1024 * 1024;
+    if (!directory.isValid() || !writeLogFile(log, bytes)) {
+        benchmark.note("skipped", "cannot write temporary log");
+        return;
+    }
+
+    struct Case
+    {
+        const char *name;
+        const char *pattern;
+        TextSearch::Options options;
+    };
+    const Case cases[] = {
+        { "literal", "request 4242", TextSearch::CaseSensitive },
+        { "literal, any case", "WORKER-7 PROCESSED", TextSearch::NoOptions },
+        { "regex", "worker-1[0-5] .* in 9[0-6] ms", TextSearch::RegularExpression }
+    };
+
+    TextSearch search;
+    const int idealThreads = search.maxThreadCount();
+    QVector<int> threadCounts = { 1 };
+    if (idealThreads > 1)
+        threadCounts.append(idealThreads);
+    for (const Case &c : cases) {
+        for (int threads : qAsConst(threadCounts)) {
+            search.setMaxThreadCount(threads);
+            const QString variant = QString("%1, %2 thread(s)").arg(c.name).arg(threads);
+            qint64 elapsedUs = 0;
+            qint64 matches = 0;
+            int runs = 0;
+            benchmark.measure(QString("search 256 MB (%1)").arg(variant), 3, [&]() {
+                QEventLoop loop;
+                QMetaObject::Connection connection = QObject::connect(&search, &TextSearch::finished,
+                    [&](qint64 matchCount, qint64, qint64 us) {
+                        matches = matchCount;
+                        elapsedUs += us;
+                        ++runs;
+                        loop.quit();
+                    });
+                search.start(log, c.pattern, c.options);
+                loop.exec();
+                QObject::disconnect(connection);
+            });
+            benchmark.note(QString("throughput (%1)").arg(variant),
+                           QString("%1 MB/s, %2 matches")
+                               .arg(bytes / (1024.0 * 1024.0) / (elapsedUs / 1e6 / qMax(1, runs)), 0, 'f', 0)
+                               .arg(matches));
+        }
+    }
+
+    // A new query replaces the running one without waiting for it
+    search.setMaxThreadCount(idealThreads);
+    benchmark.measure("restart while running", 20, [&]() {
+        QEventLoop loop;
+        QMetaObject::Connection connection = QObject::connect(&search, &TextSearch::finished, &loop, &QEventLoop::quit);
+        search.start(log, "processed", TextSearch::NoOptions);
+        search.start(log, "request 4242", TextSearch::CaseSensitive);
+        loop.exec();
+        QObject::disconnect(connection);
+    });
+}
+
+static void floatingSuite(Benchmark &benchmark)
+{
+    static const char *const colors[] = { "Black", "White", "Red", "Green", "Blue", "Yellow", "Cyan", "Magenta" };
+    const int dockCount = 48;
+
+    for (bool overlaid : { false, true }) {
+        const QString variant = overlaid ? "overlay" : "native windows";
+        QMainWindow host;
+        host.setCentralWidget(new QWidget(&host));
+        host.resize(1600, 1200);
+        host.show();
+        QCoreApplication::processEvents();
+        FloatingOverlay *overlay = overlaid ? new FloatingOverlay(&host) : nullptr;
+
+        QVector<ColorSwatch*> swatches;
+        for (int i = 0; i < dockCount; ++i) {
+            ColorSwatch *swatch = new ColorSwatch(colors[i % 8], &host);
+            swatch->setObjectName(QString("Swatch%1").arg(i));
+            host.addDockWidget(Qt::LeftDockWidgetArea, swatch);
+            swatches.append(swatch);
+        }
+        QCoreApplication::processEvents();
+        auto cascade = [&](int i, int offset) {
+            return host.mapToGlobal(QPoint(40 + (i % 8) * 180 + offset, 60 + (i / 8) * 180));
+        };
+
+        // Floating and docking again all of them, the way a layout load does
+        benchmark.measure(QString("float and dock %1 docks (%2)").arg(dockCount).arg(variant), 5, [&]() {
+            for (int i = 0; i < swatches.size(); ++i)
+                FloatingOverlay::setFloating(swatches.at(i), true, cascade(i, 0));
+            QCoreApplication::processEvents();
+            for (ColorSwatch *swatch : qAsConst(swatches))
+                FloatingOverlay::setFloating(swatch, false);
+            QCoreApplication::processEvents();
+        });
+
+        for (int i = 0; i < swatches.size(); ++i) {
+            FloatingOverlay::setFloating(swatches.at(i), true, cascade(i, 0));
+            swatches.at(i)->resize(160, 160);
+        }
+        QCoreApplication::processEvents();
+        int topLevels = 0;
+        for (QWidget *widget : QApplication::topLevelWidgets())
+            topLevels += widget->isVisible() ? 1 : 0;
+        benchmark.note(QString("visible top-level windows (%1)").arg(variant), QString::number(topLevels));
+
+        int frame = 0;
+        benchmark.measure(QString("move all floating docks (%1)").arg(variant), [&]() {
+            const int offset = (++frame % 2) * 8;
+            for (int i = 0; i < swatches.size(); ++i)
+                FloatingOverlay::setFloating(swatches.at(i), true, cascade(i, offset));
+            QCoreApplication::processEvents();
+        });
+        benchmark.measure(QString("repaint all floating docks (%1)").arg(variant), [&]() {
+            for (ColorSwatch *swatch : qAsConst(swatches))
+                swatch->widget()->update();
+            QCoreApplication::processEvents();
+        });
+
+        delete overlay;
+        qDeleteAll(swatches);
+    }
+}
+
+Benchmark::Benchmark(QObject *parent)
+    : QObject(parent)
+{
+    registerBuiltinSuites();
+}
+
+bool Benchmark::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark", 11) == 0
+            && (argv[i][11] == '\0' || argv[i][11] == '='))
+            return true;
+    }
+    return false;
+}
+
+void Benchmark::registerBuiltinSuites()
+{
+    addSuite("paint", paintSuite);
+    addSuite("theme", themeSuite);
+    addSuite("resize", resizeSuite);
+    addSuite("dockshares", dockSharesSuite);
+    addSuite("liveresize", liveResizeSuite);
+    addSuite("widgetstate", widgetStateSuite);
+    addSuite("layoutsave", layoutSaveSuite);
+    addSuite("publish", publishSuite);
+    addSuite("frames", frameSchedulerSuite);
+    addSuite("logview", logViewSuite);
+    addSuite("search", searchSuite);
+    addSuite("floating", floatingSuite);
+}
+
+void Benchmark::addSuite(const QString &name, const Suite &suite)
+{
+    if (!m_suites.contains(name))
+        m_order.append(name);
+    m_suites[name] = suite;
+}
+
+int Benchmark::run(const QStringList &arguments)
+{
+    QStringList selected;
+    for (const QString &argument : arguments) {
+        if (argument.startsWith("--benchmark=")) {
+            selected = argument.mid(12).split(',', Qt::SkipEmptyParts);
+        } else if (argument.startsWith("--benchmark-frames=")) {
+            m_frames = qMax(1, argument.mid(19).toInt());
+        }
+    }
+    if (selected.isEmpty())
+        selected = m_order;
+
+    for (const QString &name : selected) {
+        if (!m_suites.contains(name)) {
+            QTextStream(stderr) << "Unknown benchmark suite: " << name
+                                << " (available: " << m_order.join(", ") << ")\n";
+            return 1;
+        }
+    }
+
+    printHeader();
+    m_failed = false;
+    for (const QString &name : selected) {
+        m_currentSuite = name;
+        m_suites.value(name)(*this);
+    }
+    return m_failed ? 1 : 0;
+}
+
+void Benchmark::printHeader()
+{
+    QTextStream out(stdout);
+    out << QString::asprintf("%-56s %7s %10s %10s %10s %10s %12s\n",
+                             "case", "frames", "p50(us)", "p90(us)", "p99(us)", "max(us)", "allocs/frame");
+}
+
+void Benchmark::measure(const QString &name, const std::function<void()> &frame)
+{
+    measure(name, m_frames, frame);
+}
+
+void Benchmark::measure(const QString &name, int frames, const std::function<void()> &frame)
+{
+    for (int i = 0; i < m_warmupFrames; ++i)
+        frame();
+
+    QVector<qint64> samples;
+    samples.reserve(frames);
+    QElapsedTimer timer;
+    const quint64 allocationsBefore = AllocationCounter::count();
+    for (int i = 0; i < frames; ++i) {
+        timer.start();
+        frame();
+        samples.append(timer.nsecsElapsed());
+    }
+    // The sample vector is reserved up front, so only the frames allocate
+    const quint64 allocations = AllocationCounter::count() - allocationsBefore;
+
+    const QString label = m_currentSuite + "/" + name;
+    const QString allocationsPerFrame = AllocationCounter::isEnabled()
+            ? QString::number(double(allocations) / frames, 'f', 1) : QString("-");
+    QTextStream out(stdout);
+    out << QString::asprintf("%-56s %7d %10.1f %10.1f %10.1f %10.1f %12s\n",
+                             qPrintable(label), frames,
+                             percentile(samples, 50) / 1000.0,
+                             percentile(samples, 90) / 1000.0,
+                             percentile(samples, 99) / 1000.0,
+                             percentile(samples, 100) / 1000.0,
+                             qPrintable(allocationsPerFrame));
+}
+
+void Benchmark::note(const QString &name, const QString &value)
+{
+    const QString label = m_currentSuite + "/" + name;
+    QTextStream out(stdout);
+    out << QString::asprintf("%-56s %s\n", qPrintable(label), qPrintable(value));
+}
+
+void Benchmark::check(const QString &name, bool passed, const QString &value)
+{
+    note(name, passed ? value : value + " FAILED");
+    if (!passed)
+        m_failed = true;
+}
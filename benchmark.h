@@ -0,0 +1,51 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <functional>
+
+// Offscreen benchmark harness. Started with --benchmark[=suite,...] it runs
+// the registered suites instead of the GUI and prints one line per case.
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Suite = std::function<void(Benchmark &)>;
+
+    explicit Benchmark(QObject *parent = nullptr);
+
+    // Must be checked before QApplication exists so the offscreen
+    // platform plugin can still be selected.
+    static bool requested(int argc, char *argv[]);
+
+    void addSuite(const QString &name, const Suite &suite);
+    int run(const QStringList &arguments);
+
+    int frames() const { return m_frames; }
+    void measure(const QString &name, const std::function<void()> &frame);
+    void measure(const QString &name, int frames, const std::function<void()> &frame);
+    void note(const QString &name, const QString &value);
+    // A note that fails the run when the condition does not hold
+    void check(const QString &name, bool passed, const QString &value);
+
+    // Nearest-rank percentile, p in 0..100
+    static qint64 percentile(QVector<qint64> samples, double p);
+
+private:
+    void registerBuiltinSuites();
+    void printHeader();
+
+    QMap<QString, Suite> m_suites;
+    QStringList m_order;
+    QString m_currentSuite;
+    int m_frames = 200;
+    int m_warmupFrames = 5;
+    bool m_failed = false;
+};
+
+#endif // BENCHMARK_H
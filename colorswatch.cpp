@@ -1,9 +1,13 @@
 #include "colorswatch.h"
+#include "floatingoverlay.h"
+#include "framescheduler.h"
+#include "pixmapatlas.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QGridLayout>
+#include <QVBoxLayout>
 #include <QSpinBox>
 #include <QLabel>
 #include <QSignalBlocker>
@@ -38,37 +42,106 @@ QColor fgColorForName(const QString &name)
     return QColor(name);
 }
 
-static void render_qt_text(QPainter *painter, int w, int h, const QColor &color)
+// The "Qt" outline is the same for every dock, so it is built once and
+// translated into place on paint.
+static const QPainterPath &qtTextPath()
 {
-    QFont font("Times", 10);
-    font.setStyleStrategy(QFont::ForceOutline);
-    painter->setFont(font);
-    painter->setPen(color);
+    static const QPainterPath path = []() {
+        QFont font("Times", 10);
+        font.setStyleStrategy(QFont::ForceOutline);
+        QPainterPath result;
+        result.addText(0, 0, font, "Qt");
+        return result;
+    }();
+    return path;
+}
 
-    QPainterPath path;
-    path.addText(w/2 - 50, h/2, font, "Qt");
-    painter->drawPath(path);
+static QPoint qtTextOrigin(int w, int h)
+{
+    return QPoint(w/2 - 50, h/2);
 }
 
+quint64 ColorDock::s_totalPaintedArea = 0;
+quint64 ColorDock::s_totalPaintCount = 0;
+
 // ColorDock implementation
 ColorDock::ColorDock(const QString &c, QWidget *parent)
-    : QFrame(parent), m_color(c), m_szHint(-1, -1)
+    : QFrame(parent), m_color(c), m_bgColor(bgColorForName(c)), m_fgColor(fgColorForName(c)),
+    m_szHint(-1, -1)
 {
     QFont font = this->font();
     font.setPointSize(8);
     setFont(font);
+
+    // Every exposed pixel is filled in paintEvent, so Qt does not need to
+    // erase the background first.
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void ColorDock::setFeed(ColorFeed *feed)
+{
+    if (m_feed != feed) {
+        m_feed = feed;
+        FrameScheduler::requestRepaint(this);
+    }
 }
 
 void ColorDock::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event);
+    const QRegion &exposed = event->region();
+    quint64 area = 0;
+
+    // Only the newest published frame is read, however many arrived. A
+    // partial paint keeps showing the current one: the rest of the widget
+    // would still show it too. The scheduler's full repaint takes the new
+    // frame instead.
+    QColor background = m_bgColor;
+    float level = -1.0f;
+    if (m_feed) {
+        const bool full = exposed.rectCount() == 1 && exposed.boundingRect().contains(rect());
+        if (full)
+            m_feed->update();
+        else if (m_feed->hasNewFrame())
+            FrameScheduler::requestRepaint(this);
+        const ColorFrame &frame = m_feed->current();
+        if (frame.sequence > 0) {
+            background = QColor::fromRgba(frame.background);
+            level = frame.level;
+        }
+    }
+
     QPainter p(this);
-    p.setRenderHint(QPainter::Antialiasing);
-    p.fillRect(rect(), bgColorForName(m_color));
-    render_qt_text(&p, width(), height(), fgColorForName(m_color));
-}
+    for (const QRect &r : exposed) {
+        p.fillRect(r, background);
+        area += quint64(r.width()) * quint64(r.height());
+    }
+    if (level >= 0.0f) {
+        const int barHeight = qMin(6, height());
+        const QRect bar(0, height() - barHeight, qRound(width() * qMin(level, 1.0f)), barHeight);
+        p.fillRect(bar & exposed.boundingRect(), m_fgColor);
+    }
 
+    const QPainterPath &path = qtTextPath();
+    const QPoint origin = qtTextOrigin(width(), height());
+    const QRect textRect = path.boundingRect().toAlignedRect().translated(origin).adjusted(-1, -1, 1, 1);
+    if (exposed.intersects(textRect)) {
+        p.setClipRegion(exposed);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.translate(origin);
+        p.setPen(m_fgColor);
+        p.drawPath(path);
+    }
 
+    m_paintedArea += area;
+    s_totalPaintedArea += area;
+    ++s_totalPaintCount;
+}
+
+void ColorDock::resetPaintedArea()
+{
+    s_totalPaintedArea = 0;
+    s_totalPaintCount = 0;
+}
 
 static QSpinBox *createSpinBox(int value, QWidget *parent, int max = 1000)
 {
@@ -79,6 +152,65 @@ static QSpinBox *createSpinBox(int value, QWidget *parent, int max = 1000)
     return result;
 }
 
+void ColorDock::setColorName(const QString &color)
+{
+    if (m_color != color) {
+        m_color = color;
+        m_bgColor = bgColorForName(color);
+        m_fgColor = fgColorForName(color);
+        FrameScheduler::requestRepaint(this);
+    }
+}
+
+void ColorDock::setCustomSizeHint(const QSize &size)
+{
+    if (m_szHint != size) {
+        m_szHint = size;
+        updateGeometry();
+    }
+}
+
+void ColorDock::changeSizeHints()
+{
+    QDialog dialog(this);
+    dialog.setWindowFlags(dialog.windowFlags() & ~Qt::WindowContextHelpButtonHint);
+    dialog.setWindowTitle(m_color);
+
+    QVBoxLayout *topLayout = new QVBoxLayout(&dialog);
+    QGridLayout *inputLayout = new QGridLayout();
+    topLayout->addLayout(inputLayout);
+
+    inputLayout->addWidget(new QLabel(tr("Size Hint:"), &dialog), 0, 0);
+    inputLayout->addWidget(new QLabel(tr("Min Size Hint:"), &dialog), 1, 0);
+    inputLayout->addWidget(new QLabel(tr("Max Size:"), &dialog), 2, 0);
+
+    QSpinBox *szHintW = createSpinBox(m_szHint.width(), &dialog);
+    QSpinBox *szHintH = createSpinBox(m_szHint.height(), &dialog);
+    QSpinBox *minSzHintW = createSpinBox(m_minSzHint.width(), &dialog);
+    QSpinBox *minSzHintH = createSpinBox(m_minSzHint.height(), &dialog);
+    QSpinBox *maxSzW = createSpinBox(maximumWidth(), &dialog, QWIDGETSIZE_MAX);
+    QSpinBox *maxSzH = createSpinBox(maximumHeight(), &dialog, QWIDGETSIZE_MAX);
+    inputLayout->addWidget(szHintW, 0, 1);
+    inputLayout->addWidget(szHintH, 0, 2);
+    inputLayout->addWidget(minSzHintW, 1, 1);
+    inputLayout->addWidget(minSzHintH, 1, 2);
+    inputLayout->addWidget(maxSzW, 2, 1);
+    inputLayout->addWidget(maxSzH, 2, 2);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    topLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted)
+        return;
+
+    m_szHint = QSize(szHintW->value(), szHintH->value());
+    m_minSzHint = QSize(minSzHintW->value(), minSzHintH->value());
+    setMaximumSize(maxSzW->value(), maxSzH->value());
+    updateGeometry();
+}
+
 // ColorSwatch implementation
 ColorSwatch::ColorSwatch(const QString &colorName, QMainWindow *parent, Qt::WindowFlags flags)
     : QDockWidget(parent, flags), m_colorName(colorName), m_mainWindow(parent)
@@ -105,6 +237,39 @@ ColorSwatch::~ColorSwatch()
     delete m_colorDock;
 }
 
+void ColorSwatch::setCustomSizeHint(const QSize &size)
+{
+    m_colorDock->setCustomSizeHint(size);
+}
+
+QSize ColorSwatch::customSizeHint() const
+{
+    return m_colorDock->customSizeHint();
+}
+
+void ColorSwatch::changeSizeHints()
+{
+    m_colorDock->changeSizeHints();
+}
+
+void ColorSwatch::setTitleBarWidget(QWidget *widget)
+{
+    QDockWidget::setTitleBarWidget(widget);
+}
+
+QWidget *ColorSwatch::titleBarWidget() const
+{
+    return QDockWidget::titleBarWidget();
+}
+
+void ColorSwatch::resizeEvent(QResizeEvent *e)
+{
+    if (BlueTitleBar *btb = qobject_cast<BlueTitleBar*>(titleBarWidget()))
+        btb->updateMask();
+
+    QDockWidget::resizeEvent(e);
+}
+
 
 void ColorSwatch::setFeatures(QDockWidget::DockWidgetFeatures features)
 {
@@ -266,7 +431,7 @@ void ColorSwatch::updateContextMenu()
         m_verticalTitleBarAction->setChecked(false);
     } else {
         m_floatableAction->setChecked(features() & QDockWidget::DockWidgetFloatable);
-        m_floatingAction->setChecked(isFloating());
+        m_floatingAction->setChecked(FloatingOverlay::isFloating(this));
         m_movableAction->setChecked(features() & QDockWidget::DockWidgetMovable);
         m_verticalTitleBarAction->setChecked(features() & QDockWidget::DockWidgetVerticalTitleBar);
     }
@@ -338,13 +503,20 @@ void ColorSwatch::splitInto(QAction *action)
 
     const Qt::Orientation o = action->parent() == m_splitHMenu
                                   ? Qt::Horizontal : Qt::Vertical;
+    // A panel in the overlay has no place in the layout to split next to
+    if (FloatingOverlay::of(target))
+        FloatingOverlay::setFloating(target, false);
     m_mainWindow->splitDockWidget(target, this, o);
+    emit splitNextTo(target->objectName(), o);
 }
 
 void ColorSwatch::tabInto(QAction *action)
 {
-    if (ColorSwatch *target = findByName(m_mainWindow, action->text()))
+    if (ColorSwatch *target = findByName(m_mainWindow, action->text())) {
+        if (FloatingOverlay::of(target))
+            FloatingOverlay::setFloating(target, false);
         m_mainWindow->tabifyDockWidget(target, this);
+    }
 }
 
 #ifndef QT_NO_CONTEXTMENU
@@ -401,7 +573,7 @@ void ColorSwatch::changeFloatable(bool on)
 
 void ColorSwatch::changeFloating(bool floating)
 {
-    setFloating(floating);
+    FloatingOverlay::setFloating(this, floating);
 }
 
 void ColorSwatch::allowLeft(bool a)
@@ -452,13 +624,30 @@ void ColorSwatch::changeVerticalTitleBar(bool on)
 
 // BlueTitleBar implementation
 BlueTitleBar::BlueTitleBar(QWidget *parent)
-    : QWidget(parent),
-    m_leftPm(QPixmap(":/res/titlebarLeft.png")),
-    m_centerPm(QPixmap(":/res/titlebarCenter.png")),
-    m_rightPm(QPixmap(":/res/titlebarRight.png"))
+    : QWidget(parent)
 {
+    updatePixmaps();
 }
 
+void BlueTitleBar::updatePixmaps()
+{
+    m_pixmapRatio = devicePixelRatioF();
+    m_leftPm = PixmapAtlas::pixmap(":/res/titlebarLeft.png", m_pixmapRatio);
+    m_centerPm = PixmapAtlas::pixmap(":/res/titlebarCenter.png", m_pixmapRatio);
+    m_rightPm = PixmapAtlas::pixmap(":/res/titlebarRight.png", m_pixmapRatio);
+    m_leftSize = PixmapAtlas::logicalSize(m_leftPm);
+    m_centerSize = PixmapAtlas::logicalSize(m_centerPm);
+    m_rightSize = PixmapAtlas::logicalSize(m_rightPm);
+}
+
+QSize BlueTitleBar::minimumSizeHint() const
+{
+    QSize result(m_leftSize.width() + m_rightSize.width(), m_centerSize.height());
+    QDockWidget *dw = qobject_cast<QDockWidget*>(parentWidget());
+    if (dw && dw->features() & QDockWidget::DockWidgetVerticalTitleBar)
+        result.transpose();
+    return result;
+}
 
 void BlueTitleBar::paintEvent(QPaintEvent *event)
 {
@@ -469,6 +658,10 @@ void BlueTitleBar::paintEvent(QPaintEvent *event)
     QDockWidget *dw = qobject_cast<QDockWidget*>(parentWidget());
     if (!dw) return;
 
+    // Moving to a screen with another ratio picks up the matching variant
+    if (!qFuzzyCompare(m_pixmapRatio, devicePixelRatioF()))
+        updatePixmaps();
+
     if (dw->features() & QDockWidget::DockWidgetVerticalTitleBar) {
         QSize s = rect.size();
         s.transpose();
@@ -480,11 +673,10 @@ void BlueTitleBar::paintEvent(QPaintEvent *event)
     }
 
     painter.drawPixmap(rect.topLeft(), m_leftPm);
-    painter.drawPixmap(rect.topRight() - QPoint(m_rightPm.width() - 1, 0), m_rightPm);
-    QBrush brush(m_centerPm);
-    painter.fillRect(rect.left() + m_leftPm.width(), rect.top(),
-                     rect.width() - m_leftPm.width() - m_rightPm.width(),
-                     m_centerPm.height(), m_centerPm);
+    painter.drawPixmap(rect.topRight() - QPoint(m_rightSize.width() - 1, 0), m_rightPm);
+    painter.drawTiledPixmap(rect.left() + m_leftSize.width(), rect.top(),
+                            rect.width() - m_leftSize.width() - m_rightSize.width(),
+                            m_centerSize.height(), m_centerPm);
 }
 
 void BlueTitleBar::mouseReleaseEvent(QMouseEvent *event)
@@ -516,7 +708,7 @@ void BlueTitleBar::mouseReleaseEvent(QMouseEvent *event)
         break;
     case 1:
         event->accept();
-        dw->setFloating(!dw->isFloating());
+        FloatingOverlay::setFloating(dw, !FloatingOverlay::isFloating(dw));
         break;
     case 2: {
         event->accept();
@@ -575,10 +767,10 @@ void BlueTitleBar::updateMask()
         rect = titleRect;
 
         painter.drawPixmap(rect.topLeft(), m_leftPm.mask());
-        painter.fillRect(rect.left() + m_leftPm.width(), rect.top(),
-                         rect.width() - m_leftPm.width() - m_rightPm.width(),
-                         m_centerPm.height(), Qt::color1);
-        painter.drawPixmap(rect.topRight() - QPoint(m_rightPm.width() - 1, 0), m_rightPm.mask());
+        painter.fillRect(rect.left() + m_leftSize.width(), rect.top(),
+                         rect.width() - m_leftSize.width() - m_rightSize.width(),
+                         m_centerSize.height(), Qt::color1);
+        painter.drawPixmap(rect.topRight() - QPoint(m_rightSize.width() - 1, 0), m_rightPm.mask());
         painter.fillRect(contents, Qt::color1);
     }
 
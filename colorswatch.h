@@ -7,10 +7,15 @@
 #include <QMenu>
 #include <QFrame>
 #include <QDebug>
+#include "triplebuffer.h"
 
 class ColorDock;
 class BlueTitleBar;
 
+// Swatch colors for a color name, shared with anything that draws docks
+QColor bgColorForName(const QString &name);
+QColor fgColorForName(const QString &name);
+
 class ColorSwatch : public QDockWidget
 {
     Q_OBJECT
@@ -42,6 +47,10 @@ public:
 public slots:
     void changeSizeHints();
 
+signals:
+    // Emitted after this dock was split next to target from its context menu
+    void splitNextTo(const QString &target, Qt::Orientation orientation);
+
 protected:
 #ifndef QT_NO_CONTEXTMENU
     void contextMenuEvent(QContextMenuEvent *event) override;
@@ -124,19 +133,41 @@ public slots:
     void updateMask();
 
 private:
-    const QPixmap m_leftPm;
-    const QPixmap m_centerPm;
-    const QPixmap m_rightPm;
+    void updatePixmaps();
+
+    // Shared copies from PixmapAtlas for the current device-pixel ratio
+    QPixmap m_leftPm;
+    QPixmap m_centerPm;
+    QPixmap m_rightPm;
+    QSize m_leftSize;
+    QSize m_centerSize;
+    QSize m_rightSize;
+    qreal m_pixmapRatio = 1.0;
+};
+
+// A frame published to a ColorDock from a producer thread
+struct ColorFrame
+{
+    QRgb background = 0;
+    // Fill of the bar along the bottom edge, 0..1; none when negative
+    float level = -1.0f;
+    quint64 sequence = 0;
 };
 
+using ColorFeed = TripleBuffer<ColorFrame>;
+
 class ColorDock : public QFrame
 {
     Q_OBJECT
+    Q_PROPERTY(QString colorName READ colorName WRITE setColorName)
+    Q_PROPERTY(QSize customSizeHint READ customSizeHint WRITE setCustomSizeHint)
+    // Saved layouts keep the properties above, not QFrame's
+    Q_CLASSINFO("StateBase", "QFrame")
 public:
     explicit ColorDock(const QString &color, QWidget *parent = nullptr);
 
-    // Add this function
     QString colorName() const { return m_color; }
+    void setColorName(const QString &color);
 
     QSize sizeHint() const override { return m_szHint; }
     QSize minimumSizeHint() const override { return m_minSzHint; }
@@ -144,16 +175,34 @@ public:
     void setCustomSizeHint(const QSize &size);
     QSize customSizeHint() const { return m_szHint; }
 
+    // Paints the newest frame of feed instead of the named color until the
+    // feed is reset to nullptr. The feed must outlive the dock or be reset.
+    void setFeed(ColorFeed *feed);
+    ColorFeed *feed() const { return m_feed; }
+
+    // Repaint-area accounting, in device-independent pixels
+    quint64 paintedArea() const { return m_paintedArea; }
+    static quint64 totalPaintedArea() { return s_totalPaintedArea; }
+    static quint64 totalPaintCount() { return s_totalPaintCount; }
+    static void resetPaintedArea();
+
 public slots:
     void changeSizeHints();
 
 protected:
-    void paintEvent(QPaintEvent *) override;
+    void paintEvent(QPaintEvent *event) override;
 
 private:
-    const QString m_color;
+    QString m_color;
+    QColor m_bgColor;
+    QColor m_fgColor;
     QSize m_szHint;
     QSize m_minSzHint;
+    ColorFeed *m_feed = nullptr;
+    quint64 m_paintedArea = 0;
+
+    static quint64 s_totalPaintedArea;
+    static quint64 s_totalPaintCount;
 };
 
 #endif // COLORSWATCH_H
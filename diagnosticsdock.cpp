@@ -0,0 +1,116 @@
+#include "diagnosticsdock.h"
+#include "memoryaccounting.h"
+#include "stallwatchdog.h"
+#include <QFontDatabase>
+#include <QHeaderView>
+#include <QPlainTextEdit>
+#include <QTabWidget>
+#include <QTreeWidget>
+
+static const int kRefreshIntervalMs = 1000;
+
+static QString kibLabel(qint64 bytes)
+{
+    return QString::number(bytes / 1024.0, 'f', 1);
+}
+
+DiagnosticsDock::DiagnosticsDock(MemoryAccounting *accounting, QWidget *parent)
+    : QDockWidget(tr("Diagnostics"), parent), m_accounting(accounting)
+{
+    setObjectName("DiagnosticsDock");
+
+    QTabWidget *tabs = new QTabWidget(this);
+
+    m_memoryTree = new QTreeWidget(tabs);
+    m_memoryTree->setColumnCount(5);
+    m_memoryTree->setHeaderLabels({ tr("Memory"), tr("KiB"), tr("Objects"), tr("Widgets"), tr("Detail") });
+    m_memoryTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_memoryTree->setRootIsDecorated(true);
+    m_memoryTree->setUniformRowHeights(true);
+    tabs->addTab(m_memoryTree, tr("Memory"));
+
+    m_latencyView = new QPlainTextEdit(tabs);
+    m_latencyView->setReadOnly(true);
+    m_latencyView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    tabs->addTab(m_latencyView, tr("Responsiveness"));
+    setWidget(tabs);
+
+    m_refreshTimer.setInterval(kRefreshIntervalMs);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &DiagnosticsDock::refresh);
+}
+
+void DiagnosticsDock::refresh()
+{
+    refreshMemory();
+    refreshLatency();
+}
+
+void DiagnosticsDock::refreshLatency()
+{
+    StallWatchdog *watchdog = StallWatchdog::instance();
+    m_latencyView->setPlainText(watchdog->isRunning() ? watchdog->report()
+                                                      : tr("Stall watchdog is not running."));
+}
+
+void DiagnosticsDock::refreshMemory()
+{
+    QStringList expanded;
+    for (int i = 0; i < m_memoryTree->topLevelItemCount(); ++i) {
+        if (m_memoryTree->topLevelItem(i)->isExpanded())
+            expanded.append(m_memoryTree->topLevelItem(i)->text(0));
+    }
+
+    m_memoryTree->setUpdatesEnabled(false);
+    m_memoryTree->clear();
+    qint64 total = 0;
+    for (const QString &subsystem : m_accounting->subsystems()) {
+        QTreeWidgetItem *group = new QTreeWidgetItem(m_memoryTree);
+        qint64 bytes = 0;
+        int objects = 0;
+        int widgets = 0;
+        for (const MemoryAccounting::Entry &entry : m_accounting->collect(subsystem)) {
+            QTreeWidgetItem *item = new QTreeWidgetItem(group);
+            item->setText(0, entry.name);
+            item->setText(1, kibLabel(entry.bytes));
+            item->setText(2, QString::number(entry.objects));
+            item->setText(3, QString::number(entry.widgets));
+            item->setText(4, entry.detail);
+            bytes += entry.bytes;
+            objects += entry.objects;
+            widgets += entry.widgets;
+        }
+        group->setText(0, subsystem);
+        group->setText(1, kibLabel(bytes));
+        group->setText(2, QString::number(objects));
+        group->setText(3, QString::number(widgets));
+        group->setExpanded(expanded.contains(subsystem));
+        total += bytes;
+    }
+
+    QTreeWidgetItem *totalItem = new QTreeWidgetItem(m_memoryTree);
+    totalItem->setText(0, tr("Total (estimated)"));
+    totalItem->setText(1, kibLabel(total));
+    m_memoryTree->setUpdatesEnabled(true);
+}
+
+void DiagnosticsDock::showEvent(QShowEvent *event)
+{
+    QDockWidget::showEvent(event);
+    StallWatchdog *watchdog = StallWatchdog::instance();
+    if (!watchdog->isRunning()) {
+        watchdog->start();
+        m_startedWatchdog = true;
+    }
+    refresh();
+    m_refreshTimer.start();
+}
+
+void DiagnosticsDock::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer.stop();
+    if (m_startedWatchdog) {
+        StallWatchdog::instance()->stop();
+        m_startedWatchdog = false;
+    }
+    QDockWidget::hideEvent(event);
+}
@@ -0,0 +1,41 @@
+#ifndef DIAGNOSTICSDOCK_H
+#define DIAGNOSTICSDOCK_H
+
+#include <QDockWidget>
+#include <QTimer>
+
+class QPlainTextEdit;
+class QTreeWidget;
+class MemoryAccounting;
+
+// Dock on the outer window that shows the memory estimates of every
+// subsystem and the event-loop latency numbers, refreshed while visible.
+// Unless --stall-report already started it, the stall watchdog only runs
+// while the dock is shown.
+class DiagnosticsDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDock(MemoryAccounting *accounting, QWidget *parent = nullptr);
+
+public slots:
+    void refresh();
+
+private slots:
+    void refreshMemory();
+    void refreshLatency();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    MemoryAccounting *m_accounting;
+    QTreeWidget *m_memoryTree;
+    QPlainTextEdit *m_latencyView;
+    QTimer m_refreshTimer;
+    bool m_startedWatchdog = false;
+};
+
+#endif // DIAGNOSTICSDOCK_H
@@ -0,0 +1,28 @@
+#ifndef DOCKCONTENTINTERFACE_H
+#define DOCKCONTENTINTERFACE_H
+
+#include <QtPlugin>
+#include <QString>
+
+class QWidget;
+
+// Implemented by dock content plugins. The plugin's metadata file lists the
+// content types it provides, so the application can offer them without
+// loading the library:
+//
+//   { "docks": [ { "type": "Clock", "title": "Clock",
+//                  "area": "Right", "icon": "clock.png" } ] }
+//
+// "area" is Left, Right, Top or Bottom; "icon" is relative to the plugin
+// file. createContent() is called once per dock, the first time it is needed.
+class DockContentInterface
+{
+public:
+    virtual ~DockContentInterface() = default;
+    virtual QWidget *createContent(const QString &type, QWidget *parent) = 0;
+};
+
+#define DockContentInterface_iid "org.qt-project.MainWindows.DockContentInterface/1.0"
+Q_DECLARE_INTERFACE(DockContentInterface, DockContentInterface_iid)
+
+#endif // DOCKCONTENTINTERFACE_H
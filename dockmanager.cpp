@@ -1,4 +1,12 @@
 #include "dockmanager.h"
+#include "dockpluginregistry.h"
+#include "docksizesolver.h"
+#include "floatingoverlay.h"
+#include "framescheduler.h"
+#include "liveresize.h"
+#include "plugindock.h"
+#include "stallwatchdog.h"
+#include "widgetstate.h"
 #include <QTextEdit>
 #include <QAction>
 #include <QMessageBox>
@@ -7,16 +15,23 @@
 #include <QEvent>
 #include <QApplication>
 #include <QMainWindow>
+#include <QLayout>
+#include <algorithm>
 
 DockManager::DockManager(QMainWindow *parent)
     : QObject(parent), m_mainWindow(parent), m_viewMenu(new QMenu(tr("&View"), parent))
 {
+    m_sizeSolver = new DockSizeSolver(parent);
+    m_liveResize = new LiveResizeFilter(this);
+    m_frameScheduler = new FrameScheduler(this);
+    m_sizeSolver->setEnabled(m_sizesFixed);
     setupDockWidgets();
 }
 
 DockManager::~DockManager()
 {
     qDeleteAll(m_dockWidgets);
+    qDeleteAll(m_pluginDocks);
 }
 
 ColorSwatch* DockManager::dockWidget(const QString &name) const
@@ -28,18 +43,137 @@ ColorSwatch* DockManager::dockWidget(const QString &name) const
     return nullptr;
 }
 
+bool DockManager::setDockFeed(const QString &name, ColorFeed *feed)
+{
+    ColorSwatch *swatch = dockWidget(name);
+    ColorDock *content = swatch ? qobject_cast<ColorDock*>(swatch->widget()) : nullptr;
+    if (!content)
+        return false;
+    content->setFeed(feed);
+    m_frameScheduler->setFeed(content, feed);
+    return true;
+}
+
+void DockManager::setFloatingMode(FloatingMode mode)
+{
+    if (mode == floatingMode())
+        return;
+    StallWatchdog::Scope scope("DockManager::setFloatingMode");
+
+    if (mode == OverlayFloating) {
+        m_overlay = new FloatingOverlay(m_mainWindow);
+        connect(m_overlay, &FloatingOverlay::floatingChanged, this, [this](QDockWidget *dock, bool floating) {
+            emit dockWidgetFloated(dock->objectName(), floating, FloatingOverlay::floatingGeometry(dock).topLeft());
+        });
+        for (QDockWidget *dock : allDockWidgets()) {
+            if (dock->isFloating())
+                m_overlay->adopt(dock);
+        }
+        return;
+    }
+
+    // Panels become native floating docks where they were
+    FloatingOverlay *overlay = m_overlay;
+    m_overlay = nullptr;
+    disconnect(overlay, nullptr, this, nullptr);
+    for (QDockWidget *dock : overlay->docks()) {
+        const QPoint position = FloatingOverlay::floatingGeometry(dock).topLeft();
+        const bool visible = !dock->isHidden();
+        overlay->release(dock);
+        dock->setFloating(true);
+        dock->move(position);
+        dock->setVisible(visible);
+    }
+    delete overlay;
+}
+
+void DockManager::suspendFloatingDocks()
+{
+    for (QDockWidget *dock : allDockWidgets()) {
+        if (dock->isFloating() && !dock->isHidden()) {
+            m_suspendedDocks.append(dock);
+            dock->hide();
+        }
+    }
+}
+
+void DockManager::resumeFloatingDocks()
+{
+    const QList<QPointer<QDockWidget>> suspended = m_suspendedDocks;
+    m_suspendedDocks.clear();
+    for (const QPointer<QDockWidget> &dock : suspended) {
+        // Docked or floated into the overlay while the workspace was away
+        if (dock && dock->isFloating())
+            dock->show();
+    }
+}
+
+QList<QDockWidget*> DockManager::allDockWidgets() const
+{
+    QList<QDockWidget*> docks;
+    docks.reserve(m_dockWidgets.size() + m_pluginDocks.size());
+    for (ColorSwatch *swatch : m_dockWidgets)
+        docks.append(swatch);
+    for (PluginDock *dock : m_pluginDocks)
+        docks.append(dock);
+    return docks;
+}
+
+QDockWidget *DockManager::findDockWidget(const QString &name) const
+{
+    if (ColorSwatch *swatch = dockWidget(name))
+        return swatch;
+    for (PluginDock *dock : m_pluginDocks) {
+        if (dock->objectName() == name)
+            return dock;
+    }
+    return nullptr;
+}
+
 ColorSwatch* DockManager::createColorSwatch(const QString &colorName, Qt::DockWidgetArea area)
 {
     ColorSwatch *swatch = new ColorSwatch(colorName, m_mainWindow);
     swatch->setObjectName(colorName + "Dock");
+    m_dockWidgets.append(swatch);
+    registerDockWidget(swatch, area);
+    if (LiveResizeFilter::isEnabledForType(swatch->widget()->metaObject()->className()))
+        m_liveResize->watch(swatch->widget());
+    m_frameScheduler->add(swatch, swatch->widget());
+    connect(swatch, &ColorSwatch::splitNextTo, this, [this, swatch](const QString &target, Qt::Orientation orientation) {
+        emit dockWidgetSplit(swatch->objectName(), target, orientation);
+    });
+    emit dockWidgetCreated(swatch);
+    return swatch;
+}
+
+// Plugin docks start hidden with no content; showing one loads its plugin
+PluginDock *DockManager::createPluginDock(const DockPluginRegistry::Manifest &manifest)
+{
+    PluginDock *dock = new PluginDock(manifest, m_mainWindow);
+    m_pluginDocks.append(dock);
+    if (manifest.liveResize || LiveResizeFilter::isEnabledForType(manifest.type))
+        connect(dock, &PluginDock::contentCreated, m_liveResize, &LiveResizeFilter::watch);
+    connect(dock, &PluginDock::contentCreated, m_frameScheduler, [this, dock](QWidget *content) {
+        m_frameScheduler->add(dock, content);
+    });
+    registerDockWidget(dock, manifest.area);
+    dock->hide();
+    return dock;
+}
+
+void DockManager::registerDockWidget(QDockWidget *swatch, Qt::DockWidgetArea area)
+{
     m_dockWidgetAreas[swatch] = area;
     m_mainWindow->addDockWidget(area, swatch);
-    m_dockWidgets.append(swatch);
 
     connect(swatch, &QDockWidget::dockLocationChanged,
             this, &DockManager::handleDockLocationChanged);
     connect(swatch, &QDockWidget::topLevelChanged,
             this, [this, swatch](bool floating) {
+                emit dockWidgetFloated(swatch->objectName(), floating, swatch->pos());
+                // Floated natively by Qt, from a title bar drag for instance
+                if (floating && m_overlay)
+                    m_overlay->adoptWhenSettled(swatch);
                 if (!floating) {
                     QTimer::singleShot(0, this, [this, swatch]() {
                         updateDockWidgetSizeConstraints(swatch);
@@ -47,25 +181,69 @@ ColorSwatch* DockManager::createColorSwatch(const QString &colorName, Qt::DockWi
                 }
             });
 
+    // Report toggles made from the View menu or the dock title bar
+    connect(swatch->toggleViewAction(), &QAction::triggered, this, [this, swatch](bool checked) {
+        emit dockWidgetVisibilityChanged(swatch->objectName(), checked);
+    });
+
     swatch->installEventFilter(this);
-    emit dockWidgetCreated(swatch);
-    return swatch;
 }
 
-void DockManager::setupDockWidgets()
+static const struct {
+    const char *name;
+    Qt::DockWidgetArea area;
+} dockSettings[] = {
+    {"Black", Qt::LeftDockWidgetArea},
+    {"White", Qt::RightDockWidgetArea},
+    {"Red", Qt::TopDockWidgetArea},
+    {"Green", Qt::TopDockWidgetArea},
+    {"Blue", Qt::BottomDockWidgetArea},
+    {"Yellow", Qt::BottomDockWidgetArea}
+};
+
+QStringList DockManager::defaultDockNames()
 {
-    static const struct {
-        const char *name;
-        Qt::DockWidgetArea area;
-    } dockSettings[] = {
-        {"Black", Qt::LeftDockWidgetArea},
-        {"White", Qt::RightDockWidgetArea},
-        {"Red", Qt::TopDockWidgetArea},
-        {"Green", Qt::TopDockWidgetArea},
-        {"Blue", Qt::BottomDockWidgetArea},
-        {"Yellow", Qt::BottomDockWidgetArea}
-    };
+    QStringList names;
+    for (const auto &setting : dockSettings)
+        names.append(QString(setting.name) + "Dock");
+    for (const DockPluginRegistry::Manifest &manifest : DockPluginRegistry::instance()->manifests())
+        names.append(DockPluginRegistry::dockName(manifest.type));
+    return names;
+}
 
+QVector<MemoryAccounting::Entry> DockManager::memoryEntries() const
+{
+    QVector<MemoryAccounting::Entry> entries;
+    for (QDockWidget *swatch : allDockWidgets()) {
+        MemoryAccounting::Entry entry = MemoryAccounting::estimateObjectTree(swatch->objectName(), swatch);
+
+        // Map entries and the View menu action live here, not under the dock
+        int mapEntries = 0;
+        if (m_dockWidgetSizes.contains(swatch))
+            ++mapEntries;
+        if (m_dockWidgetAreas.contains(swatch))
+            ++mapEntries;
+        const QAction *viewAction = m_actionToDockWidgetMap.key(swatch);
+        if (viewAction) {
+            ++mapEntries;
+            entry.bytes += MemoryAccounting::kActionBytes;
+            ++entry.objects;
+        }
+        entry.bytes += mapEntries * MemoryAccounting::kMapEntryBytes;
+        // Slot in the dock's event filter list
+        entry.bytes += qint64(sizeof(void*));
+
+        const qint64 maskBytes = qint64(swatch->mask().rectCount()) * qint64(sizeof(QRect));
+        entry.bytes += maskBytes;
+        entry.detail = QString("%1 map entries, %2 B mask; title-bar pixmaps are shared and counted under pixmaps")
+                           .arg(mapEntries).arg(maskBytes);
+        entries.append(entry);
+    }
+    return entries;
+}
+
+void DockManager::setupDockWidgets()
+{
     for (const auto &setting : dockSettings) {
         ColorSwatch *swatch = createColorSwatch(setting.name, setting.area);
 
@@ -75,11 +253,19 @@ void DockManager::setupDockWidgets()
         m_actionToDockWidgetMap[action] = swatch;
         connect(action, &QAction::toggled, this, &DockManager::toggleDockWidgetVisibility);
     }
+
+    const QVector<DockPluginRegistry::Manifest> manifests = DockPluginRegistry::instance()->manifests();
+    if (!manifests.isEmpty())
+        m_viewMenu->addSeparator();
+    for (const DockPluginRegistry::Manifest &manifest : manifests) {
+        PluginDock *dock = createPluginDock(manifest);
+        m_viewMenu->addAction(dock->toggleViewAction());
+    }
 }
 
 void DockManager::setDockWidgetFeatures(const QString &name, QDockWidget::DockWidgetFeatures features)
 {
-    if (ColorSwatch *swatch = dockWidget(name)) {
+    if (QDockWidget *swatch = findDockWidget(name)) {
         swatch->setFeatures(features);
         emit dockWidgetFeaturesChanged(name, features);
     }
@@ -87,21 +273,21 @@ void DockManager::setDockWidgetFeatures(const QString &name, QDockWidget::DockWi
 
 void DockManager::setDockWidgetAllowedAreas(const QString &name, Qt::DockWidgetAreas areas)
 {
-    if (ColorSwatch *swatch = dockWidget(name)) {
+    if (QDockWidget *swatch = findDockWidget(name)) {
         swatch->setAllowedAreas(areas);
     }
 }
 
 void DockManager::setDockWidgetFloating(const QString &name, bool floating)
 {
-    if (ColorSwatch *swatch = dockWidget(name)) {
-        swatch->setFloating(floating);
+    if (QDockWidget *swatch = findDockWidget(name)) {
+        FloatingOverlay::setFloating(swatch, floating);
     }
 }
 
 void DockManager::setDockWidgetVisible(const QString &name, bool visible)
 {
-    if (ColorSwatch *swatch = dockWidget(name)) {
+    if (QDockWidget *swatch = findDockWidget(name)) {
         swatch->setVisible(visible);
         emit dockWidgetVisibilityChanged(name, visible);
     }
@@ -109,7 +295,7 @@ void DockManager::setDockWidgetVisible(const QString &name, bool visible)
 
 void DockManager::toggleDockWidget(const QString &name)
 {
-    if (ColorSwatch *swatch = dockWidget(name)) {
+    if (QDockWidget *swatch = findDockWidget(name)) {
         bool visible = !swatch->isVisible();
         swatch->setVisible(visible);
         emit dockWidgetVisibilityChanged(name, visible);
@@ -119,33 +305,40 @@ void DockManager::toggleDockWidget(const QString &name)
 bool DockManager::eventFilter(QObject *watched, QEvent *event)
 {
     if (event->type() == QEvent::Resize) {
-        ColorSwatch *swatch = qobject_cast<ColorSwatch*>(watched);
+        QDockWidget *swatch = qobject_cast<QDockWidget*>(watched);
         // if (swatch && !m_blockResizeUpdates && !m_sizesFixed) {
             m_dockWidgetSizes[swatch] = swatch->frameGeometry().size();
             updateTabbedGroupSizes(swatch);
         // }
+        if (!m_blockResizeUpdates) {
+            // Docks following a window resize are told apart by the solver
+            m_sizeSolver->invalidate();
+            emit dockWidgetResized(swatch->objectName(), swatch->frameGeometry().size());
+        }
+    } else if (event->type() == QEvent::Move) {
+        QDockWidget *swatch = qobject_cast<QDockWidget*>(watched);
+        if (swatch && FloatingOverlay::isFloating(swatch))
+            emit dockWidgetFloated(swatch->objectName(), true, FloatingOverlay::floatingGeometry(swatch).topLeft());
     }
     return QObject::eventFilter(watched, event);
 }
 
-void DockManager::handleDockWidgetResized(ColorSwatch *swatch)
+void DockManager::handleDockWidgetResized(QDockWidget *swatch)
 {
+    StallWatchdog::Scope scope("DockManager::handleDockWidgetResized");
     Qt::DockWidgetArea area = m_dockWidgetAreas.value(swatch, Qt::NoDockWidgetArea);
     m_dockWidgetSizes[swatch] = swatch->frameGeometry().size();
     updateTabbedGroupSizes(swatch);
 }
 
-void DockManager::updateTabbedGroupSizes(ColorSwatch *swatch)
+void DockManager::updateTabbedGroupSizes(QDockWidget *swatch)
 {
     QList<QDockWidget*> tabbedGroup = m_mainWindow->tabifiedDockWidgets(swatch);
     if (!tabbedGroup.isEmpty()) {
         m_blockResizeUpdates = true;
         for (QDockWidget *tabbedDock : tabbedGroup) {
-            ColorSwatch *tabbedSwatch = qobject_cast<ColorSwatch*>(tabbedDock);
-            if (tabbedSwatch) {
-                tabbedSwatch->resize(swatch->size());
-                m_dockWidgetSizes[tabbedSwatch] = swatch->frameGeometry().size();
-            }
+            tabbedDock->resize(swatch->size());
+            m_dockWidgetSizes[tabbedDock] = swatch->frameGeometry().size();
         }
         m_blockResizeUpdates = false;
     }
@@ -155,7 +348,7 @@ void DockManager::toggleDockWidgetVisibility(bool checked)
 {
     if (QAction *action = qobject_cast<QAction*>(sender())) {
         if (m_actionToDockWidgetMap.contains(action)) {
-            ColorSwatch *swatch = m_actionToDockWidgetMap[action];
+            QDockWidget *swatch = m_actionToDockWidgetMap[action];
             swatch->setVisible(checked);
             emit dockWidgetVisibilityChanged(swatch->objectName(), checked);
         }
@@ -164,129 +357,158 @@ void DockManager::toggleDockWidgetVisibility(bool checked)
 
 void DockManager::handleDockLocationChanged(Qt::DockWidgetArea area)
 {
-    if (ColorSwatch *swatch = qobject_cast<ColorSwatch*>(sender())) {
+    if (QDockWidget *swatch = qobject_cast<QDockWidget*>(sender())) {
         m_dockWidgetAreas[swatch] = area;
         updateDockWidgetSizeConstraints(swatch);
+        emit dockWidgetMoved(swatch->objectName(), area);
+
+        const QList<QDockWidget*> tabbedGroup = m_mainWindow->tabifiedDockWidgets(swatch);
+        if (!tabbedGroup.isEmpty())
+            emit dockWidgetTabified(swatch->objectName(), tabbedGroup.first()->objectName());
     }
 }
 
-void DockManager::updateDockWidgetSizeConstraints(ColorSwatch *swatch)
+void DockManager::updateDockWidgetSizeConstraints(QDockWidget *swatch)
 {
     if (!swatch) return;
 
-    if (m_sizesFixed) {
-        if (m_dockWidgetSizes.contains(swatch)) {
-            QSize frameSize = m_dockWidgetSizes[swatch];
-            QSize clientSize = frameSize - (swatch->frameGeometry().size() - swatch->size());
-            swatch->setMinimumSize(clientSize);
-            swatch->setMaximumSize(clientSize);
-        }
-    }
+    // Fixed sizes are kept by the solver on window resizes instead of
+    // minimum == maximum pins, which cost QMainWindow extra layout passes
+    // and left the central widget to absorb every change
+    if (m_sizesFixed)
+        m_sizeSolver->invalidate();
 }
 
-void DockManager::saveDockWidgetsLayout(QXmlStreamWriter &xmlWriter)
+void DockManager::saveDockWidgetsLayout(LayoutWriter &writer)
 {
-    xmlWriter.writeStartElement("DockWidgets");
-
-    QSet<QDockWidget*> savedDockWidgets;
-    for (ColorSwatch *dockWidget : m_dockWidgets) {
-        if (savedDockWidgets.contains(dockWidget)) continue;
-
-        xmlWriter.writeStartElement("DockWidget");
-        xmlWriter.writeAttribute("name", dockWidget->objectName());
-
-        // Save widget properties
-        saveWidgetProperties(xmlWriter, dockWidget->widget());
+    StallWatchdog::Scope scope("DockManager::saveDockWidgetsLayout");
+    writeDockWidgets(writer, m_mainWindow, allDockWidgets());
+}
 
-        QSize size = dockWidget->frameGeometry().size();
-        xmlWriter.writeStartElement("Size");
-        xmlWriter.writeTextElement("width", QString::number(size.width()));
-        xmlWriter.writeTextElement("height", QString::number(size.height()));
-        xmlWriter.writeEndElement();
+void DockManager::writeDockWidgets(LayoutWriter &writer, QMainWindow *mainWindow, const QList<QDockWidget*> &docks)
+{
+    writer.writeStartElement("DockWidgets");
+
+    // Written flags are looked up by binary search in a sorted copy, so the
+    // loop needs two allocations however many docks there are
+    QVector<QDockWidget*> sorted(docks.begin(), docks.end());
+    std::sort(sorted.begin(), sorted.end());
+    QVector<bool> written(sorted.size(), false);
+    auto writtenFlag = [&](QDockWidget *dockWidget) -> bool & {
+        return written[int(std::lower_bound(sorted.cbegin(), sorted.cend(), dockWidget) - sorted.cbegin())];
+    };
 
-        xmlWriter.writeTextElement("Title", dockWidget->windowTitle());
-        xmlWriter.writeTextElement("Visible", dockWidget->isVisible() ? "true" : "false");
-        xmlWriter.writeTextElement("Floating", dockWidget->isFloating() ? "true" : "false");
-        xmlWriter.writeTextElement("Features", QString::number(static_cast<int>(dockWidget->features())));
-        xmlWriter.writeTextElement("AllowedAreas", QString::number(static_cast<int>(dockWidget->allowedAreas())));
+    for (QDockWidget *dockWidget : docks) {
+        if (writtenFlag(dockWidget)) continue;
+        writtenFlag(dockWidget) = true;
+
+        writer.writeStartElement("DockWidget");
+        writer.writeAttribute("name", dockWidget->objectName());
+
+        saveWidgetProperties(writer, dockWidget->widget());
+
+        const QRect frame = dockWidget->frameGeometry();
+        writer.writeStartElement("Size");
+        writer.writeNumberElement("width", frame.width());
+        writer.writeNumberElement("height", frame.height());
+        writer.writeEndElement();
+
+        writer.writeTextElement("Title", dockWidget->windowTitle());
+        writer.writeBoolElement("Visible", dockWidget->isVisible());
+        const bool floating = FloatingOverlay::isFloating(dockWidget);
+        writer.writeBoolElement("Floating", floating);
+        writer.writeNumberElement("Features", static_cast<int>(dockWidget->features()));
+        writer.writeNumberElement("AllowedAreas", static_cast<int>(dockWidget->allowedAreas()));
+
+        if (floating) {
+            // Global in either floating mode, so layouts move between them
+            const QPoint position = FloatingOverlay::floatingGeometry(dockWidget).topLeft();
+            writer.writeStartElement("Geometry");
+            writer.writeNumberElement("x", position.x());
+            writer.writeNumberElement("y", position.y());
+            writer.writeEndElement();
+            // Floating docks are never tabbed, so tabifiedDockWidgets is skipped
+            writer.writeEndElement();
+            continue;
+        }
 
-        if (dockWidget->isFloating()) {
-            QRect geo = dockWidget->frameGeometry();
-            xmlWriter.writeStartElement("Geometry");
-            xmlWriter.writeTextElement("x", QString::number(geo.x()));
-            xmlWriter.writeTextElement("y", QString::number(geo.y()));
-            xmlWriter.writeEndElement();
-        } else {
-            QString areaStr;
-            switch (m_mainWindow->dockWidgetArea(dockWidget)) {
-            case Qt::LeftDockWidgetArea: areaStr = "Left"; break;
-            case Qt::RightDockWidgetArea: areaStr = "Right"; break;
-            case Qt::TopDockWidgetArea: areaStr = "Top"; break;
-            case Qt::BottomDockWidgetArea: areaStr = "Bottom"; break;
-            default: areaStr = "Floating";
-            }
-            xmlWriter.writeTextElement("DockArea", areaStr);
+        const char *area = "Floating";
+        switch (mainWindow->dockWidgetArea(dockWidget)) {
+        case Qt::LeftDockWidgetArea: area = "Left"; break;
+        case Qt::RightDockWidgetArea: area = "Right"; break;
+        case Qt::TopDockWidgetArea: area = "Top"; break;
+        case Qt::BottomDockWidgetArea: area = "Bottom"; break;
+        default: break;
         }
+        writer.writeTextElement("DockArea", area);
 
-        QList<QDockWidget*> tabbedGroup = m_mainWindow->tabifiedDockWidgets(dockWidget);
+        // Called once per tab group: the other members are written below
+        // and skipped when the loop reaches them
+        const QList<QDockWidget*> tabbedGroup = mainWindow->tabifiedDockWidgets(dockWidget);
         if (!tabbedGroup.isEmpty()) {
-            xmlWriter.writeStartElement("TabbedGroup");
+            writer.writeStartElement("TabbedGroup");
             for (QDockWidget *tabbedDock : tabbedGroup) {
-                xmlWriter.writeTextElement("DockWidget", tabbedDock->objectName());
-                savedDockWidgets.insert(tabbedDock);
+                writer.writeTextElement("DockWidget", tabbedDock->objectName());
+                writtenFlag(tabbedDock) = true;
             }
-            xmlWriter.writeEndElement();
+            writer.writeEndElement();
         }
 
-        xmlWriter.writeEndElement();
+        writer.writeEndElement();
     }
-    xmlWriter.writeEndElement();
+    writer.writeEndElement();
 }
 
-void DockManager::saveWidgetProperties(QXmlStreamWriter &xmlWriter, QWidget *widget)
+void DockManager::saveWidgetProperties(LayoutWriter &writer, QWidget *widget)
 {
     if (!widget) return;
 
-    xmlWriter.writeStartElement("WidgetProperties");
-
-    xmlWriter.writeTextElement("ObjectName", widget->objectName());
-    xmlWriter.writeTextElement("Geometry", QString("%1,%2,%3,%4")
-                                               .arg(widget->geometry().x())
-                                               .arg(widget->geometry().y())
-                                               .arg(widget->geometry().width())
-                                               .arg(widget->geometry().height()));
-    xmlWriter.writeTextElement("MinimumSize", QString("%1,%2")
-                                                  .arg(widget->minimumSize().width())
-                                                  .arg(widget->minimumSize().height()));
-    xmlWriter.writeTextElement("MaximumSize", QString("%1,%2")
-                                                  .arg(widget->maximumSize().width())
-                                                  .arg(widget->maximumSize().height()));
-
-    if (ColorDock *colorDock = qobject_cast<ColorDock*>(widget)) {
-        xmlWriter.writeTextElement("Color", colorDock->property("colorName").toString());
-    }
+    writer.writeStartElement("WidgetProperties");
 
-    xmlWriter.writeEndElement();
+    const QRect geometry = widget->geometry();
+    writer.writeTextElement("ObjectName", widget->objectName());
+    writer.writeNumbersElement("Geometry", { geometry.x(), geometry.y(), geometry.width(), geometry.height() });
+    writer.writeNumbersElement("MinimumSize", { widget->minimumWidth(), widget->minimumHeight() });
+    writer.writeNumbersElement("MaximumSize", { widget->maximumWidth(), widget->maximumHeight() });
+
+    WidgetState::save(writer, widget);
+
+    writer.writeEndElement();
 }
 
 void DockManager::loadDockWidgetsLayout(QXmlStreamReader &xmlReader)
+{
+    readDockWidgetsLayout(xmlReader, true);
+}
+
+void DockManager::loadDockWidgetProperties(QXmlStreamReader &xmlReader)
+{
+    readDockWidgetsLayout(xmlReader, false);
+}
+
+void DockManager::readDockWidgetsLayout(QXmlStreamReader &xmlReader, bool placeDocks)
 {
     qDebug() << "Starting layout load...";
-    m_sizesFixed = true;
+    // Proportions captured from the old arrangement mean nothing for the
+    // new one; the solver is back once the loaded sizes are in place
+    m_sizeSolver->setEnabled(false);
 
-    QMap<QString, ColorSwatch*> dockWidgetMap;
-    for (ColorSwatch *dockWidget : m_dockWidgets) {
+    QMap<QString, QDockWidget*> dockWidgetMap;
+    for (QDockWidget *dockWidget : allDockWidgets()) {
         dockWidgetMap[dockWidget->objectName()] = dockWidget;
         qDebug() << "Preparing dock widget:" << dockWidget->objectName()
                  << "Current size:" << dockWidget->size();
     }
 
-    QMap<ColorSwatch*, QList<ColorSwatch*>> tabbedGroups;
+    QMap<QDockWidget*, QList<QDockWidget*>> tabbedGroups;
 
     // First pass: Load all properties except sizes
     while (xmlReader.readNextStartElement()) {
         if (xmlReader.name() == "DockWidget") {
             QString name = xmlReader.attributes().value("name").toString();
+            // A layout that mentions a plugin dock needs its content now
+            if (PluginDock *pluginDock = qobject_cast<PluginDock*>(dockWidgetMap.value(name)))
+                pluginDock->ensureContent();
             QString title;
             bool visible = true;
             bool floating = false;
@@ -336,7 +558,7 @@ void DockManager::loadDockWidgetsLayout(QXmlStreamReader &xmlReader)
                         }
                     }
                 } else if (elementName == "TabbedGroup") {
-                    QList<ColorSwatch*> tabbedGroup;
+                    QList<QDockWidget*> tabbedGroup;
                     while (xmlReader.readNextStartElement()) {
                         if (xmlReader.name() == "DockWidget") {
                             QString tabbedName = xmlReader.readElementText();
@@ -352,15 +574,21 @@ void DockManager::loadDockWidgetsLayout(QXmlStreamReader &xmlReader)
             }
 
             if (dockWidgetMap.contains(name)) {
-                ColorSwatch *dockWidget = dockWidgetMap[name];
+                QDockWidget *dockWidget = dockWidgetMap[name];
                 m_blockResizeUpdates = true;
 
                 // Apply basic properties first
                 dockWidget->setWindowTitle(title);
-                dockWidget->setVisible(visible);
                 dockWidget->setFeatures(features);
                 dockWidget->setAllowedAreas(allowedAreas);
 
+                // Placement comes from the native state blob on the fast path
+                if (!placeDocks) {
+                    m_blockResizeUpdates = false;
+                    continue;
+                }
+                dockWidget->setVisible(visible);
+
                 // Store the size for later application
                 if (size.isValid()) {
                     m_dockWidgetSizes[dockWidget] = size;
@@ -368,10 +596,7 @@ void DockManager::loadDockWidgetsLayout(QXmlStreamReader &xmlReader)
                 }
 
                 if (floating) {
-                    dockWidget->setFloating(true);
-                    if (!floatingPos.isNull()) {
-                        dockWidget->move(floatingPos);
-                    }
+                    FloatingOverlay::setFloating(dockWidget, true, floatingPos);
                 } else {
                     Qt::DockWidgetArea area = Qt::LeftDockWidgetArea;
                     if (dockAreaStr == "Right") area = Qt::RightDockWidgetArea;
@@ -387,58 +612,31 @@ void DockManager::loadDockWidgetsLayout(QXmlStreamReader &xmlReader)
         }
     }
 
+    // The native state places the docks after this; the solver recaptures
+    // from whatever it produced at the next window resize
+    if (!placeDocks) {
+        m_sizeSolver->setEnabled(m_sizesFixed);
+        return;
+    }
+
     // Apply tabbed groups
     for (auto it = tabbedGroups.begin(); it != tabbedGroups.end(); ++it) {
-        for (ColorSwatch *tabbedDock : it.value()) {
+        for (QDockWidget *tabbedDock : it.value()) {
             m_mainWindow->tabifyDockWidget(it.key(), tabbedDock);
         }
     }
 
-    // Use a single-shot timer to apply sizes after a delay
-    QTimer::singleShot(100, this, [this]() {
-        applySavedSizesDelayed();
-    });
+    // Apply every saved size in one pass, so the first frame after a load
+    // already shows the final arrangement instead of settling over timers.
+    applyLayoutSizes();
 }
 
-void DockManager::applySavedSizesDelayed()
+void DockManager::applyLayoutSizes()
 {
-    qDebug() << "Applying saved sizes with delay...";
-    m_blockResizeUpdates = true;
-
-    // First pass: Apply minimum sizes
-    for (ColorSwatch *dockWidget : m_dockWidgets) {
-        if (m_dockWidgetSizes.contains(dockWidget)) {
-            QSize savedSize = m_dockWidgetSizes[dockWidget];
-            dockWidget->setMinimumSize(savedSize);
-            qDebug() << "Set minimum size for" << dockWidget->objectName()
-                     << "to" << savedSize;
-        }
-    }
-
-    // Second pass after a short delay
-    QTimer::singleShot(50, this, [this]() {
-        qDebug() << "Applying actual sizes...";
-        for (ColorSwatch *dockWidget : m_dockWidgets) {
-            if (m_dockWidgetSizes.contains(dockWidget)) {
-                QSize savedSize = m_dockWidgetSizes[dockWidget];
-                dockWidget->resize(savedSize);
-                qDebug() << "Set size for" << dockWidget->objectName()
-                         << "to" << savedSize << "actual size:" << dockWidget->size();
-            }
-        }
-
-        // Final pass to release constraints
-        QTimer::singleShot(100, this, [this]() {
-            qDebug() << "Releasing size constraints...";
-            m_sizesFixed = false;
-            m_blockResizeUpdates = false;
-            for (ColorSwatch *dockWidget : m_dockWidgets) {
-                updateDockWidgetSizeConstraints(dockWidget);
-                qDebug() << "Final size for" << dockWidget->objectName()
-                         << ":" << dockWidget->size();
-            }
-        });
-    });
+    StallWatchdog::Scope scope("DockManager::applyLayoutSizes");
+    applySavedSizes();
+    // Enabling recaptures the proportions, now from the loaded sizes
+    m_sizeSolver->setEnabled(m_sizesFixed);
 }
 
 void DockManager::loadWidgetProperties(QXmlStreamReader &xmlReader, QWidget *widget)
@@ -447,7 +645,6 @@ void DockManager::loadWidgetProperties(QXmlStreamReader &xmlReader, QWidget *wid
 
     QString objectName;
     QRect geometry;
-    QString color;
 
     while (xmlReader.readNextStartElement()) {
         if (xmlReader.name() == "ObjectName") {
@@ -458,36 +655,56 @@ void DockManager::loadWidgetProperties(QXmlStreamReader &xmlReader, QWidget *wid
                 geometry = QRect(geo[0].toInt(), geo[1].toInt(),
                                  geo[2].toInt(), geo[3].toInt());
             } 
+        } else if (xmlReader.name() == "Property") {
+            WidgetState::load(xmlReader, widget);
         } else if (xmlReader.name() == "Color") {
-            color = xmlReader.readElementText();
-        }  else {
+            // Layouts saved before content properties were generic
+            WidgetState::restore(widget, "colorName", xmlReader.readElementText());
+        } else {
             xmlReader.skipCurrentElement();
         }
     }
 
     widget->setObjectName(objectName);
     if (!geometry.isNull()) widget->setGeometry(geometry);
-    if (ColorDock *colorDock = qobject_cast<ColorDock*>(widget)) {
-
-    }
 }
 
 void DockManager::applySavedSizes()
 {
     m_blockResizeUpdates = true;
-    for (ColorSwatch *dockWidget : m_dockWidgets) {
-        if (m_dockWidgetSizes.contains(dockWidget)) {
-            QSize frameSize = m_dockWidgetSizes[dockWidget];
-            QSize clientSize = frameSize - (dockWidget->frameGeometry().size() - dockWidget->size());
-            dockWidget->setMinimumSize(clientSize);
-            dockWidget->setMaximumSize(clientSize);
-            dockWidget->resize(clientSize);
+
+    QList<QDockWidget*> docks;
+    QList<int> widths;
+    QList<int> heights;
+    for (QDockWidget *dockWidget : allDockWidgets()) {
+        if (!m_dockWidgetSizes.contains(dockWidget))
+            continue;
+        const QSize savedSize = m_dockWidgetSizes[dockWidget];
+        if (FloatingOverlay::isFloating(dockWidget)) {
+            dockWidget->resize(savedSize - (dockWidget->frameGeometry().size() - dockWidget->size()));
+            continue;
         }
+        if (m_mainWindow->dockWidgetArea(dockWidget) == Qt::NoDockWidgetArea)
+            continue;
+        docks.append(dockWidget);
+        widths.append(savedSize.width());
+        heights.append(savedSize.height());
+    }
+
+    if (!docks.isEmpty()) {
+        // Lay out against the restored window size first so the requested
+        // sizes are distributed over real area rects, even before show().
+        if (QLayout *layout = m_mainWindow->layout())
+            layout->activate();
+        m_mainWindow->resizeDocks(docks, widths, Qt::Horizontal);
+        m_mainWindow->resizeDocks(docks, heights, Qt::Vertical);
     }
+
     m_blockResizeUpdates = false;
+    m_sizeSolver->invalidate();
 }
 
-void DockManager::saveDockWidgetSize(ColorSwatch *swatch)
+void DockManager::saveDockWidgetSize(QDockWidget *swatch)
 {
     if (swatch) {
         m_dockWidgetSizes[swatch] = swatch->frameGeometry().size();
@@ -497,7 +714,7 @@ void DockManager::saveDockWidgetSize(ColorSwatch *swatch)
 
 QSize DockManager::savedDockWidgetSize(const QString &name) const
 {
-    if (ColorSwatch *swatch = dockWidget(name)) {
+    if (QDockWidget *swatch = findDockWidget(name)) {
         return m_dockWidgetSizes.value(swatch, swatch->frameGeometry().size());
     }
     return QSize();
@@ -507,8 +724,6 @@ void DockManager::setSizesFixed(bool fixed)
 {
     if (m_sizesFixed != fixed) {
         m_sizesFixed = fixed;
-        for (ColorSwatch *dockWidget : m_dockWidgets) {
-            updateDockWidgetSizeConstraints(dockWidget);
-        }
+        m_sizeSolver->setEnabled(fixed);
     }
 }
@@ -6,30 +6,73 @@
 #include <QMap>
 #include <QMenu>
 #include <QXmlStreamReader>
-#include <QXmlStreamWriter>
 #include <QMainWindow>
+#include <QPointer>
 #include "colorswatch.h"
+#include "layoutwriter.h"
+#include "memoryaccounting.h"
+#include "dockpluginregistry.h"
+
+class DockSizeSolver;
+class FloatingOverlay;
+class FrameScheduler;
+class LiveResizeFilter;
+class PluginDock;
 
 class DockManager : public QObject
 {
     Q_OBJECT
 
 public:
+    enum FloatingMode {
+        NativeFloating,    // one top-level window per floating dock
+        OverlayFloating    // panels in a FloatingOverlay over the main window
+    };
+
     explicit DockManager(QMainWindow *parent = nullptr);
     ~DockManager();
 
     void setupDockWidgets();
+    // Object names of the docks setupDockWidgets() creates, plugin docks included
+    static QStringList defaultDockNames();
     QMenu* viewMenu() const { return m_viewMenu; }
     QList<ColorSwatch*> dockWidgets() const { return m_dockWidgets; }
     ColorSwatch* dockWidget(const QString &name) const;
+    // Color swatches followed by plugin docks
+    QList<QDockWidget*> allDockWidgets() const;
+    QDockWidget *findDockWidget(const QString &name) const;
 
-    void saveDockWidgetSize(ColorSwatch *swatch);
+    void saveDockWidgetSize(QDockWidget *swatch);
     QSize savedDockWidgetSize(const QString &name) const;
+    // While sizes are fixed, window resizes keep the docks in proportion
     void setSizesFixed(bool fixed);
+    DockSizeSolver *sizeSolver() const { return m_sizeSolver; }
+
+    // Feeds a color swatch from a producer thread; nullptr detaches it.
+    // The feed must outlive the dock or be detached first.
+    bool setDockFeed(const QString &name, ColorFeed *feed);
+    // Repaints dock content at the display rate; see FrameScheduler
+    FrameScheduler *frameScheduler() const { return m_frameScheduler; }
+
+    // Switching moves the docks floating now into the new mode
+    void setFloatingMode(FloatingMode mode);
+    FloatingMode floatingMode() const { return m_overlay ? OverlayFloating : NativeFloating; }
+    FloatingOverlay *floatingOverlay() const { return m_overlay; }
+    // Native floating docks are windows of their own and stay on screen
+    // when the workspace is switched away; these hide and restore them
+    void suspendFloatingDocks();
+    void resumeFloatingDocks();
+
+    // The <DockWidgets> element for docks, written by saveDockWidgetsLayout
+    static void writeDockWidgets(LayoutWriter &writer, QMainWindow *mainWindow, const QList<QDockWidget*> &docks);
+
+    // One entry per dock: its widget tree plus what this manager keeps for it
+    QVector<MemoryAccounting::Entry> memoryEntries() const;
 
 public slots:
-    void saveDockWidgetsLayout(QXmlStreamWriter &xmlWriter);
+    void saveDockWidgetsLayout(LayoutWriter &writer);
     void loadDockWidgetsLayout(QXmlStreamReader &xmlReader);
+    void loadDockWidgetProperties(QXmlStreamReader &xmlReader);
     void applySavedSizes();
     void setDockWidgetFeatures(const QString &name, QDockWidget::DockWidgetFeatures features);
     void setDockWidgetAllowedAreas(const QString &name, Qt::DockWidgetAreas areas);
@@ -41,6 +84,12 @@ signals:
     void dockWidgetCreated(ColorSwatch *swatch);
     void dockWidgetFeaturesChanged(const QString &name, QDockWidget::DockWidgetFeatures features);
     void dockWidgetVisibilityChanged(const QString &name, bool visible);
+    // Arrangement changes, whether made by the user or through this API
+    void dockWidgetMoved(const QString &name, Qt::DockWidgetArea area);
+    void dockWidgetTabified(const QString &name, const QString &target);
+    void dockWidgetSplit(const QString &name, const QString &target, Qt::Orientation orientation);
+    void dockWidgetFloated(const QString &name, bool floating, const QPoint &position);
+    void dockWidgetResized(const QString &name, const QSize &size);
 
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
@@ -51,20 +100,29 @@ private slots:
 
 private:
     ColorSwatch* createColorSwatch(const QString &colorName, Qt::DockWidgetArea area);
+    PluginDock *createPluginDock(const DockPluginRegistry::Manifest &manifest);
+    void registerDockWidget(QDockWidget *swatch, Qt::DockWidgetArea area);
     void setupDockWidgetProperties(ColorSwatch *swatch);
-    void updateDockWidgetSizeConstraints(ColorSwatch *swatch);
-    void updateTabbedGroupSizes(ColorSwatch *swatch);
-    void handleDockWidgetResized(ColorSwatch *swatch);
-    void saveWidgetProperties(QXmlStreamWriter &xmlWriter, QWidget *widget);
+    void updateDockWidgetSizeConstraints(QDockWidget *swatch);
+    void updateTabbedGroupSizes(QDockWidget *swatch);
+    void handleDockWidgetResized(QDockWidget *swatch);
+    static void saveWidgetProperties(LayoutWriter &writer, QWidget *widget);
     void loadWidgetProperties(QXmlStreamReader &xmlReader, QWidget *widget);
-    void applySavedSizesDelayed();  // Add this line
+    void readDockWidgetsLayout(QXmlStreamReader &xmlReader, bool placeDocks);
+    void applyLayoutSizes();
     bool m_sizesFixed = true;
     QMainWindow *m_mainWindow;
     QMenu *m_viewMenu;
+    DockSizeSolver *m_sizeSolver;
+    LiveResizeFilter *m_liveResize;
+    FrameScheduler *m_frameScheduler;
+    FloatingOverlay *m_overlay = nullptr;
+    QList<QPointer<QDockWidget>> m_suspendedDocks;
     QList<ColorSwatch*> m_dockWidgets;
-    QMap<QAction*, ColorSwatch*> m_actionToDockWidgetMap;
-    QMap<ColorSwatch*, QSize> m_dockWidgetSizes;
-    QMap<ColorSwatch*, Qt::DockWidgetArea> m_dockWidgetAreas;
+    QList<PluginDock*> m_pluginDocks;
+    QMap<QAction*, QDockWidget*> m_actionToDockWidgetMap;
+    QMap<QDockWidget*, QSize> m_dockWidgetSizes;
+    QMap<QDockWidget*, Qt::DockWidgetArea> m_dockWidgetAreas;
     bool m_blockResizeUpdates = false;
 };
 
@@ -0,0 +1,139 @@
+#include "dockpluginregistry.h"
+#include "dockcontentinterface.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLibrary>
+#include <QLoggingCategory>
+#include <QPluginLoader>
+#include <QWidget>
+
+Q_LOGGING_CATEGORY(lcPlugins, "mainwindows.plugins", QtWarningMsg)
+
+DockPluginRegistry::DockPluginRegistry(QObject *parent)
+    : QObject(parent)
+{
+    scan();
+}
+
+DockPluginRegistry *DockPluginRegistry::instance()
+{
+    static DockPluginRegistry *registry = new DockPluginRegistry(QCoreApplication::instance());
+    return registry;
+}
+
+QStringList DockPluginRegistry::searchPaths()
+{
+    QStringList paths;
+    if (QCoreApplication::instance())
+        paths.append(QCoreApplication::applicationDirPath() + "/plugins/docks");
+    const QString extra = qEnvironmentVariable("MAINWINDOWS_DOCK_PLUGIN_PATH");
+    if (!extra.isEmpty())
+        paths += extra.split(QDir::listSeparator(), Qt::SkipEmptyParts);
+    return paths;
+}
+
+void DockPluginRegistry::scan()
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString &path : searchPaths()) {
+        const QDir dir(path);
+        const QStringList entries = dir.entryList(QDir::Files);
+        for (const QString &entry : entries) {
+            const QString fileName = dir.absoluteFilePath(entry);
+            if (QLibrary::isLibrary(fileName))
+                readManifest(fileName);
+        }
+    }
+    qCDebug(lcPlugins).noquote() << QString("Read %1 dock plugin manifest(s) in %2 ms")
+                                        .arg(m_manifests.size()).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 2);
+}
+
+// QPluginLoader::metaData() reads the embedded JSON without loading the library
+void DockPluginRegistry::readManifest(const QString &fileName)
+{
+    QPluginLoader *loader = new QPluginLoader(fileName, this);
+    const QJsonObject metaData = loader->metaData();
+    if (metaData.value("IID").toString() != QLatin1String(DockContentInterface_iid)) {
+        delete loader;
+        return;
+    }
+
+    const QJsonArray docks = metaData.value("MetaData").toObject().value("docks").toArray();
+    for (const QJsonValue &value : docks) {
+        const QJsonObject object = value.toObject();
+        Manifest manifest;
+        manifest.type = object.value("type").toString();
+        if (manifest.type.isEmpty())
+            continue;
+        manifest.title = object.value("title").toString(manifest.type);
+        const QString area = object.value("area").toString();
+        if (area == "Left")
+            manifest.area = Qt::LeftDockWidgetArea;
+        else if (area == "Top")
+            manifest.area = Qt::TopDockWidgetArea;
+        else if (area == "Bottom")
+            manifest.area = Qt::BottomDockWidgetArea;
+        const QString icon = object.value("icon").toString();
+        if (!icon.isEmpty())
+            manifest.iconPath = QFileInfo(fileName).dir().filePath(icon);
+        manifest.fileName = fileName;
+        manifest.liveResize = object.value("liveResize").toBool();
+        m_manifests.append(manifest);
+    }
+    m_loaders.insert(fileName, loader);
+}
+
+// When several plugins provide a type, the first one found wins
+const DockPluginRegistry::Manifest *DockPluginRegistry::findManifest(const QString &type) const
+{
+    for (const Manifest &manifest : m_manifests) {
+        if (manifest.type == type)
+            return &manifest;
+    }
+    return nullptr;
+}
+
+bool DockPluginRegistry::isLoaded(const QString &type) const
+{
+    const Manifest *manifest = findManifest(type);
+    return manifest && m_loaders.value(manifest->fileName)->isLoaded();
+}
+
+QWidget *DockPluginRegistry::createContent(const QString &type, QWidget *parent, QString *errorString)
+{
+    const Manifest *manifest = findManifest(type);
+    if (!manifest) {
+        if (errorString)
+            *errorString = tr("No plugin provides dock type %1").arg(type);
+        return nullptr;
+    }
+
+    QPluginLoader *loader = m_loaders.value(manifest->fileName);
+    const bool wasLoaded = loader->isLoaded();
+    QElapsedTimer timer;
+    timer.start();
+    DockContentInterface *provider = qobject_cast<DockContentInterface*>(loader->instance());
+    if (!provider) {
+        if (errorString)
+            *errorString = tr("Failed to load %1: %2").arg(manifest->fileName, loader->errorString());
+        qWarning().noquote() << "Failed to load dock plugin" << manifest->fileName << loader->errorString();
+        return nullptr;
+    }
+    if (!wasLoaded) {
+        qCDebug(lcPlugins).noquote() << QString("Loaded dock plugin %1 in %2 ms")
+                                            .arg(QFileInfo(manifest->fileName).fileName())
+                                            .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 2);
+    }
+
+    timer.restart();
+    QWidget *content = provider->createContent(type, parent);
+    qCDebug(lcPlugins).noquote() << QString("Created %1 dock content in %2 ms")
+                                        .arg(type).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 2);
+    return content;
+}
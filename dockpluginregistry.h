@@ -0,0 +1,56 @@
+#ifndef DOCKPLUGINREGISTRY_H
+#define DOCKPLUGINREGISTRY_H
+
+#include <QObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QPluginLoader;
+class QWidget;
+
+// Process-wide list of dock content plugins. Startup only reads each
+// plugin's metadata; the library itself is loaded the first time one of
+// its docks needs content.
+class DockPluginRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Manifest
+    {
+        QString type;
+        QString title;
+        Qt::DockWidgetArea area = Qt::RightDockWidgetArea;
+        QString iconPath;
+        QString fileName;
+        // Draw from a scaled snapshot while the dock is being resized
+        bool liveResize = false;
+    };
+
+    static DockPluginRegistry *instance();
+
+    // Application plugins/docks directory plus MAINWINDOWS_DOCK_PLUGIN_PATH
+    static QStringList searchPaths();
+    // Object name of the dock showing a content type
+    static QString dockName(const QString &type) { return type + "Dock"; }
+
+    QVector<Manifest> manifests() const { return m_manifests; }
+    bool isLoaded(const QString &type) const;
+
+    // Loads the providing library if needed; returns nullptr and sets
+    // errorString when the plugin cannot be loaded.
+    QWidget *createContent(const QString &type, QWidget *parent, QString *errorString = nullptr);
+
+private:
+    explicit DockPluginRegistry(QObject *parent = nullptr);
+    void scan();
+    void readManifest(const QString &fileName);
+    const Manifest *findManifest(const QString &type) const;
+
+    QVector<Manifest> m_manifests;
+    QMap<QString, QPluginLoader*> m_loaders; // by plugin file name
+};
+
+#endif // DOCKPLUGINREGISTRY_H
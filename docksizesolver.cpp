@@ -0,0 +1,326 @@
+#include "docksizesolver.h"
+#include "stallwatchdog.h"
+#include <QDockWidget>
+#include <QLayout>
+#include <QMainWindow>
+#include <QResizeEvent>
+#include <QStyle>
+#include <algorithm>
+#include <climits>
+
+static const Qt::DockWidgetArea kAreas[] = {
+    Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+};
+
+static int areaIndex(Qt::DockWidgetArea area)
+{
+    for (int i = 0; i < 4; ++i) {
+        if (kAreas[i] == area)
+            return i;
+    }
+    return -1;
+}
+
+// Left and right areas stack their rows vertically
+static bool isVerticalArea(int index)
+{
+    return index < 2;
+}
+
+DockSizeSolver::DockSizeSolver(QMainWindow *parent)
+    : QObject(parent), m_mainWindow(parent)
+{
+    // Zero interval: the capture runs once the pending events are handled
+    m_captureTimer.setSingleShot(true);
+    m_captureTimer.setInterval(0);
+    connect(&m_captureTimer, &QTimer::timeout, this, &DockSizeSolver::captureCurrent);
+    m_mainWindow->installEventFilter(this);
+}
+
+void DockSizeSolver::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    m_windowSize = QSize();
+    if (enabled)
+        m_captureTimer.start();
+    else
+        m_captureTimer.stop();
+}
+
+// The layout resizes the docks for a new window size before the solver
+// sees the window resize, so a window that no longer has the size of the
+// proportions means the docks are following it, not the user
+void DockSizeSolver::invalidate()
+{
+    if (!m_enabled || m_solving)
+        return;
+    if (m_windowSize.isValid() && m_mainWindow->size() != m_windowSize)
+        return;
+    m_captureTimer.start();
+}
+
+void DockSizeSolver::captureCurrent()
+{
+    if (m_enabled)
+        capture(m_mainWindow->size());
+}
+
+void DockSizeSolver::distribute(int total, const QVector<int> &minimums, const QVector<double> &weights, QVector<int> *parts)
+{
+    const int count = minimums.size();
+    parts->resize(count);
+    if (count == 0)
+        return;
+
+    qint64 minimumSum = 0;
+    double weightSum = 0.0;
+    for (int i = 0; i < count; ++i) {
+        minimumSum += minimums.at(i);
+        weightSum += weights.at(i);
+    }
+
+    // Too small for the minimums: shrink them all by the same factor
+    if (total <= minimumSum) {
+        qint64 accumulated = 0;
+        int previous = 0;
+        for (int i = 0; i < count; ++i) {
+            accumulated += minimums.at(i);
+            const int upTo = minimumSum > 0 ? int(qMax<qint64>(0, total) * accumulated / minimumSum) : 0;
+            (*parts)[i] = upTo - previous;
+            previous = upTo;
+        }
+        return;
+    }
+
+    // Rounding the running total rather than each part keeps the sum exact
+    const int extra = total - int(minimumSum);
+    double accumulated = 0.0;
+    int previous = 0;
+    for (int i = 0; i < count; ++i) {
+        accumulated += weightSum > 0.0 ? extra * weights.at(i) / weightSum : double(extra) / count;
+        const int upTo = i == count - 1 ? extra : qRound(accumulated);
+        (*parts)[i] = minimums.at(i) + upTo - previous;
+        previous = upTo;
+    }
+}
+
+void DockSizeSolver::capture(const QSize &windowSize)
+{
+    m_docks.clear();
+    for (Area &area : m_areas)
+        area = Area();
+
+    QVector<QDockWidget*> areaDocks[4];
+    QRect region = m_mainWindow->centralWidget() ? m_mainWindow->centralWidget()->geometry() : QRect();
+    const QList<QDockWidget*> docks = m_mainWindow->findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly);
+    for (QDockWidget *dock : docks) {
+        if (dock->isFloating() || !dock->isVisible())
+            continue;
+        const int index = areaIndex(m_mainWindow->dockWidgetArea(dock));
+        if (index < 0)
+            continue;
+        areaDocks[index].append(dock);
+        region |= dock->geometry();
+    }
+    m_chrome = (windowSize - region.size()).expandedTo(QSize(0, 0));
+    m_separator = m_mainWindow->style()->pixelMetric(QStyle::PM_DockWidgetSeparatorExtent, nullptr, m_mainWindow);
+
+    for (int index = 0; index < 4; ++index) {
+        QVector<QDockWidget*> &inArea = areaDocks[index];
+        if (inArea.isEmpty())
+            continue;
+        const bool vertical = isVerticalArea(index);
+        auto lengthStart = [vertical](QDockWidget *dock) { return vertical ? dock->y() : dock->x(); };
+        auto thicknessStart = [vertical](QDockWidget *dock) { return vertical ? dock->x() : dock->y(); };
+        std::sort(inArea.begin(), inArea.end(), [&](QDockWidget *a, QDockWidget *b) {
+            if (lengthStart(a) != lengthStart(b))
+                return lengthStart(a) < lengthStart(b);
+            return thicknessStart(a) < thicknessStart(b);
+        });
+
+        Area &area = m_areas[index];
+        int thicknessFrom = INT_MAX;
+        int thicknessTo = INT_MIN;
+        int rowEnd = INT_MIN;
+        for (QDockWidget *dock : qAsConst(inArea)) {
+            const QSize minimum = dock->minimumSize().expandedTo(dock->minimumSizeHint());
+            const QSize preferred = dock->sizeHint();
+            QSize size = dock->size();
+            // Docks not laid out yet count with their preferred size
+            if (size.isEmpty())
+                size = preferred;
+            const int length = vertical ? size.height() : size.width();
+            const int thickness = vertical ? size.width() : size.height();
+            const int minimumLength = vertical ? minimum.height() : minimum.width();
+            const int minimumThickness = vertical ? minimum.width() : minimum.height();
+
+            // Docks overlapping along the area length sit side by side in one row
+            if (area.rows.isEmpty() || lengthStart(dock) >= rowEnd) {
+                Row row;
+                row.firstDock = m_docks.size();
+                area.rows.append(row);
+            }
+            Row &row = area.rows.last();
+            row.dockCount++;
+            row.minimumLength = qMax(row.minimumLength, minimumLength);
+            row.lengthWeight = qMax(row.lengthWeight, double(qMax(0, length - minimumLength)));
+            rowEnd = qMax(rowEnd, lengthStart(dock) + length);
+
+            Dock entry;
+            entry.dock = dock;
+            entry.minimumThickness = minimumThickness;
+            entry.thicknessWeight = qMax(0, thickness - minimumThickness);
+            m_docks.append(entry);
+
+            thicknessFrom = qMin(thicknessFrom, thicknessStart(dock));
+            thicknessTo = qMax(thicknessTo, thicknessStart(dock) + thickness);
+        }
+
+        for (const Row &row : qAsConst(area.rows)) {
+            int minimum = m_separator * (row.dockCount - 1);
+            for (int i = row.firstDock; i < row.firstDock + row.dockCount; ++i)
+                minimum += m_docks.at(i).minimumThickness;
+            area.minimumThickness = qMax(area.minimumThickness, minimum);
+        }
+        const int dimension = vertical ? region.width() : region.height();
+        area.share = dimension > 0 ? double(thicknessTo - thicknessFrom) / dimension : 0.0;
+    }
+    m_windowSize = windowSize;
+}
+
+void DockSizeSolver::solve(const QSize &windowSize, QList<QDockWidget*> *docks, QList<int> *widths, QList<int> *heights)
+{
+    if (!m_windowSize.isValid())
+        capture(m_mainWindow->size());
+
+    const QSize available = (windowSize - m_chrome).expandedTo(QSize(0, 0));
+    const QSize centralMinimum = m_mainWindow->centralWidget()
+                                     ? m_mainWindow->centralWidget()->minimumSizeHint().expandedTo(QSize(0, 0))
+                                     : QSize(0, 0);
+
+    // Area thickness from its share, then squeezed if the central widget
+    // would drop below its minimum
+    int thickness[4] = { 0, 0, 0, 0 };
+    QVector<int> pairMinimums(2);
+    QVector<double> pairWeights(2);
+    QVector<int> pairParts;
+    for (int first : { 0, 2 }) {
+        const int dimension = isVerticalArea(first) ? available.width() : available.height();
+        const int central = isVerticalArea(first) ? centralMinimum.width() : centralMinimum.height();
+        int used = 0;
+        int separators = 0;
+        for (int index = first; index < first + 2; ++index) {
+            const Area &area = m_areas[index];
+            if (area.rows.isEmpty())
+                continue;
+            thickness[index] = qMax(area.minimumThickness, qRound(area.share * dimension));
+            used += thickness[index];
+            separators += m_separator;
+        }
+        if (used + separators > dimension - central) {
+            for (int i = 0; i < 2; ++i) {
+                pairMinimums[i] = m_areas[first + i].rows.isEmpty() ? 0 : m_areas[first + i].minimumThickness;
+                pairWeights[i] = thickness[first + i] - pairMinimums[i];
+            }
+            distribute(dimension - central - separators, pairMinimums, pairWeights, &pairParts);
+            thickness[first] = pairParts.at(0);
+            thickness[first + 1] = pairParts.at(1);
+        }
+    }
+
+    docks->clear();
+    widths->clear();
+    heights->clear();
+    docks->reserve(m_docks.size());
+    widths->reserve(m_docks.size());
+    heights->reserve(m_docks.size());
+
+    QVector<int> minimums;
+    QVector<double> weights;
+    QVector<int> rowLengths;
+    QVector<int> dockThickness;
+    for (int index = 0; index < 4; ++index) {
+        const Area &area = m_areas[index];
+        if (area.rows.isEmpty())
+            continue;
+        const bool vertical = isVerticalArea(index);
+
+        // With the default corners the top and bottom areas span the full
+        // width and the side areas get the height between them
+        int length = vertical ? available.height() : available.width();
+        if (vertical) {
+            for (int across : { 2, 3 }) {
+                if (!m_areas[across].rows.isEmpty())
+                    length -= thickness[across] + m_separator;
+            }
+        }
+
+        minimums.resize(area.rows.size());
+        weights.resize(area.rows.size());
+        for (int r = 0; r < area.rows.size(); ++r) {
+            minimums[r] = area.rows.at(r).minimumLength;
+            weights[r] = area.rows.at(r).lengthWeight;
+        }
+        distribute(length - m_separator * (area.rows.size() - 1), minimums, weights, &rowLengths);
+
+        for (int r = 0; r < area.rows.size(); ++r) {
+            const Row &row = area.rows.at(r);
+            minimums.resize(row.dockCount);
+            weights.resize(row.dockCount);
+            for (int i = 0; i < row.dockCount; ++i) {
+                minimums[i] = m_docks.at(row.firstDock + i).minimumThickness;
+                weights[i] = m_docks.at(row.firstDock + i).thicknessWeight;
+            }
+            distribute(thickness[index] - m_separator * (row.dockCount - 1), minimums, weights, &dockThickness);
+
+            for (int i = 0; i < row.dockCount; ++i) {
+                docks->append(m_docks.at(row.firstDock + i).dock);
+                widths->append(vertical ? dockThickness.at(i) : rowLengths.at(r));
+                heights->append(vertical ? rowLengths.at(r) : dockThickness.at(i));
+            }
+        }
+    }
+}
+
+bool DockSizeSolver::apply(const QSize &windowSize)
+{
+    QList<QDockWidget*> docks;
+    QList<int> widths;
+    QList<int> heights;
+    solve(windowSize, &docks, &widths, &heights);
+    if (docks.isEmpty())
+        return false;
+    m_mainWindow->resizeDocks(docks, widths, Qt::Horizontal);
+    m_mainWindow->resizeDocks(docks, heights, Qt::Vertical);
+    return true;
+}
+
+bool DockSizeSolver::eventFilter(QObject *watched, QEvent *event)
+{
+    // The layout has already handled the resize, so the solved sizes take
+    // one more layout pass. They come from the proportions captured before
+    // the resize, never from the docks the layout just stretched.
+    if (m_enabled && watched == m_mainWindow && event->type() == QEvent::Resize) {
+        QResizeEvent *resizeEvent = static_cast<QResizeEvent*>(event);
+        if (!resizeEvent->oldSize().isValid() || !m_windowSize.isValid()) {
+            m_windowSize = QSize();
+            m_captureTimer.start();
+            return QObject::eventFilter(watched, event);
+        }
+        // A change from this same turn is not captured yet and the layout
+        // has overwritten it; the last proportions win
+        m_captureTimer.stop();
+        StallWatchdog::Scope scope("DockSizeSolver::apply");
+        m_solving = true;
+        m_solving = apply(resizeEvent->size());
+        m_windowSize = resizeEvent->size();
+    } else if (m_solving && watched == m_mainWindow && event->type() == QEvent::LayoutRequest) {
+        // resizeDocks() posted this relayout; once it is done, dock resizes
+        // are the user's again. Activating here makes that independent of
+        // whether the layout has seen the event yet.
+        if (QLayout *layout = m_mainWindow->layout())
+            layout->activate();
+        m_solving = false;
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,87 @@
+#ifndef DOCKSIZESOLVER_H
+#define DOCKSIZESOLVER_H
+
+#include <QObject>
+#include <QList>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+
+class QDockWidget;
+class QMainWindow;
+
+// Keeps the docks of a main window at their proportions when the window
+// is resized. Proportions are captured on the idle turn after the user
+// changed a dock: per dock area its share of the window, per row its share
+// of the area length and per dock its share of the row. QMainWindow has
+// laid out a new window size before the solver sees the resize, with the
+// central widget absorbing the change; every dock size is then computed
+// in one linear pass, honouring minimum sizes, and handed to resizeDocks()
+// for a single relayout, so no constraint passes are needed.
+class DockSizeSolver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DockSizeSolver(QMainWindow *parent);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    // Recapture the proportions on the next idle turn; call when the user
+    // moved, resized, showed or hid a dock. Ignored for the solver's own
+    // changes and for docks following a window resize.
+    void invalidate();
+    bool isSolving() const { return m_solving; }
+
+    // Sizes of every docked, visible dock for the given window size
+    void solve(const QSize &windowSize, QList<QDockWidget*> *docks, QList<int> *widths, QList<int> *heights);
+    // False when there was no dock to resize
+    bool apply(const QSize &windowSize);
+
+    // Splits total into parts of at least minimums[i], sharing what is left
+    // by weights[i]. Parts always add up to total.
+    static void distribute(int total, const QVector<int> &minimums, const QVector<double> &weights, QVector<int> *parts);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Dock
+    {
+        QDockWidget *dock = nullptr;
+        int minimumThickness = 0;
+        double thicknessWeight = 0.0;
+    };
+
+    struct Row
+    {
+        int firstDock = 0;
+        int dockCount = 0;
+        int minimumLength = 0;
+        double lengthWeight = 0.0;
+    };
+
+    struct Area
+    {
+        double share = 0.0; // thickness over the window dimension
+        int minimumThickness = 0;
+        QVector<Row> rows;
+    };
+
+    void capture(const QSize &windowSize);
+    void captureCurrent();
+
+    QMainWindow *m_mainWindow;
+    QVector<Dock> m_docks;
+    Area m_areas[4];
+    QSize m_chrome;
+    int m_separator = 0;
+    // Window size the proportions were captured or last solved for
+    QSize m_windowSize;
+    QTimer m_captureTimer;
+    bool m_enabled = false;
+    bool m_solving = false;
+};
+
+#endif // DOCKSIZESOLVER_H
@@ -0,0 +1,168 @@
+#include "findbar.h"
+#include "logview.h"
+#include "textsearch.h"
+#include <QAction>
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+
+// Typing pause before a search starts
+static const int kSearchDelayMs = 150;
+
+FindBar::FindBar(QWidget *parent)
+    : QToolBar(tr("Find"), parent)
+{
+    setObjectName("FindBar");
+    setMovable(false);
+    setFloatable(false);
+    setAllowedAreas(Qt::BottomToolBarArea);
+
+    m_search = new TextSearch(this);
+    connect(m_search, &TextSearch::matchesFound, this, [this](const QVector<TextSearch::Match> &matches) {
+        if (m_view)
+            m_view->addMatches(matches);
+        updateStatus();
+    });
+    connect(m_search, &TextSearch::finished, this, &FindBar::handleSearchFinished);
+
+    m_patternEdit = new QLineEdit(this);
+    m_patternEdit->setPlaceholderText(tr("Find in log"));
+    m_patternEdit->setClearButtonEnabled(true);
+    m_patternEdit->setMaximumWidth(320);
+    addWidget(m_patternEdit);
+    addAction(tr("Previous"), this, &FindBar::findPrevious);
+    addAction(tr("Next"), this, &FindBar::findNext);
+    m_caseCheck = new QCheckBox(tr("Match case"), this);
+    addWidget(m_caseCheck);
+    m_regexCheck = new QCheckBox(tr("Regular expression"), this);
+    addWidget(m_regexCheck);
+    addSeparator();
+    m_statusLabel = new QLabel(this);
+    addWidget(m_statusLabel);
+
+    QWidget *spacer = new QWidget(this);
+    spacer->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+    addWidget(spacer);
+    QAction *closeAction = addAction(tr("Close"), this, &FindBar::dismiss);
+    closeAction->setShortcut(QKeySequence(Qt::Key_Escape));
+    closeAction->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+
+    m_searchDelay.setSingleShot(true);
+    m_searchDelay.setInterval(kSearchDelayMs);
+    connect(&m_searchDelay, &QTimer::timeout, this, &FindBar::startSearch);
+    connect(m_patternEdit, &QLineEdit::textChanged, &m_searchDelay, qOverload<>(&QTimer::start));
+    connect(m_caseCheck, &QCheckBox::toggled, this, &FindBar::startSearch);
+    connect(m_regexCheck, &QCheckBox::toggled, this, &FindBar::startSearch);
+    connect(m_patternEdit, &QLineEdit::returnPressed, this, &FindBar::findNext);
+}
+
+void FindBar::setView(LogView *view)
+{
+    if (view == m_view)
+        return;
+    m_search->cancel();
+    if (m_view) {
+        disconnect(m_view, nullptr, this, nullptr);
+        m_view->clearMatches();
+    }
+    m_view = view;
+    // A reopened or different file invalidates the matches
+    if (m_view)
+        connect(m_view, &LogView::fileChanged, this, &FindBar::startSearch);
+    if (isVisible())
+        startSearch();
+}
+
+void FindBar::activate()
+{
+    show();
+    m_patternEdit->setFocus();
+    m_patternEdit->selectAll();
+    if (m_view && m_view->matchCount() == 0 && !m_patternEdit->text().isEmpty())
+        startSearch();
+}
+
+void FindBar::findNext()
+{
+    // Enter right after typing should not wait for the pause
+    if (m_searchDelay.isActive()) {
+        m_searchDelay.stop();
+        startSearch();
+    }
+    if (m_view && m_view->showNextMatch())
+        updateStatus();
+}
+
+void FindBar::findPrevious()
+{
+    if (m_view && m_view->showNextMatch(true))
+        updateStatus();
+}
+
+void FindBar::dismiss()
+{
+    m_searchDelay.stop();
+    m_search->cancel();
+    if (m_view) {
+        m_view->clearMatches();
+        m_view->setFocus();
+    }
+    hide();
+}
+
+void FindBar::startSearch()
+{
+    m_searchDelay.stop();
+    m_search->cancel();
+    m_totalMatches = -1;
+    m_throughput.clear();
+    if (!m_view)
+        return;
+    m_view->clearMatches();
+
+    const QString pattern = m_patternEdit->text();
+    if (pattern.isEmpty() || m_view->fileName().isEmpty()) {
+        m_statusLabel->clear();
+        return;
+    }
+    TextSearch::Options options;
+    if (m_caseCheck->isChecked())
+        options |= TextSearch::CaseSensitive;
+    if (m_regexCheck->isChecked())
+        options |= TextSearch::RegularExpression;
+    if (!m_search->start(m_view->fileName(), pattern, options)) {
+        m_statusLabel->setText(m_search->errorString());
+        return;
+    }
+    updateStatus();
+}
+
+void FindBar::handleSearchFinished(qint64 matchCount, qint64 bytes, qint64 elapsedUs)
+{
+    m_totalMatches = matchCount;
+    m_throughput = tr("%1 MB/s").arg(bytes / (1024.0 * 1024.0) / (elapsedUs / 1e6), 0, 'f', 0);
+    updateStatus();
+    // The first match is shown once the whole file has been searched, so
+    // a chunk finishing early cannot pull the view away from it
+    if (m_view && m_view->currentMatch() < 0 && matchCount > 0)
+        findNext();
+}
+
+void FindBar::updateStatus()
+{
+    if (!m_view)
+        return;
+    const int shown = m_view->matchCount();
+    QString text;
+    if (m_search->isRunning())
+        text = tr("%n match(es) so far", nullptr, shown);
+    else if (m_totalMatches > shown)
+        text = tr("%1 matches, first %2 highlighted").arg(m_totalMatches).arg(shown);
+    else if (m_view->currentMatch() >= 0)
+        text = tr("%1 of %2").arg(m_view->currentMatch() + 1).arg(shown);
+    else
+        text = tr("%n match(es)", nullptr, shown);
+    if (!m_throughput.isEmpty())
+        text += QString(", %1").arg(m_throughput);
+    m_statusLabel->setText(text);
+}
@@ -0,0 +1,55 @@
+#ifndef FINDBAR_H
+#define FINDBAR_H
+
+#include <QPointer>
+#include <QTimer>
+#include <QToolBar>
+
+class LogView;
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class TextSearch;
+
+// Find bar for the central log view. Typing starts a TextSearch over the
+// view's file after a short pause, canceling the previous one; matches
+// are handed to the view as they stream in and the bar reports the count
+// and the search throughput.
+class FindBar : public QToolBar
+{
+    Q_OBJECT
+
+public:
+    explicit FindBar(QWidget *parent = nullptr);
+
+    void setView(LogView *view);
+    LogView *view() const { return m_view; }
+    TextSearch *search() const { return m_search; }
+
+public slots:
+    // Shows the bar with the search text selected
+    void activate();
+    void findNext();
+    void findPrevious();
+    // Hides the bar and clears the highlighted matches
+    void dismiss();
+
+private slots:
+    void startSearch();
+    void handleSearchFinished(qint64 matchCount, qint64 bytes, qint64 elapsedUs);
+
+private:
+    void updateStatus();
+
+    QPointer<LogView> m_view;
+    TextSearch *m_search;
+    QLineEdit *m_patternEdit;
+    QCheckBox *m_caseCheck;
+    QCheckBox *m_regexCheck;
+    QLabel *m_statusLabel;
+    QTimer m_searchDelay;
+    QString m_throughput;
+    qint64 m_totalMatches = -1;
+};
+
+#endif // FINDBAR_H
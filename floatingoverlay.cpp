@@ -0,0 +1,322 @@
+#include "floatingoverlay.h"
+#include "stallwatchdog.h"
+#include <QAbstractButton>
+#include <QApplication>
+#include <QChildEvent>
+#include <QDockWidget>
+#include <QMainWindow>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+
+// Frame drawn around each panel, outside the dock
+static const int kBorder = 1;
+// Part of a dragged title that stays inside the window
+static const int kGripMargin = 40;
+static const int kSettleIntervalMs = 50;
+
+FloatingOverlay::FloatingOverlay(QMainWindow *mainWindow)
+    : QWidget(mainWindow), m_mainWindow(mainWindow)
+{
+    setObjectName("FloatingOverlay");
+    setGeometry(mainWindow->rect());
+    hide();
+    mainWindow->installEventFilter(this);
+
+    m_settleTimer.setInterval(kSettleIntervalMs);
+    connect(&m_settleTimer, &QTimer::timeout, this, &FloatingOverlay::adoptSettled);
+}
+
+// Panels still here are handed back to the main window, which owns docks
+// the same way whether they float or not
+FloatingOverlay::~FloatingOverlay()
+{
+    m_mainWindow->removeEventFilter(this);
+    while (!m_panels.isEmpty()) {
+        QPointer<QDockWidget> dock = m_panels.last().dock;
+        forget(m_panels.size() - 1);
+        if (dock) {
+            dock->hide();
+            dock->setParent(m_mainWindow);
+        }
+    }
+}
+
+FloatingOverlay *FloatingOverlay::find(const QMainWindow *mainWindow)
+{
+    return mainWindow ? mainWindow->findChild<FloatingOverlay*>(QString(), Qt::FindDirectChildrenOnly) : nullptr;
+}
+
+FloatingOverlay *FloatingOverlay::of(const QDockWidget *dock)
+{
+    return dock ? qobject_cast<FloatingOverlay*>(dock->parentWidget()) : nullptr;
+}
+
+bool FloatingOverlay::isFloating(const QDockWidget *dock)
+{
+    return dock->isFloating() || of(dock);
+}
+
+void FloatingOverlay::setFloating(QDockWidget *dock, bool floating, const QPoint &position)
+{
+    FloatingOverlay *holder = of(dock);
+    if (!floating) {
+        if (holder)
+            holder->release(dock);
+        else
+            dock->setFloating(false);
+        return;
+    }
+
+    QMainWindow *mainWindow = holder ? holder->m_mainWindow : qobject_cast<QMainWindow*>(dock->parentWidget());
+    if (FloatingOverlay *overlay = find(mainWindow)) {
+        if (!holder)
+            overlay->adopt(dock, position);
+        else if (!position.isNull())
+            dock->move(overlay->clampPosition(overlay->mapFromGlobal(position), dock->size()));
+        return;
+    }
+    dock->setFloating(true);
+    if (!position.isNull())
+        dock->move(position);
+}
+
+QRect FloatingOverlay::floatingGeometry(const QDockWidget *dock)
+{
+    if (of(dock))
+        return QRect(dock->mapToGlobal(QPoint(0, 0)), dock->size());
+    return dock->frameGeometry();
+}
+
+void FloatingOverlay::adopt(QDockWidget *dock, const QPoint &position)
+{
+    if (!dock || indexOf(dock) >= 0)
+        return;
+    StallWatchdog::Scope scope("FloatingOverlay::adopt");
+    const bool wasFloating = dock->isFloating();
+    const bool visible = !dock->isHidden();
+    const QRect frame = wasFloating ? dock->frameGeometry()
+                                    : QRect(dock->mapToGlobal(QPoint(0, 0)), dock->size());
+    const QSize size = dock->size().isEmpty() ? dock->sizeHint() : dock->size();
+
+    Panel panel;
+    panel.dock = dock;
+    panel.object = dock;
+    panel.area = m_mainWindow->dockWidgetArea(dock);
+    if (panel.area == Qt::NoDockWidgetArea)
+        panel.area = Qt::LeftDockWidgetArea;
+
+    // Out of the dock layout first: removing a dock hides it, and a native
+    // floating dock loses its window when it becomes a child
+    m_mainWindow->removeDockWidget(dock);
+    dock->setParent(this);
+    m_panels.append(panel);
+
+    // The title bar's own float button would float the dock natively
+    m_panels.last().floatButton = dock->findChild<QAbstractButton*>("qt_dockwidget_floatbutton");
+    if (m_panels.last().floatButton)
+        m_panels.last().floatButton->installEventFilter(this);
+    dock->installEventFilter(this);
+
+    const QPoint global = position.isNull() ? frame.topLeft() : position;
+    dock->setGeometry(QRect(clampPosition(mapFromGlobal(global), size), size));
+    dock->setVisible(visible);
+    dock->raise();
+    updateMask();
+    if (!wasFloating)
+        emit floatingChanged(dock, true);
+}
+
+void FloatingOverlay::release(QDockWidget *dock)
+{
+    const int index = indexOf(dock);
+    if (index < 0)
+        return;
+    StallWatchdog::Scope scope("FloatingOverlay::release");
+    const Qt::DockWidgetArea area = m_panels.at(index).area;
+    const bool visible = !dock->isHidden();
+    forget(index);
+    m_mainWindow->addDockWidget(area, dock);
+    dock->setVisible(visible);
+}
+
+void FloatingOverlay::adoptWhenSettled(QDockWidget *dock)
+{
+    if (!m_unsettled.contains(dock))
+        m_unsettled.append(dock);
+    if (!m_settleTimer.isActive())
+        m_settleTimer.start();
+}
+
+void FloatingOverlay::adoptSettled()
+{
+    // Reparenting in the middle of a drag would leave Qt's drag state behind
+    if (QApplication::mouseButtons() != Qt::NoButton)
+        return;
+    m_settleTimer.stop();
+    const QVector<QPointer<QDockWidget>> unsettled = m_unsettled;
+    m_unsettled.clear();
+    for (const QPointer<QDockWidget> &dock : unsettled) {
+        // Docked again by the drag, or already adopted
+        if (dock && dock->isFloating())
+            adopt(dock);
+    }
+}
+
+QList<QDockWidget*> FloatingOverlay::docks() const
+{
+    QList<QDockWidget*> docks;
+    for (const Panel &panel : m_panels) {
+        if (panel.dock)
+            docks.append(panel.dock);
+    }
+    return docks;
+}
+
+int FloatingOverlay::indexOf(const QObject *dock) const
+{
+    for (int i = 0; i < m_panels.size(); ++i) {
+        if (m_panels.at(i).object == dock)
+            return i;
+    }
+    return -1;
+}
+
+void FloatingOverlay::forget(int index)
+{
+    const Panel panel = m_panels.takeAt(index);
+    if (panel.floatButton)
+        panel.floatButton->removeEventFilter(this);
+    if (panel.dock) {
+        panel.dock->removeEventFilter(this);
+        if (m_dragged == panel.dock)
+            m_dragged = nullptr;
+    }
+    updateMask();
+    if (panel.dock)
+        emit floatingChanged(panel.dock, false);
+}
+
+// The title stays reachable however far a panel is dragged
+QPoint FloatingOverlay::clampPosition(const QPoint &position, const QSize &size) const
+{
+    const int grip = qMin(kGripMargin, size.width());
+    return QPoint(qBound(grip - size.width(), position.x(), qMax(0, width() - grip)),
+                  qBound(0, position.y(), qMax(0, height() - grip)));
+}
+
+void FloatingOverlay::updateMask()
+{
+    QRegion region;
+    for (const Panel &panel : qAsConst(m_panels)) {
+        if (panel.dock && !panel.dock->isHidden())
+            region += panel.dock->geometry().adjusted(-kBorder, -kBorder, kBorder, kBorder);
+    }
+    // An empty mask would mean no mask, covering the whole window
+    if (region.isEmpty()) {
+        hide();
+        return;
+    }
+    setMask(region);
+    show();
+    // Widgets added to the window since, central or dock content, would
+    // stack above the panels
+    raise();
+    update();
+}
+
+bool FloatingOverlay::event(QEvent *event)
+{
+    // Docking with addDockWidget() or tabifyDockWidget() takes the dock
+    // away without asking; so does deleting it
+    if (event->type() == QEvent::ChildRemoved) {
+        const int index = indexOf(static_cast<QChildEvent*>(event)->child());
+        if (index >= 0)
+            forget(index);
+    }
+    return QWidget::event(event);
+}
+
+bool FloatingOverlay::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_mainWindow) {
+        if (event->type() == QEvent::Resize)
+            setGeometry(m_mainWindow->rect());
+        return false;
+    }
+
+    const int index = indexOf(watched);
+    if (index < 0) {
+        // A float button: docking replaces floating
+        QAbstractButton *button = qobject_cast<QAbstractButton*>(watched);
+        QDockWidget *dock = button ? qobject_cast<QDockWidget*>(button->parentWidget()) : nullptr;
+        if (!dock || indexOf(dock) < 0)
+            return false;
+        if (event->type() == QEvent::MouseButtonPress || event->type() == QEvent::MouseButtonDblClick)
+            return true;
+        if (event->type() == QEvent::MouseButtonRelease) {
+            if (button->rect().contains(static_cast<QMouseEvent*>(event)->pos()))
+                release(dock);
+            return true;
+        }
+        return false;
+    }
+
+    QDockWidget *dock = m_panels.at(index).dock;
+    switch (event->type()) {
+    case QEvent::MouseButtonPress: {
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
+        const bool onTitle = !dock->widget() || !dock->widget()->geometry().contains(mouseEvent->pos());
+        if (mouseEvent->button() != Qt::LeftButton || !onTitle
+            || !dock->features().testFlag(QDockWidget::DockWidgetMovable))
+            return false;
+        m_dragged = dock;
+        m_dragOffset = mouseEvent->pos();
+        dock->raise();
+        return true;
+    }
+    case QEvent::MouseMove:
+        if (m_dragged != dock)
+            return false;
+        dock->move(clampPosition(mapFromGlobal(static_cast<QMouseEvent*>(event)->globalPos()) - m_dragOffset,
+                                 dock->size()));
+        return true;
+    case QEvent::MouseButtonRelease:
+        if (m_dragged != dock)
+            return false;
+        m_dragged = nullptr;
+        return true;
+    case QEvent::MouseButtonDblClick: {
+        // As with a native floating dock, double clicking the title docks it
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
+        const bool onTitle = !dock->widget() || !dock->widget()->geometry().contains(mouseEvent->pos());
+        if (!onTitle)
+            return false;
+        release(dock);
+        return true;
+    }
+    // While the overlay is hidden, showing a dock only sends ShowToParent:
+    // the panel is not visible until the overlay is
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+    case QEvent::ShowToParent:
+    case QEvent::HideToParent:
+        updateMask();
+        return false;
+    default:
+        return false;
+    }
+}
+
+void FloatingOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.setPen(palette().color(QPalette::Dark));
+    for (const Panel &panel : qAsConst(m_panels)) {
+        if (panel.dock && !panel.dock->isHidden())
+            painter.drawRect(panel.dock->geometry().adjusted(-kBorder, -kBorder, 0, 0));
+    }
+}
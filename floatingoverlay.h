@@ -0,0 +1,86 @@
+#ifndef FLOATINGOVERLAY_H
+#define FLOATINGOVERLAY_H
+
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <QWidget>
+
+class QAbstractButton;
+class QDockWidget;
+class QMainWindow;
+
+// Floating docks drawn as panels inside the main window instead of one
+// native window each. The overlay is a child widget covering the window,
+// masked to its panels so everything else still gets the mouse; panels
+// are ordinary children, so they share the window's backing store and
+// moving one is a repaint rather than a window system round trip.
+// A dock in the overlay is not floating as far as QDockWidget knows, so
+// code that floats or docks goes through the static helpers below, which
+// also work for native floating docks. The float button and a double
+// click on the title dock a panel again; dragging the title moves it.
+class FloatingOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FloatingOverlay(QMainWindow *mainWindow);
+    ~FloatingOverlay();
+
+    // The overlay of mainWindow, nullptr while its docks float natively
+    static FloatingOverlay *find(const QMainWindow *mainWindow);
+    // The overlay holding dock, if any
+    static FloatingOverlay *of(const QDockWidget *dock);
+    // Floating natively or in an overlay
+    static bool isFloating(const QDockWidget *dock);
+    // Floats dock the way its main window is set up to, or docks it. A
+    // floating position is global; a null one keeps the dock where it is.
+    static void setFloating(QDockWidget *dock, bool floating, const QPoint &position = QPoint());
+    // Frame of a floating dock in global coordinates
+    static QRect floatingGeometry(const QDockWidget *dock);
+
+    void adopt(QDockWidget *dock, const QPoint &position = QPoint());
+    // Docks the panel again in the area it last had
+    void release(QDockWidget *dock);
+    // Adopts a dock Qt floated natively, by a drag for instance, once the
+    // mouse buttons are up
+    void adoptWhenSettled(QDockWidget *dock);
+    QList<QDockWidget*> docks() const;
+    int panelCount() const { return m_panels.size(); }
+
+signals:
+    // Not emitted when adopting a dock that was already floating natively
+    void floatingChanged(QDockWidget *dock, bool floating);
+
+protected:
+    bool event(QEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private slots:
+    void adoptSettled();
+
+private:
+    struct Panel
+    {
+        QPointer<QDockWidget> dock;
+        // For comparing against a dock being destroyed
+        const QObject *object = nullptr;
+        QPointer<QAbstractButton> floatButton;
+        Qt::DockWidgetArea area = Qt::LeftDockWidgetArea;
+    };
+
+    int indexOf(const QObject *dock) const;
+    void forget(int index);
+    void updateMask();
+    QPoint clampPosition(const QPoint &position, const QSize &size) const;
+
+    QMainWindow *m_mainWindow;
+    QVector<Panel> m_panels;
+    QPointer<QDockWidget> m_dragged;
+    QPoint m_dragOffset;
+    QVector<QPointer<QDockWidget>> m_unsettled;
+    QTimer m_settleTimer;
+};
+
+#endif // FLOATINGOVERLAY_H
@@ -0,0 +1,235 @@
+#include "framescheduler.h"
+#include "stallwatchdog.h"
+#include "triplebuffer.h"
+#include <QApplication>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QPaintEvent>
+#include <QScreen>
+#include <QWidget>
+#include <algorithm>
+
+QHash<QWidget*, FrameScheduler*> FrameScheduler::s_schedulers;
+
+FrameScheduler::FrameScheduler(QObject *parent)
+    : QObject(parent)
+{
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen && screen->refreshRate() > 1.0 ? screen->refreshRate() : 60.0;
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(qMax(1, qRound(1000.0 / refreshRate)));
+    // Half a frame leaves the other half to the rest of the event loop
+    m_budgetUs = m_timer.interval() * 500;
+    connect(&m_timer, &QTimer::timeout, this, &FrameScheduler::runFrame);
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    for (const Entry &entry : qAsConst(m_entries)) {
+        if (entry.feed)
+            entry.feed->setListener(nullptr);
+        entry.content->removeEventFilter(this);
+        s_schedulers.remove(entry.content);
+    }
+}
+
+void FrameScheduler::add(QDockWidget *dock, QWidget *content)
+{
+    if (!content || m_indexes.contains(content))
+        return;
+    Entry entry;
+    entry.dock = dock;
+    entry.content = content;
+    m_indexes.insert(content, m_entries.size());
+    m_entries.append(entry);
+    s_schedulers.insert(content, this);
+    content->installEventFilter(this);
+    connect(content, &QObject::destroyed, this, [this, content]() { remove(content); });
+}
+
+void FrameScheduler::remove(QWidget *content)
+{
+    const int index = m_indexes.value(content, -1);
+    if (index < 0)
+        return;
+    if (TripleBufferBase *feed = m_entries.at(index).feed) {
+        feed->setListener(nullptr);
+        --m_feedCount;
+    }
+    content->removeEventFilter(this);
+    disconnect(content, nullptr, this, nullptr);
+    s_schedulers.remove(content);
+
+    // Swap with the last entry so the other indexes stay valid
+    m_indexes.remove(content);
+    const int last = m_entries.size() - 1;
+    if (index != last) {
+        m_entries[index] = m_entries.at(last);
+        m_indexes[m_entries.at(index).content] = index;
+    }
+    m_entries.removeLast();
+}
+
+void FrameScheduler::requestRepaint(QWidget *content)
+{
+    if (FrameScheduler *scheduler = s_schedulers.value(content))
+        scheduler->markDirty(content);
+    else if (content)
+        content->update();
+}
+
+void FrameScheduler::markDirty(QWidget *content)
+{
+    const int index = m_indexes.value(content, -1);
+    if (index < 0)
+        return;
+    Entry &entry = m_entries[index];
+    if (!entry.dirty) {
+        entry.dirty = true;
+        entry.dirtySince = m_totals.frames + 1;
+    }
+    scheduleTick();
+}
+
+void FrameScheduler::setFeed(QWidget *content, TripleBufferBase *feed)
+{
+    const int index = m_indexes.value(content, -1);
+    if (index < 0)
+        return;
+    Entry &entry = m_entries[index];
+    m_feedCount += (feed ? 1 : 0) - (entry.feed ? 1 : 0);
+    if (entry.feed)
+        entry.feed->setListener(nullptr);
+    entry.feed = feed;
+    if (feed)
+        feed->setListener(this);
+    // A frame published before the listener was set would not wake us
+    scheduleTick();
+}
+
+// Producer thread
+void FrameScheduler::framePublished(TripleBufferBase *buffer)
+{
+    Q_UNUSED(buffer);
+    QMetaObject::invokeMethod(this, [this]() { scheduleTick(); }, Qt::QueuedConnection);
+}
+
+void FrameScheduler::resetStatistics()
+{
+    m_lastFrame = FrameStats();
+    m_totals = Totals();
+}
+
+void FrameScheduler::scheduleTick()
+{
+    if (!m_timer.isActive())
+        m_timer.start();
+}
+
+bool FrameScheduler::isOnScreen(const Entry &entry) const
+{
+    // Background tabs and closed docks are hidden; visibleRegion() is empty
+    // for content clipped away entirely
+    return entry.content->isVisible()
+           && !entry.content->window()->isMinimized()
+           && !entry.content->visibleRegion().isEmpty();
+}
+
+void FrameScheduler::runFrame()
+{
+    StallWatchdog::Scope scope("FrameScheduler::runFrame");
+    FrameStats stats;
+    stats.frame = ++m_totals.frames;
+
+    // New feed frames only make visible content dirty; hidden content keeps
+    // the newest frame in its buffer until it is shown
+    if (m_feedCount > 0) {
+        for (Entry &entry : m_entries) {
+            if (!entry.feed || entry.dirty || !entry.feed->hasNewFrame() || !isOnScreen(entry))
+                continue;
+            entry.feed->markScheduled();
+            entry.dirty = true;
+            entry.dirtySince = stats.frame;
+        }
+    }
+
+    m_order.clear();
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (!m_entries.at(i).dirty)
+            continue;
+        ++stats.dirty;
+        if (isOnScreen(m_entries.at(i)))
+            m_order.append(i);
+        else
+            ++stats.hidden;
+    }
+
+    int focused = -1;
+    for (QWidget *widget = QApplication::focusWidget(); widget && focused < 0; widget = widget->parentWidget()) {
+        focused = m_indexes.value(widget, -1);
+        if (focused < 0 && qobject_cast<QDockWidget*>(widget)) {
+            for (int i = 0; i < m_entries.size() && focused < 0; ++i) {
+                if (m_entries.at(i).dock == widget)
+                    focused = i;
+            }
+        }
+    }
+    std::stable_sort(m_order.begin(), m_order.end(), [this, focused](int a, int b) {
+        if ((a == focused) != (b == focused))
+            return a == focused;
+        return m_entries.at(a).dirtySince < m_entries.at(b).dirtySince;
+    });
+
+    // repaint() paints synchronously, which is what makes the budget
+    // enforceable; at least one dock is painted per tick
+    QElapsedTimer timer;
+    timer.start();
+    m_painting = true;
+    for (int index : qAsConst(m_order)) {
+        if (stats.painted > 0 && timer.nsecsElapsed() / 1000 >= m_budgetUs) {
+            ++stats.deferred;
+            continue;
+        }
+        Entry &entry = m_entries[index];
+        entry.dirty = false;
+        entry.content->repaint();
+        ++stats.painted;
+        if (index == focused)
+            stats.focusedPainted = true;
+    }
+    m_painting = false;
+    stats.paintUs = timer.nsecsElapsed() / 1000;
+
+    m_totals.painted += stats.painted;
+    m_totals.hiddenSkips += stats.hidden;
+    m_totals.deferred += stats.deferred;
+    m_totals.paintUs += stats.paintUs;
+    // Counted rather than logged; frameFinished() has the details
+    if (stats.paintUs > m_budgetUs)
+        ++m_totals.overBudgetFrames;
+    m_lastFrame = stats;
+    emit frameFinished(stats);
+
+    // Hidden dirty content does not keep the timer going: showing it
+    // repaints it and clears the flag. Content marked dirty while this
+    // frame painted does; feeds wake the timer themselves.
+    bool pending = stats.deferred > 0;
+    for (int i = 0; i < m_entries.size() && !pending; ++i)
+        pending = m_entries.at(i).dirty && m_entries.at(i).dirtySince > stats.frame;
+    if (!pending)
+        m_timer.stop();
+}
+
+bool FrameScheduler::eventFilter(QObject *watched, QEvent *event)
+{
+    // A full paint by Qt, on expose for instance, makes a pending repaint moot
+    if (!m_painting && event->type() == QEvent::Paint) {
+        const int index = m_indexes.value(static_cast<QWidget*>(watched), -1);
+        if (index >= 0) {
+            Entry &entry = m_entries[index];
+            if (static_cast<QPaintEvent*>(event)->rect().contains(entry.content->rect()))
+                entry.dirty = false;
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,109 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include "triplebuffer.h"
+
+class QDockWidget;
+class QWidget;
+
+// Repaints dock content once per display frame. Content marks itself
+// dirty with requestRepaint() instead of calling update(); each tick
+// repaints the dirty content that is actually on screen, the dock holding
+// the focus first and then the longest waiting, until the frame budget is
+// spent. Content in a background tab, in a closed dock or in a minimized
+// window stays dirty without being painted; Qt paints it anyway when it is
+// exposed again, which clears the flag. Feeds attached with setFeed() are
+// checked on the same tick; a feed wakes the timer when a frame arrives,
+// so the timer only runs while there is work.
+class FrameScheduler : public QObject, private TripleBufferListener
+{
+    Q_OBJECT
+
+public:
+    struct FrameStats
+    {
+        quint64 frame = 0;
+        int dirty = 0;        // content waiting at the start of the tick
+        int painted = 0;
+        int hidden = 0;       // dirty but not on screen, skipped
+        int deferred = 0;     // on screen but over budget, left for the next tick
+        qint64 paintUs = 0;
+        bool focusedPainted = false;
+    };
+
+    struct Totals
+    {
+        quint64 frames = 0;
+        quint64 painted = 0;
+        quint64 hiddenSkips = 0;
+        quint64 deferred = 0;
+        quint64 overBudgetFrames = 0;
+        qint64 paintUs = 0;
+    };
+
+    explicit FrameScheduler(QObject *parent = nullptr);
+    ~FrameScheduler();
+
+    void add(QDockWidget *dock, QWidget *content);
+    void remove(QWidget *content);
+    bool contains(QWidget *content) const { return m_indexes.contains(content); }
+
+    // Marks content scheduled by any FrameScheduler dirty, or calls
+    // update() on content that is not scheduled
+    static void requestRepaint(QWidget *content);
+    void markDirty(QWidget *content);
+    void setFeed(QWidget *content, TripleBufferBase *feed);
+
+    // Defaults to the screen refresh rate
+    int interval() const { return m_timer.interval(); }
+    void setInterval(int milliseconds) { m_timer.setInterval(milliseconds); }
+    int budgetUs() const { return m_budgetUs; }
+    void setBudgetUs(int microseconds) { m_budgetUs = microseconds; }
+
+    FrameStats lastFrame() const { return m_lastFrame; }
+    Totals totals() const { return m_totals; }
+    void resetStatistics();
+
+public slots:
+    // One tick; the timer calls this, benchmarks may call it directly
+    void runFrame();
+
+signals:
+    void frameFinished(const FrameScheduler::FrameStats &stats);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Entry
+    {
+        QPointer<QDockWidget> dock;
+        QWidget *content = nullptr;
+        TripleBufferBase *feed = nullptr;
+        bool dirty = false;
+        quint64 dirtySince = 0;
+    };
+
+    bool isOnScreen(const Entry &entry) const;
+    void scheduleTick();
+    void framePublished(TripleBufferBase *buffer) override;
+
+    QVector<Entry> m_entries;
+    QHash<QWidget*, int> m_indexes;
+    QVector<int> m_order;
+    QTimer m_timer;
+    int m_budgetUs;
+    int m_feedCount = 0;
+    bool m_painting = false;
+    FrameStats m_lastFrame;
+    Totals m_totals;
+
+    static QHash<QWidget*, FrameScheduler*> s_schedulers;
+};
+
+#endif // FRAMESCHEDULER_H
@@ -0,0 +1,425 @@
+#include "layoutdocument.h"
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSet>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+// Masks of QDockWidget::DockWidgetFeatures and Qt::DockWidgetAreas; kept as
+// numbers so this file does not need QtWidgets.
+static const int kAllDockFeatures = 0x0f;
+static const int kAllDockAreas = 0x0f;
+static const int kDefaultDockFeatures = 0x07;
+
+bool LayoutDocument::read(QIODevice *device, QString *errorString)
+{
+    QXmlStreamReader xmlReader(device);
+    return read(xmlReader, errorString);
+}
+
+bool LayoutDocument::read(const QByteArray &data, QString *errorString)
+{
+    QXmlStreamReader xmlReader(data);
+    return read(xmlReader, errorString);
+}
+
+QString LayoutDocument::colorNameForDock(const QString &dockName)
+{
+    if (dockName.endsWith("Dock"))
+        return dockName.left(dockName.size() - 4);
+    return dockName;
+}
+
+void LayoutDocument::addIssue(Issue::Severity severity, qint64 line, const QString &message)
+{
+    issues.append({ severity, line, message });
+}
+
+bool LayoutDocument::hasErrors() const
+{
+    for (const Issue &issue : issues) {
+        if (issue.severity == Issue::Error)
+            return true;
+    }
+    return false;
+}
+
+bool LayoutDocument::read(QXmlStreamReader &xmlReader, QString *errorString)
+{
+    // Nothing from an earlier read may leak into this one
+    *this = LayoutDocument();
+
+    bool foundRoot = false;
+    while (!xmlReader.atEnd() && !xmlReader.hasError()) {
+        xmlReader.readNext();
+        if (xmlReader.isStartElement() && xmlReader.name() == "MainWindowLayout") {
+            foundRoot = true;
+            const QString version = xmlReader.attributes().value("version").toString();
+            if (version.isEmpty()) {
+                schemaVersion = 1;
+            } else {
+                bool ok = false;
+                schemaVersion = version.toInt(&ok);
+                if (!ok || schemaVersion < 1)
+                    addIssue(Issue::Error, xmlReader.lineNumber(), QString("bad schema version '%1'").arg(version));
+                else if (schemaVersion > kSchemaVersion)
+                    addIssue(Issue::Error, xmlReader.lineNumber(),
+                             QString("schema version %1 is newer than supported version %2")
+                                 .arg(schemaVersion).arg(kSchemaVersion));
+            }
+
+            while (xmlReader.readNextStartElement()) {
+                if (xmlReader.name() == "MainWindowGeometry") {
+                    readGeometry(xmlReader);
+                } else if (xmlReader.name() == "CentralWidget") {
+                    hasCentralWidget = true;
+                    centralWidget = readElements(xmlReader);
+                } else if (xmlReader.name() == "NativeState") {
+                    hasNativeState = true;
+                    nativeStateVersion = xmlReader.attributes().value("version").toString().toInt();
+                    nativeStateDocks = xmlReader.attributes().value("docks").toString().split(',', Qt::SkipEmptyParts);
+                    nativeState = xmlReader.readElementText().trimmed();
+                } else if (xmlReader.name() == "DockWidgets") {
+                    readDockWidgets(xmlReader);
+                } else {
+                    addIssue(Issue::Warning, xmlReader.lineNumber(),
+                             QString("unknown element <%1>").arg(xmlReader.name().toString()));
+                    xmlReader.skipCurrentElement();
+                }
+            }
+        }
+    }
+
+    QString error;
+    if (xmlReader.hasError())
+        error = QString("line %1: %2").arg(xmlReader.lineNumber()).arg(xmlReader.errorString());
+    else if (!foundRoot)
+        error = QString("missing MainWindowLayout element");
+
+    if (!error.isEmpty()) {
+        addIssue(Issue::Error, xmlReader.lineNumber(), error);
+        if (errorString)
+            *errorString = error;
+        return false;
+    }
+    return true;
+}
+
+int LayoutDocument::readInt(QXmlStreamReader &xmlReader, const QString &what)
+{
+    const qint64 line = xmlReader.lineNumber();
+    const QString text = xmlReader.readElementText();
+    bool ok = false;
+    const int value = text.trimmed().toInt(&ok);
+    if (!ok)
+        addIssue(Issue::Error, line, QString("%1: '%2' is not a number").arg(what, text));
+    return value;
+}
+
+bool LayoutDocument::readBool(QXmlStreamReader &xmlReader, const QString &what)
+{
+    const qint64 line = xmlReader.lineNumber();
+    const QString text = xmlReader.readElementText();
+    if (text != "true" && text != "false")
+        addIssue(Issue::Error, line, QString("%1: '%2' is not true or false").arg(what, text));
+    return text == "true";
+}
+
+QVector<LayoutDocument::Element> LayoutDocument::readElements(QXmlStreamReader &xmlReader)
+{
+    QVector<Element> elements;
+    while (xmlReader.readNextStartElement()) {
+        Element element;
+        element.name = xmlReader.name().toString();
+        element.attributes = xmlReader.attributes();
+        element.text = xmlReader.readElementText(QXmlStreamReader::IncludeChildElements);
+        elements.append(element);
+    }
+    return elements;
+}
+
+void LayoutDocument::readGeometry(QXmlStreamReader &xmlReader)
+{
+    while (xmlReader.readNextStartElement()) {
+        if (xmlReader.name() == "x")
+            geometry.moveLeft(readInt(xmlReader, "MainWindowGeometry/x"));
+        else if (xmlReader.name() == "y")
+            geometry.moveTop(readInt(xmlReader, "MainWindowGeometry/y"));
+        else if (xmlReader.name() == "width")
+            geometry.setWidth(readInt(xmlReader, "MainWindowGeometry/width"));
+        else if (xmlReader.name() == "height")
+            geometry.setHeight(readInt(xmlReader, "MainWindowGeometry/height"));
+        else if (xmlReader.name() == "NestedDocking")
+            nestedDocking = readBool(xmlReader, "MainWindowGeometry/NestedDocking");
+        else if (xmlReader.name() == "GroupMovement")
+            groupMovement = readBool(xmlReader, "MainWindowGeometry/GroupMovement");
+        else
+            xmlReader.skipCurrentElement();
+    }
+}
+
+void LayoutDocument::readDockWidgets(QXmlStreamReader &xmlReader)
+{
+    while (xmlReader.readNextStartElement()) {
+        if (xmlReader.name() != "DockWidget") {
+            addIssue(Issue::Warning, xmlReader.lineNumber(),
+                     QString("unknown element <%1> in DockWidgets").arg(xmlReader.name().toString()));
+            xmlReader.skipCurrentElement();
+            continue;
+        }
+
+        DockEntry dock;
+        dock.line = xmlReader.lineNumber();
+        dock.name = xmlReader.attributes().value("name").toString();
+        const QString prefix = dock.name + "/";
+        while (xmlReader.readNextStartElement()) {
+            if (xmlReader.name() == "WidgetProperties") {
+                dock.hasWidgetProperties = true;
+                dock.widgetProperties = readElements(xmlReader);
+            } else if (xmlReader.name() == "Title") {
+                dock.title = xmlReader.readElementText();
+            } else if (xmlReader.name() == "Visible") {
+                dock.visible = readBool(xmlReader, prefix + "Visible");
+            } else if (xmlReader.name() == "Floating") {
+                dock.floating = readBool(xmlReader, prefix + "Floating");
+            } else if (xmlReader.name() == "Features") {
+                dock.features = readInt(xmlReader, prefix + "Features");
+            } else if (xmlReader.name() == "AllowedAreas") {
+                dock.allowedAreas = readInt(xmlReader, prefix + "AllowedAreas");
+            } else if (xmlReader.name() == "DockArea") {
+                dock.dockArea = xmlReader.readElementText();
+            } else if (xmlReader.name() == "Size") {
+                while (xmlReader.readNextStartElement()) {
+                    if (xmlReader.name() == "width")
+                        dock.size.setWidth(readInt(xmlReader, prefix + "Size/width"));
+                    else if (xmlReader.name() == "height")
+                        dock.size.setHeight(readInt(xmlReader, prefix + "Size/height"));
+                    else
+                        xmlReader.skipCurrentElement();
+                }
+            } else if (xmlReader.name() == "Geometry") {
+                while (xmlReader.readNextStartElement()) {
+                    if (xmlReader.name() == "x")
+                        dock.position.setX(readInt(xmlReader, prefix + "Geometry/x"));
+                    else if (xmlReader.name() == "y")
+                        dock.position.setY(readInt(xmlReader, prefix + "Geometry/y"));
+                    else
+                        xmlReader.skipCurrentElement();
+                }
+            } else if (xmlReader.name() == "TabbedGroup") {
+                while (xmlReader.readNextStartElement()) {
+                    if (xmlReader.name() == "DockWidget")
+                        dock.tabbedWith.append(xmlReader.readElementText());
+                    else
+                        xmlReader.skipCurrentElement();
+                }
+            } else {
+                addIssue(Issue::Warning, xmlReader.lineNumber(),
+                         QString("%1: unknown element <%2>").arg(dock.name, xmlReader.name().toString()));
+                xmlReader.skipCurrentElement();
+            }
+        }
+        docks.append(dock);
+    }
+}
+
+void LayoutDocument::validate(const QStringList &knownDocks)
+{
+    if (schemaVersion < kSchemaVersion)
+        addIssue(Issue::Warning, 1, QString("legacy schema version %1, current is %2")
+                                        .arg(schemaVersion).arg(kSchemaVersion));
+    if (geometry.width() <= 0 || geometry.height() <= 0)
+        addIssue(Issue::Error, 1, QString("main window size %1x%2 is not positive")
+                                      .arg(geometry.width()).arg(geometry.height()));
+
+    QSet<QString> names;
+    for (const DockEntry &dock : docks) {
+        if (dock.name.isEmpty())
+            addIssue(Issue::Error, dock.line, "dock widget without a name");
+        else if (names.contains(dock.name))
+            addIssue(Issue::Error, dock.line, QString("%1: duplicate dock widget").arg(dock.name));
+        else if (!knownDocks.isEmpty() && !knownDocks.contains(dock.name))
+            addIssue(Issue::Error, dock.line, QString("%1: unknown dock widget").arg(dock.name));
+        names.insert(dock.name);
+
+        if (dock.size.isValid() && (dock.size.width() <= 0 || dock.size.height() <= 0))
+            addIssue(Issue::Error, dock.line, QString("%1: size %2x%3 is not positive")
+                                                  .arg(dock.name).arg(dock.size.width()).arg(dock.size.height()));
+        if (dock.features != -1 && (dock.features & ~kAllDockFeatures))
+            addIssue(Issue::Error, dock.line, QString("%1: features %2 out of range").arg(dock.name).arg(dock.features));
+        if (dock.allowedAreas != -1 && (dock.allowedAreas & ~kAllDockAreas))
+            addIssue(Issue::Error, dock.line, QString("%1: allowed areas %2 out of range").arg(dock.name).arg(dock.allowedAreas));
+
+        static const QStringList areas = { "Left", "Right", "Top", "Bottom", "Floating" };
+        if (!dock.floating && dock.dockArea.isEmpty())
+            addIssue(Issue::Warning, dock.line, QString("%1: no dock area, defaults to Left").arg(dock.name));
+        else if (!dock.floating && !areas.contains(dock.dockArea))
+            addIssue(Issue::Error, dock.line, QString("%1: bad dock area '%2'").arg(dock.name, dock.dockArea));
+    }
+
+    for (const DockEntry &dock : docks) {
+        for (const QString &tabbed : dock.tabbedWith) {
+            if (!names.contains(tabbed))
+                addIssue(Issue::Error, dock.line, QString("%1: tabbed with unknown dock '%2'").arg(dock.name, tabbed));
+        }
+    }
+
+    if (hasNativeState) {
+        QStringList sorted = names.values();
+        sorted.sort();
+        if (nativeStateDocks != sorted)
+            addIssue(Issue::Warning, 1, "native state was saved for a different dock set and will be ignored");
+        if (QByteArray::fromBase64(nativeState.toLatin1()).isEmpty())
+            addIssue(Issue::Error, 1, "native state is empty or not base64");
+    }
+}
+
+void LayoutDocument::writeElements(QXmlStreamWriter &xmlWriter, const QVector<Element> &elements)
+{
+    for (const Element &element : elements) {
+        xmlWriter.writeStartElement(element.name);
+        xmlWriter.writeAttributes(element.attributes);
+        xmlWriter.writeCharacters(element.text);
+        xmlWriter.writeEndElement();
+    }
+}
+
+// Writes the canonical form: the element order LayoutManager uses, defaults
+// made explicit and unknown elements dropped.
+bool LayoutDocument::write(QIODevice *device, bool compact) const
+{
+    QXmlStreamWriter xmlWriter(device);
+    xmlWriter.setAutoFormatting(!compact);
+    xmlWriter.writeStartDocument();
+    xmlWriter.writeStartElement("MainWindowLayout");
+    xmlWriter.writeAttribute("version", QString::number(kSchemaVersion));
+
+    xmlWriter.writeStartElement("MainWindowGeometry");
+    xmlWriter.writeTextElement("x", QString::number(geometry.x()));
+    xmlWriter.writeTextElement("y", QString::number(geometry.y()));
+    xmlWriter.writeTextElement("width", QString::number(geometry.width()));
+    xmlWriter.writeTextElement("height", QString::number(geometry.height()));
+    xmlWriter.writeTextElement("NestedDocking", nestedDocking ? "true" : "false");
+    xmlWriter.writeTextElement("GroupMovement", groupMovement ? "true" : "false");
+    xmlWriter.writeEndElement(); // MainWindowGeometry
+
+    if (hasCentralWidget) {
+        xmlWriter.writeStartElement("CentralWidget");
+        writeElements(xmlWriter, centralWidget);
+        xmlWriter.writeEndElement(); // CentralWidget
+    }
+
+    if (hasNativeState) {
+        xmlWriter.writeStartElement("NativeState");
+        xmlWriter.writeAttribute("version", QString::number(nativeStateVersion));
+        xmlWriter.writeAttribute("docks", nativeStateDocks.join(','));
+        xmlWriter.writeCharacters(nativeState);
+        xmlWriter.writeEndElement(); // NativeState
+    }
+
+    xmlWriter.writeStartElement("DockWidgets");
+    for (const DockEntry &dock : docks) {
+        xmlWriter.writeStartElement("DockWidget");
+        xmlWriter.writeAttribute("name", dock.name);
+
+        if (dock.hasWidgetProperties) {
+            xmlWriter.writeStartElement("WidgetProperties");
+            writeElements(xmlWriter, dock.widgetProperties);
+            xmlWriter.writeEndElement(); // WidgetProperties
+        }
+
+        if (dock.size.isValid()) {
+            xmlWriter.writeStartElement("Size");
+            xmlWriter.writeTextElement("width", QString::number(dock.size.width()));
+            xmlWriter.writeTextElement("height", QString::number(dock.size.height()));
+            xmlWriter.writeEndElement(); // Size
+        }
+
+        xmlWriter.writeTextElement("Title", dock.title);
+        xmlWriter.writeTextElement("Visible", dock.visible ? "true" : "false");
+        xmlWriter.writeTextElement("Floating", dock.floating ? "true" : "false");
+        xmlWriter.writeTextElement("Features", QString::number(dock.features == -1 ? kDefaultDockFeatures : dock.features));
+        xmlWriter.writeTextElement("AllowedAreas", QString::number(dock.allowedAreas == -1 ? kAllDockAreas : dock.allowedAreas));
+
+        if (dock.floating) {
+            xmlWriter.writeStartElement("Geometry");
+            xmlWriter.writeTextElement("x", QString::number(dock.position.x()));
+            xmlWriter.writeTextElement("y", QString::number(dock.position.y()));
+            xmlWriter.writeEndElement(); // Geometry
+        } else {
+            xmlWriter.writeTextElement("DockArea", dock.dockArea.isEmpty() ? QString("Left") : dock.dockArea);
+        }
+
+        if (!dock.tabbedWith.isEmpty()) {
+            xmlWriter.writeStartElement("TabbedGroup");
+            for (const QString &tabbed : dock.tabbedWith)
+                xmlWriter.writeTextElement("DockWidget", tabbed);
+            xmlWriter.writeEndElement(); // TabbedGroup
+        }
+
+        xmlWriter.writeEndElement(); // DockWidget
+    }
+    xmlWriter.writeEndElement(); // DockWidgets
+
+    xmlWriter.writeEndElement(); // MainWindowLayout
+    xmlWriter.writeEndDocument();
+    return !xmlWriter.hasError();
+}
+
+static QJsonObject elementsToJson(const QVector<LayoutDocument::Element> &elements)
+{
+    QJsonObject object;
+    for (const LayoutDocument::Element &element : elements) {
+        // Named properties ("Property name=...") are keyed by their name
+        const QString name = element.attributes.hasAttribute("name")
+                                 ? element.attributes.value("name").toString() : element.name;
+        object.insert(name, element.text);
+    }
+    return object;
+}
+
+QJsonObject LayoutDocument::toJson() const
+{
+    QJsonObject root;
+    root.insert("version", kSchemaVersion);
+    root.insert("geometry", QJsonObject{
+        { "x", geometry.x() }, { "y", geometry.y() },
+        { "width", geometry.width() }, { "height", geometry.height() },
+        { "nestedDocking", nestedDocking }, { "groupMovement", groupMovement }
+    });
+    if (hasCentralWidget)
+        root.insert("centralWidget", elementsToJson(centralWidget));
+    if (hasNativeState) {
+        root.insert("nativeState", QJsonObject{
+            { "version", nativeStateVersion },
+            { "docks", QJsonArray::fromStringList(nativeStateDocks) },
+            { "state", nativeState }
+        });
+    }
+
+    QJsonArray dockArray;
+    for (const DockEntry &dock : docks) {
+        QJsonObject object{
+            { "name", dock.name },
+            { "title", dock.title },
+            { "visible", dock.visible },
+            { "floating", dock.floating },
+            { "features", dock.features == -1 ? kDefaultDockFeatures : dock.features },
+            { "allowedAreas", dock.allowedAreas == -1 ? kAllDockAreas : dock.allowedAreas }
+        };
+        if (dock.size.isValid())
+            object.insert("size", QJsonObject{ { "width", dock.size.width() }, { "height", dock.size.height() } });
+        if (dock.floating)
+            object.insert("position", QJsonObject{ { "x", dock.position.x() }, { "y", dock.position.y() } });
+        else
+            object.insert("dockArea", dock.dockArea.isEmpty() ? QString("Left") : dock.dockArea);
+        if (!dock.tabbedWith.isEmpty())
+            object.insert("tabbedWith", QJsonArray::fromStringList(dock.tabbedWith));
+        if (dock.hasWidgetProperties)
+            object.insert("widgetProperties", elementsToJson(dock.widgetProperties));
+        dockArray.append(object);
+    }
+    root.insert("docks", dockArray);
+    return root;
+}
@@ -0,0 +1,97 @@
+#ifndef LAYOUTDOCUMENT_H
+#define LAYOUTDOCUMENT_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QRect>
+#include <QSize>
+#include <QPoint>
+#include <QXmlStreamAttributes>
+
+class QIODevice;
+class QJsonObject;
+class QXmlStreamReader;
+class QXmlStreamWriter;
+
+// Widget-free model of a layout file. It reads and writes the same schema
+// as LayoutManager/DockManager without building anything, so it can be used
+// from worker threads and headless tools (thumbnails, validation).
+class LayoutDocument
+{
+public:
+    // Version 1 files have no version attribute; version 2 added NativeState
+    static const int kSchemaVersion = 2;
+
+    struct Issue
+    {
+        enum Severity { Warning, Error };
+        Severity severity;
+        qint64 line;
+        QString message;
+    };
+
+    // Leaf element kept verbatim, e.g. a widget property
+    struct Element
+    {
+        QString name;
+        QXmlStreamAttributes attributes;
+        QString text;
+    };
+
+    struct DockEntry
+    {
+        QString name;
+        QString title;
+        bool visible = true;
+        bool floating = false;
+        QSize size;
+        QString dockArea;
+        QPoint position;
+        int features = -1;
+        int allowedAreas = -1;
+        QStringList tabbedWith;
+        bool hasWidgetProperties = false;
+        QVector<Element> widgetProperties;
+        qint64 line = 0;
+    };
+
+    bool read(QIODevice *device, QString *errorString = nullptr);
+    bool read(const QByteArray &data, QString *errorString = nullptr);
+
+    // Semantic checks on top of what read() reports; unknown dock names are
+    // only checked when knownDocks is not empty.
+    void validate(const QStringList &knownDocks);
+    bool hasErrors() const;
+
+    bool write(QIODevice *device, bool compact = false) const;
+    QJsonObject toJson() const;
+
+    // Color name of a dock object name ("BlackDock" -> "Black")
+    static QString colorNameForDock(const QString &dockName);
+
+    int schemaVersion = 1;
+    QRect geometry = QRect(0, 0, 800, 600);
+    bool nestedDocking = false;
+    bool groupMovement = false;
+    bool hasCentralWidget = false;
+    QVector<Element> centralWidget;
+    bool hasNativeState = false;
+    int nativeStateVersion = 0;
+    QStringList nativeStateDocks;
+    QString nativeState;
+    QVector<DockEntry> docks;
+    QVector<Issue> issues;
+
+private:
+    bool read(QXmlStreamReader &xmlReader, QString *errorString);
+    void readGeometry(QXmlStreamReader &xmlReader);
+    void readDockWidgets(QXmlStreamReader &xmlReader);
+    QVector<Element> readElements(QXmlStreamReader &xmlReader);
+    int readInt(QXmlStreamReader &xmlReader, const QString &what);
+    bool readBool(QXmlStreamReader &xmlReader, const QString &what);
+    void addIssue(Issue::Severity severity, qint64 line, const QString &message);
+    static void writeElements(QXmlStreamWriter &xmlWriter, const QVector<Element> &elements);
+};
+
+#endif // LAYOUTDOCUMENT_H
@@ -0,0 +1,277 @@
+#include "layoutlibrary.h"
+#include "layoutdocument.h"
+#include "stallwatchdog.h"
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+static const char kMagic[] = "MWLL";
+static const int kHeaderBytes = 16;
+static const int kMaxNameBytes = 0xffff;
+// Fixed part of an index entry after the name
+static const int kEntryBytes = 8 + 4 + 2 + 2 + 8 + 4 + 20;
+
+template <typename T>
+static void appendLittleEndian(QByteArray *out, T value)
+{
+    char bytes[sizeof(T)];
+    qToLittleEndian<T>(value, bytes);
+    out->append(bytes, int(sizeof(T)));
+}
+
+LayoutLibrary::LayoutLibrary(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LayoutLibrary::~LayoutLibrary()
+{
+    close();
+}
+
+bool LayoutLibrary::open(const QString &fileName)
+{
+    close();
+    m_fileName = fileName;
+    m_errorString.clear();
+    m_file.setFileName(fileName);
+    if (!m_file.exists())
+        return true;
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    m_mapSize = m_file.size();
+    m_map = m_mapSize > 0 ? m_file.map(0, m_mapSize) : nullptr;
+    if (!m_map) {
+        m_errorString = tr("Cannot map %1: %2").arg(fileName, m_file.errorString());
+        close();
+        return false;
+    }
+    if (!readIndex()) {
+        const QString error = m_errorString;
+        close();
+        m_errorString = error;
+        return false;
+    }
+    return true;
+}
+
+void LayoutLibrary::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+    if (m_file.isOpen())
+        m_file.close();
+    m_entries.clear();
+}
+
+// Only the index is touched here; payload pages are never faulted in
+bool LayoutLibrary::readIndex()
+{
+    if (m_mapSize < kHeaderBytes || std::memcmp(m_map, kMagic, 4) != 0) {
+        m_errorString = tr("%1 is not a layout library").arg(m_fileName);
+        return false;
+    }
+    const int version = qFromLittleEndian<quint16>(m_map + 4);
+    if (version > kVersion) {
+        m_errorString = tr("%1 uses library version %2, newer than this application supports")
+                            .arg(m_fileName).arg(version);
+        return false;
+    }
+    const quint32 count = qFromLittleEndian<quint32>(m_map + 8);
+    const quint32 indexBytes = qFromLittleEndian<quint32>(m_map + 12);
+    if (kHeaderBytes + qint64(indexBytes) > m_mapSize) {
+        m_errorString = tr("%1 has a truncated index").arg(m_fileName);
+        return false;
+    }
+
+    const uchar *cursor = m_map + kHeaderBytes;
+    const uchar *indexEnd = cursor + indexBytes;
+    m_entries.reserve(int(count));
+    for (quint32 i = 0; i < count; ++i) {
+        if (indexEnd - cursor < 2) {
+            m_errorString = tr("%1 has a truncated index").arg(m_fileName);
+            return false;
+        }
+        const int nameBytes = qFromLittleEndian<quint16>(cursor);
+        cursor += 2;
+        if (indexEnd - cursor < nameBytes + kEntryBytes) {
+            m_errorString = tr("%1 has a truncated index").arg(m_fileName);
+            return false;
+        }
+
+        Entry entry;
+        entry.name = QString::fromUtf8(reinterpret_cast<const char*>(cursor), nameBytes);
+        cursor += nameBytes;
+        entry.modified = QDateTime::fromMSecsSinceEpoch(qFromLittleEndian<qint64>(cursor));
+        entry.dockCount = int(qFromLittleEndian<quint32>(cursor + 8));
+        entry.schemaVersion = qFromLittleEndian<quint16>(cursor + 12);
+        entry.offset = qFromLittleEndian<quint64>(cursor + 16);
+        entry.size = qFromLittleEndian<quint32>(cursor + 24);
+        entry.hash = QByteArray(reinterpret_cast<const char*>(cursor + 28), 20);
+        cursor += kEntryBytes;
+
+        if (entry.offset > quint64(m_mapSize) || entry.size > quint64(m_mapSize) - entry.offset) {
+            m_errorString = tr("%1: layout %2 lies outside the file").arg(m_fileName, entry.name);
+            return false;
+        }
+        m_entries.append(entry);
+    }
+    return true;
+}
+
+int LayoutLibrary::indexOf(const QString &name) const
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).name == name)
+            return i;
+    }
+    return -1;
+}
+
+QVector<int> LayoutLibrary::find(const QString &text) const
+{
+    QVector<int> matches;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).name.contains(text, Qt::CaseInsensitive))
+            matches.append(i);
+    }
+    return matches;
+}
+
+QByteArray LayoutLibrary::layoutData(const QString &name) const
+{
+    const int index = indexOf(name);
+    if (index < 0) {
+        m_errorString = tr("No layout named %1 in %2").arg(name, m_fileName);
+        return QByteArray();
+    }
+    const Entry &entry = m_entries.at(index);
+    const QByteArray data(reinterpret_cast<const char*>(m_map + entry.offset), int(entry.size));
+    if (QCryptographicHash::hash(data, QCryptographicHash::Sha1) != entry.hash) {
+        m_errorString = tr("Layout %1 in %2 is corrupt").arg(name, m_fileName);
+        return QByteArray();
+    }
+    return data;
+}
+
+bool LayoutLibrary::insert(const QString &name, const QByteArray &data)
+{
+    QMap<QString, QByteArray> layouts;
+    layouts.insert(name, data);
+    return update(layouts);
+}
+
+bool LayoutLibrary::remove(const QString &name)
+{
+    return update(QMap<QString, QByteArray>(), QStringList(name));
+}
+
+bool LayoutLibrary::update(const QMap<QString, QByteArray> &layouts, const QStringList &removed)
+{
+    StallWatchdog::Scope scope("LayoutLibrary::update");
+    // The index stores name lengths in 16 bits
+    for (auto it = layouts.cbegin(); it != layouts.cend(); ++it) {
+        if (it.key().toUtf8().size() > kMaxNameBytes) {
+            m_errorString = tr("Layout name %1... is longer than %2 bytes").arg(it.key().left(32)).arg(kMaxNameBytes);
+            return false;
+        }
+    }
+
+    // Kept layouts first, in their current order, then the new ones
+    struct Pending
+    {
+        Entry entry;
+        const char *data;
+    };
+    QVector<Pending> pending;
+    QMap<QString, QByteArray> added = layouts;
+    for (const Entry &entry : qAsConst(m_entries)) {
+        if (removed.contains(entry.name))
+            continue;
+        auto replacement = added.find(entry.name);
+        if (replacement != added.end()) {
+            pending.append({ Entry(), nullptr });
+            pending.last().entry.name = entry.name;
+            continue;
+        }
+        pending.append({ entry, reinterpret_cast<const char*>(m_map + entry.offset) });
+    }
+    for (auto it = added.cbegin(); it != added.cend(); ++it) {
+        if (indexOf(it.key()) < 0 || removed.contains(it.key())) {
+            pending.append({ Entry(), nullptr });
+            pending.last().entry.name = it.key();
+        }
+    }
+
+    // Metadata of new payloads is read once here, never when listing
+    for (Pending &item : pending) {
+        if (item.data)
+            continue;
+        const QByteArray &data = added[item.entry.name];
+        LayoutDocument document;
+        document.read(data);
+        item.entry.modified = QDateTime::currentDateTimeUtc();
+        item.entry.dockCount = document.docks.size();
+        item.entry.schemaVersion = document.schemaVersion;
+        item.entry.size = quint32(data.size());
+        item.entry.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+        item.data = data.constData();
+    }
+
+    quint32 indexBytes = 0;
+    for (const Pending &item : qAsConst(pending))
+        indexBytes += 2 + quint32(item.entry.name.toUtf8().size()) + kEntryBytes;
+
+    QByteArray header(kMagic, 4);
+    appendLittleEndian<quint16>(&header, kVersion);
+    appendLittleEndian<quint16>(&header, 0);
+    appendLittleEndian<quint32>(&header, quint32(pending.size()));
+    appendLittleEndian<quint32>(&header, indexBytes);
+
+    QByteArray index;
+    index.reserve(int(indexBytes));
+    quint64 offset = kHeaderBytes + indexBytes;
+    for (Pending &item : pending) {
+        const QByteArray name = item.entry.name.toUtf8();
+        appendLittleEndian<quint16>(&index, quint16(name.size()));
+        index.append(name);
+        appendLittleEndian<qint64>(&index, item.entry.modified.toMSecsSinceEpoch());
+        appendLittleEndian<quint32>(&index, quint32(item.entry.dockCount));
+        appendLittleEndian<quint16>(&index, quint16(item.entry.schemaVersion));
+        appendLittleEndian<quint16>(&index, 0);
+        appendLittleEndian<quint64>(&index, offset);
+        appendLittleEndian<quint32>(&index, item.entry.size);
+        index.append(item.entry.hash);
+        offset += item.entry.size;
+    }
+
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    file.write(header);
+    file.write(index);
+    for (const Pending &item : qAsConst(pending))
+        file.write(item.data, item.entry.size);
+
+    // The old mapping is dropped before the rename replaces the file
+    const QString fileName = m_fileName;
+    close();
+    if (!file.commit()) {
+        m_errorString = file.errorString();
+        open(fileName);
+        return false;
+    }
+    if (!open(fileName))
+        return false;
+
+    emit changed();
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef LAYOUTLIBRARY_H
+#define LAYOUTLIBRARY_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+// Many named layouts in one file. The index at the front lists every
+// layout's name, metadata, payload offset and size, and SHA-1 of the
+// payload, so the file is memory-mapped and listed without parsing any
+// layout; only the one selected is decoded. Payloads are ordinary layout
+// XML. Updates rewrite the whole file through QSaveFile, so readers see
+// either the old library or the new one.
+//
+// Layout, little-endian:
+//   "MWLL" u16 version, u16 reserved, u32 count, u32 index bytes
+//   per layout: u16 name bytes, name (UTF-8), i64 modified (ms since
+//     epoch), u32 dock count, u16 schema version, u16 reserved,
+//     u64 offset, u32 size, 20 bytes SHA-1
+//   payloads
+class LayoutLibrary : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry
+    {
+        QString name;
+        QDateTime modified;
+        int dockCount = 0;
+        int schemaVersion = 0;
+        quint64 offset = 0;
+        quint32 size = 0;
+        QByteArray hash;
+    };
+
+    static const int kVersion = 1;
+
+    explicit LayoutLibrary(QObject *parent = nullptr);
+    ~LayoutLibrary();
+
+    // A missing file opens as an empty library that is created on update
+    bool open(const QString &fileName);
+    void close();
+    QString fileName() const { return m_fileName; }
+    QString errorString() const { return m_errorString; }
+
+    QVector<Entry> entries() const { return m_entries; }
+    int indexOf(const QString &name) const;
+    // Indexes of layouts whose name contains text, case-insensitively
+    QVector<int> find(const QString &text) const;
+
+    // The layout's XML, checked against its hash; empty on failure
+    QByteArray layoutData(const QString &name) const;
+
+    // Adds or replaces layouts and drops removed ones in one atomic rewrite
+    bool update(const QMap<QString, QByteArray> &layouts, const QStringList &removed = QStringList());
+    bool insert(const QString &name, const QByteArray &data);
+    bool remove(const QString &name);
+
+signals:
+    void changed();
+
+private:
+    bool readIndex();
+
+    QString m_fileName;
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+    QVector<Entry> m_entries;
+    mutable QString m_errorString;
+};
+
+#endif // LAYOUTLIBRARY_H
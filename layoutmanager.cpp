@@ -1,55 +1,259 @@
 #include "layoutmanager.h"
-#include <QXmlStreamWriter>
+#include "floatingoverlay.h"
+#include "layoutdocument.h"
+#include "layoutlibrary.h"
+#include "logview.h"
+#include "stallwatchdog.h"
 #include <QXmlStreamReader>
 #include <QMainWindow>
-#include <QMessageBox>
 #include <QFile>
 #include <QTextEdit>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcLayout, "mainwindows.layout", QtWarningMsg)
+
+// Files are read in chunks so progress can be reported and a cancel is
+// noticed without waiting for the whole file.
+static const qint64 kLoadChunkBytes = 256 * 1024;
 
 LayoutManager::LayoutManager(QMainWindow *parent)
     : QObject(parent), m_mainWindow(parent)
 {
+    m_loadPool.setMaxThreadCount(1);
+}
+
+LayoutManager::~LayoutManager()
+{
+    if (m_pendingLoad)
+        m_pendingLoad->store(true);
+    m_loadPool.waitForDone();
 }
 
-void LayoutManager::saveLayoutToFile(const QString &fileName)
+bool LayoutManager::saveLayoutToFile(const QString &fileName)
 {
+    StallWatchdog::Scope scope("LayoutManager::saveLayoutToFile");
+    QElapsedTimer timer;
+    timer.start();
+
     QFile file(fileName);
     if (!file.open(QFile::WriteOnly | QFile::Text)) {
-        QMessageBox::warning(m_mainWindow, tr("Error"), tr("Failed to open %1 for writing").arg(fileName));
-        return;
+        emit layoutFailed(fileName, tr("Failed to open %1 for writing: %2").arg(fileName, file.errorString()));
+        return false;
     }
 
-    QXmlStreamWriter xmlWriter(&file);
-    xmlWriter.setAutoFormatting(true);
-    xmlWriter.writeStartDocument();
-    xmlWriter.writeStartElement("MainWindowLayout");
+    writeLayout();
+    const bool written = m_writer.writeTo(&file);
+    file.close();
 
-    saveMainWindowGeometry(xmlWriter);
-    saveCentralWidgetProperties(xmlWriter);
-    emit saveDockWidgetsLayoutRequested(xmlWriter);
+    if (!written || file.error() != QFile::NoError) {
+        emit layoutFailed(fileName, tr("Failed to write %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    emit layoutSaved(fileName, timer.nsecsElapsed() / 1000);
+    return true;
+}
 
-    xmlWriter.writeEndElement(); // MainWindowLayout
-    xmlWriter.writeEndDocument();
-    file.close();
+// Builds the layout in m_writer, whose buffer is reused by every save
+void LayoutManager::writeLayout()
+{
+    m_writer.reset();
+    m_writer.writeStartDocument();
+    m_writer.writeStartElement("MainWindowLayout");
+    m_writer.writeAttribute("version", LayoutDocument::kSchemaVersion);
+
+    saveMainWindowGeometry(m_writer);
+    saveCentralWidgetProperties(m_writer);
+    saveNativeState(m_writer);
+    emit saveDockWidgetsLayoutRequested(m_writer);
+
+    m_writer.writeEndElement(); // MainWindowLayout
+    m_writer.writeEndDocument();
 }
 
-void LayoutManager::loadLayoutFromFile(const QString &fileName)
+// Library layouts are named "<library>#<layout>" in signals and messages
+bool LayoutManager::saveLayoutToLibrary(LayoutLibrary *library, const QString &name)
 {
+    StallWatchdog::Scope scope("LayoutManager::saveLayoutToLibrary");
+    QElapsedTimer timer;
+    timer.start();
+    const QString sourceName = library->fileName() + "#" + name;
+
+    writeLayout();
+    if (!library->insert(name, m_writer.toByteArray())) {
+        emit layoutFailed(sourceName, tr("Failed to save %1: %2").arg(sourceName, library->errorString()));
+        return false;
+    }
+    emit layoutSaved(sourceName, timer.nsecsElapsed() / 1000);
+    return true;
+}
+
+bool LayoutManager::loadLayoutFromLibrary(const LayoutLibrary *library, const QString &name)
+{
+    StallWatchdog::Scope scope("LayoutManager::loadLayoutFromLibrary");
+    QElapsedTimer timer;
+    timer.start();
+    cancelLoad();
+    const QString sourceName = library->fileName() + "#" + name;
+
+    const QByteArray data = library->layoutData(name);
+    if (data.isEmpty()) {
+        emit layoutFailed(sourceName, library->errorString());
+        return false;
+    }
+    LoadPath path = loadLayoutFromData(sourceName, data);
+    if (path == FailedLoad)
+        return false;
+    finishLoad(sourceName, path, timer.nsecsElapsed() / 1000);
+    return true;
+}
+
+bool LayoutManager::loadLayoutFromFile(const QString &fileName)
+{
+    StallWatchdog::Scope scope("LayoutManager::loadLayoutFromFile");
+    QElapsedTimer timer;
+    timer.start();
+    cancelLoad();
+
     QFile file(fileName);
     if (!file.open(QFile::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(m_mainWindow, tr("Error"), tr("Failed to open %1 for reading").arg(fileName));
-        return;
+        emit layoutFailed(fileName, tr("Failed to open %1 for reading: %2").arg(fileName, file.errorString()));
+        return false;
     }
+    const QByteArray data = file.readAll();
+    file.close();
 
-    QXmlStreamReader xmlReader(&file);
+    LoadPath path = loadLayoutFromData(fileName, data);
+    if (path == FailedLoad)
+        return false;
+    finishLoad(fileName, path, timer.nsecsElapsed() / 1000);
+    return true;
+}
+
+void LayoutManager::loadLayoutFromFileAsync(const QString &fileName)
+{
+    cancelLoad();
+    auto canceled = std::make_shared<std::atomic<bool>>(false);
+    m_pendingLoad = canceled;
+    m_pendingFile = fileName;
+
+    QElapsedTimer timer;
+    timer.start();
+    // The pool is waited for in the destructor, so the task may post to this
+    m_loadPool.start([this, fileName, canceled, timer]() {
+        auto fail = [this, fileName, canceled](const QString &message) {
+            QMetaObject::invokeMethod(this, [this, fileName, canceled, message]() {
+                if (m_pendingLoad != canceled)
+                    return;
+                m_pendingLoad.reset();
+                emit layoutFailed(fileName, message);
+            }, Qt::QueuedConnection);
+        };
+
+        QFile file(fileName);
+        if (!file.open(QFile::ReadOnly | QFile::Text)) {
+            fail(tr("Failed to open %1 for reading: %2").arg(fileName, file.errorString()));
+            return;
+        }
+        const qint64 total = file.size();
+        QByteArray data;
+        data.reserve(int(total));
+        while (!file.atEnd()) {
+            if (canceled->load())
+                return;
+            const QByteArray chunk = file.read(kLoadChunkBytes);
+            if (chunk.isEmpty() && file.error() != QFile::NoError) {
+                fail(tr("Failed to read %1: %2").arg(fileName, file.errorString()));
+                return;
+            }
+            data += chunk;
+            const qint64 done = data.size();
+            QMetaObject::invokeMethod(this, [this, fileName, canceled, done, total]() {
+                if (m_pendingLoad == canceled)
+                    emit loadProgress(fileName, done, total);
+            }, Qt::QueuedConnection);
+        }
+        file.close();
+
+        // What loadLayoutFromData() would reject is reported before any
+        // widget is touched. Nothing stricter: validate() also rejects
+        // docks this build does not have, which a synchronous load skips,
+        // and a file has to load the same either way.
+        LayoutDocument document;
+        QString error;
+        if (!document.read(data, &error)) {
+            fail(tr("Failed to parse %1, %2").arg(fileName, error));
+            return;
+        }
+        if (document.schemaVersion > LayoutDocument::kSchemaVersion) {
+            fail(tr("%1 uses layout schema version %2, newer than this application supports")
+                     .arg(fileName).arg(document.schemaVersion));
+            return;
+        }
+        if (canceled->load())
+            return;
+
+        QMetaObject::invokeMethod(this, [this, fileName, canceled, data, timer]() {
+            if (m_pendingLoad != canceled)
+                return;
+            m_pendingLoad.reset();
+            StallWatchdog::Scope scope("LayoutManager::loadLayoutFromFileAsync");
+            LoadPath path = loadLayoutFromData(fileName, data);
+            if (path != FailedLoad)
+                finishLoad(fileName, path, timer.nsecsElapsed() / 1000);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LayoutManager::cancelLoad()
+{
+    if (!m_pendingLoad)
+        return;
+    m_pendingLoad->store(true);
+    m_pendingLoad.reset();
+    emit loadCanceled(m_pendingFile);
+}
+
+void LayoutManager::finishLoad(const QString &fileName, LoadPath path, qint64 elapsedUs)
+{
+    m_lastLoadPath = path;
+    m_lastLoadTime = elapsedUs;
+    emit layoutLoaded(fileName, path, m_lastLoadTime);
+    const QStringList warnings = m_loadWarnings;
+    m_loadWarnings.clear();
+    for (const QString &warning : warnings)
+        emit layoutWarning(fileName, warning);
+}
+
+LayoutManager::LoadPath LayoutManager::loadLayoutFromData(const QString &fileName, const QByteArray &data)
+{
+    emit layoutAboutToLoad(fileName);
+    m_loadWarnings.clear();
+    QByteArray nativeState;
+
+    QXmlStreamReader xmlReader(data);
+    bool foundRoot = false;
     while (!xmlReader.atEnd() && !xmlReader.hasError()) {
         xmlReader.readNext();
         if (xmlReader.isStartElement() && xmlReader.name() == "MainWindowLayout") {
+            foundRoot = true;
+            const int version = xmlReader.attributes().value("version").toInt();
+            if (version > LayoutDocument::kSchemaVersion) {
+                emit layoutFailed(fileName, tr("%1 uses layout schema version %2, newer than this application supports")
+                                                .arg(fileName).arg(version));
+                return FailedLoad;
+            }
             while (xmlReader.readNextStartElement()) {
                 if (xmlReader.name() == "MainWindowGeometry")
                     loadMainWindowGeometry(xmlReader);
                 else if (xmlReader.name() == "CentralWidget")
                     loadCentralWidgetProperties(xmlReader);
+                else if (xmlReader.name() == "NativeState")
+                    nativeState = readNativeState(xmlReader);
+                else if (xmlReader.name() == "DockWidgets" && !nativeState.isEmpty())
+                    emit loadDockWidgetPropertiesRequested(xmlReader);
                 else if (xmlReader.name() == "DockWidgets")
                     emit loadDockWidgetsLayoutRequested(xmlReader);
                 else
@@ -59,23 +263,121 @@ void LayoutManager::loadLayoutFromFile(const QString &fileName)
     }
 
     if (xmlReader.hasError()) {
-        QMessageBox::warning(m_mainWindow, tr("Error"), tr("Failed to parse XML file: %1").arg(xmlReader.errorString()));
+        emit layoutFailed(fileName, tr("Failed to parse %1, line %2: %3")
+                                        .arg(fileName).arg(xmlReader.lineNumber()).arg(xmlReader.errorString()));
+        return FailedLoad;
+    }
+    if (!foundRoot) {
+        emit layoutFailed(fileName, tr("Failed to parse %1, missing MainWindowLayout element").arg(fileName));
+        return FailedLoad;
     }
 
-    file.close();
+    if (nativeState.isEmpty())
+        return ElementPath;
+
+    if (m_mainWindow->restoreState(nativeState, kNativeStateVersion))
+        return NativeStatePath;
+
+    // The docks only got their properties above, so place them again the slow way
+    qWarning() << "Native layout state was rejected, falling back to element-by-element restore";
+    placeDockWidgets(data);
+    return ElementPath;
+}
+
+// Only the DockWidgets element: the rest of the layout is already applied,
+// and applying it again would reopen the log and announce a second load
+void LayoutManager::placeDockWidgets(const QByteArray &data)
+{
+    QXmlStreamReader xmlReader(data);
+    while (!xmlReader.atEnd() && !xmlReader.hasError()) {
+        xmlReader.readNext();
+        if (!xmlReader.isStartElement() || xmlReader.name() != "MainWindowLayout")
+            continue;
+        while (xmlReader.readNextStartElement()) {
+            if (xmlReader.name() == "DockWidgets")
+                emit loadDockWidgetsLayoutRequested(xmlReader);
+            else
+                xmlReader.skipCurrentElement();
+        }
+    }
+}
+
+QString LayoutManager::loadPathName(LoadPath path)
+{
+    switch (path) {
+    case NativeStatePath: return "native state";
+    case ElementPath: return "element-by-element restore";
+    default: return "failed load";
+    }
+}
+
+// Names of the docks QMainWindow::saveState() would record, in a stable order
+QStringList LayoutManager::dockWidgetNames() const
+{
+    QStringList names;
+    const QList<QDockWidget*> docks = m_mainWindow->findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly);
+    for (const QDockWidget *dock : docks)
+        names.append(dock->objectName());
+    names.sort();
+    return names;
 }
 
-void LayoutManager::saveMainWindowGeometry(QXmlStreamWriter &xmlWriter)
+// Panels in the floating overlay are not docks of the main window as far
+// as saveState() and restoreState() know, so with any of them the layout
+// is placed element by element
+bool LayoutManager::hasOverlayPanels() const
 {
-    xmlWriter.writeStartElement("MainWindowGeometry");
-    QRect geometry = m_mainWindow->geometry();
-    xmlWriter.writeTextElement("x", QString::number(geometry.x()));
-    xmlWriter.writeTextElement("y", QString::number(geometry.y()));
-    xmlWriter.writeTextElement("width", QString::number(geometry.width()));
-    xmlWriter.writeTextElement("height", QString::number(geometry.height()));
-    xmlWriter.writeTextElement("NestedDocking", m_mainWindow->isDockNestingEnabled() ? "true" : "false");
-    xmlWriter.writeTextElement("GroupMovement", (m_mainWindow->dockOptions() & QMainWindow::AllowNestedDocks) ? "true" : "false");
-    xmlWriter.writeEndElement(); // MainWindowGeometry
+    const FloatingOverlay *overlay = FloatingOverlay::find(m_mainWindow);
+    return overlay && overlay->panelCount() > 0;
+}
+
+void LayoutManager::saveNativeState(LayoutWriter &writer)
+{
+    if (hasOverlayPanels())
+        return;
+    const QByteArray state = m_mainWindow->saveState(kNativeStateVersion).toBase64();
+    writer.writeStartElement("NativeState");
+    writer.writeAttribute("version", kNativeStateVersion);
+    writer.writeAttribute("docks", dockWidgetNames().join(','));
+    writer.writeLatin1(state.constData(), state.size());
+    writer.writeEndElement(); // NativeState
+}
+
+// Returns the state blob only when it was written for this dock set and version
+QByteArray LayoutManager::readNativeState(QXmlStreamReader &xmlReader)
+{
+    const int version = xmlReader.attributes().value("version").toString().toInt();
+    const QStringList docks = xmlReader.attributes().value("docks").toString().split(',', Qt::SkipEmptyParts);
+    const QByteArray state = QByteArray::fromBase64(xmlReader.readElementText().toLatin1());
+
+    if (version != kNativeStateVersion) {
+        qCDebug(lcLayout) << "Native layout state version" << version << "does not match" << kNativeStateVersion;
+        return QByteArray();
+    }
+    if (docks != dockWidgetNames()) {
+        qCDebug(lcLayout) << "Native layout state was saved for a different dock set";
+        return QByteArray();
+    }
+    if (hasOverlayPanels()) {
+        qCDebug(lcLayout) << "Native layout state cannot place floating overlay panels";
+        return QByteArray();
+    }
+    return state;
+}
+
+void LayoutManager::saveMainWindowGeometry(LayoutWriter &writer)
+{
+    writer.writeStartElement("MainWindowGeometry");
+    // Layouts may belong to a workspace embedded in the main window, so the
+    // geometry is always that of the top-level window.
+    QRect geometry = m_mainWindow->window()->geometry();
+    writer.writeNumberElement("x", geometry.x());
+    writer.writeNumberElement("y", geometry.y());
+    writer.writeNumberElement("width", geometry.width());
+    writer.writeNumberElement("height", geometry.height());
+    writer.writeBoolElement("NestedDocking", m_mainWindow->isDockNestingEnabled());
+    writer.writeBoolElement("GroupMovement", m_mainWindow->dockOptions().testFlag(QMainWindow::AllowNestedDocks));
+    writer.writeEndElement(); // MainWindowGeometry
 }
 
 void LayoutManager::loadMainWindowGeometry(QXmlStreamReader &xmlReader)
@@ -101,7 +403,7 @@ void LayoutManager::loadMainWindowGeometry(QXmlStreamReader &xmlReader)
             xmlReader.skipCurrentElement();
     }
 
-    m_mainWindow->setGeometry(x, y, width, height);
+    m_mainWindow->window()->setGeometry(x, y, width, height);
     m_mainWindow->setDockNestingEnabled(nestedDocking);
 
     QMainWindow::DockOptions options = m_mainWindow->dockOptions();
@@ -113,32 +415,29 @@ void LayoutManager::loadMainWindowGeometry(QXmlStreamReader &xmlReader)
     m_mainWindow->setDockOptions(options);
 }
 
-void LayoutManager::saveCentralWidgetProperties(QXmlStreamWriter &xmlWriter)
+void LayoutManager::saveCentralWidgetProperties(LayoutWriter &writer)
 {
     QWidget *central = m_mainWindow->centralWidget();
     if (!central) return;
 
-    xmlWriter.writeStartElement("CentralWidget");
+    writer.writeStartElement("CentralWidget");
 
-    xmlWriter.writeTextElement("ObjectName", central->objectName());
-    xmlWriter.writeTextElement("Geometry", QString("%1,%2,%3,%4")
-                                               .arg(central->geometry().x())
-                                               .arg(central->geometry().y())
-                                               .arg(central->geometry().width())
-                                               .arg(central->geometry().height()));
-    xmlWriter.writeTextElement("MinimumSize", QString("%1,%2")
-                                                  .arg(central->minimumSize().width())
-                                                  .arg(central->minimumSize().height()));
-    xmlWriter.writeTextElement("MaximumSize", QString("%1,%2")
-                                                  .arg(central->maximumSize().width())
-                                                  .arg(central->maximumSize().height()));
+    const QRect geometry = central->geometry();
+    writer.writeTextElement("ObjectName", central->objectName());
+    writer.writeNumbersElement("Geometry", { geometry.x(), geometry.y(), geometry.width(), geometry.height() });
+    writer.writeNumbersElement("MinimumSize", { central->minimumWidth(), central->minimumHeight() });
+    writer.writeNumbersElement("MaximumSize", { central->maximumWidth(), central->maximumHeight() });
 
-    if (QTextEdit *textEdit = qobject_cast<QTextEdit*>(central)) {
-        xmlWriter.writeTextElement("Text", textEdit->toPlainText());
-        xmlWriter.writeTextElement("ReadOnly", textEdit->isReadOnly() ? "true" : "false");
+    // A log view is stored as its file and position, never its content
+    if (LogView *logView = qobject_cast<LogView*>(central)) {
+        writer.writeTextElement("LogFile", logView->fileName());
+        writer.writeNumberElement("TopLine", logView->topLine());
+    } else if (QTextEdit *textEdit = qobject_cast<QTextEdit*>(central)) {
+        writer.writeTextElement("Text", textEdit->toPlainText());
+        writer.writeBoolElement("ReadOnly", textEdit->isReadOnly());
     }
 
-    xmlWriter.writeEndElement(); // CentralWidget
+    writer.writeEndElement(); // CentralWidget
 }
 
 void LayoutManager::loadCentralWidgetProperties(QXmlStreamReader &xmlReader)
@@ -151,6 +450,9 @@ void LayoutManager::loadCentralWidgetProperties(QXmlStreamReader &xmlReader)
     QSize minSize, maxSize;
     QString text;
     bool readOnly = false;
+    QString logFile;
+    bool hasLogFile = false;
+    int topLine = 0;
 
     while (xmlReader.readNextStartElement()) {
         if (xmlReader.name() == "ObjectName") {
@@ -175,6 +477,11 @@ void LayoutManager::loadCentralWidgetProperties(QXmlStreamReader &xmlReader)
             text = xmlReader.readElementText();
         } else if (xmlReader.name() == "ReadOnly") {
             readOnly = xmlReader.readElementText() == "true";
+        } else if (xmlReader.name() == "LogFile") {
+            logFile = xmlReader.readElementText();
+            hasLogFile = true;
+        } else if (xmlReader.name() == "TopLine") {
+            topLine = xmlReader.readElementText().toInt();
         } else {
             xmlReader.skipCurrentElement();
         }
@@ -185,7 +492,28 @@ void LayoutManager::loadCentralWidgetProperties(QXmlStreamReader &xmlReader)
     if (!minSize.isNull()) central->setMinimumSize(minSize);
     if (!maxSize.isNull()) central->setMaximumSize(maxSize);
 
-    if (QTextEdit *textEdit = qobject_cast<QTextEdit*>(central)) {
+    if (LogView *logView = qobject_cast<LogView*>(central)) {
+        // A layout without a LogFile, such as one saved before the log
+        // view existed, leaves the open file alone; an empty one closes it
+        if (!hasLogFile)
+            return;
+        // The open file keeps its index when the layout names it again
+        if (logFile.isEmpty()) {
+            logView->closeFile();
+        } else if (logFile != logView->fileName()) {
+            // Opening closes the current log first; it comes back if the
+            // layout's one cannot be opened
+            const QString previousFile = logView->fileName();
+            const int previousTopLine = logView->topLine();
+            if (!logView->openFile(logFile)) {
+                m_loadWarnings.append(tr("The log %1 was not opened: %2").arg(logFile, logView->errorString()));
+                if (!previousFile.isEmpty() && logView->openFile(previousFile))
+                    logView->setTopLine(previousTopLine);
+                return;
+            }
+        }
+        logView->setTopLine(topLine);
+    } else if (QTextEdit *textEdit = qobject_cast<QTextEdit*>(central)) {
         textEdit->setPlainText(text);
         textEdit->setReadOnly(readOnly);
     }
@@ -1,32 +1,94 @@
 #ifndef LAYOUTMANAGER_H
 #define LAYOUTMANAGER_H
 
+#include "layoutwriter.h"
 #include <QObject>
-#include <QXmlStreamWriter>
 #include <QXmlStreamReader>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
 
 class QMainWindow;
+class LayoutLibrary;
 
 class LayoutManager : public QObject
 {
     Q_OBJECT
 
 public:
+    // Which restore strategy the last load used
+    enum LoadPath {
+        FailedLoad,
+        NativeStatePath,
+        ElementPath
+    };
+    Q_ENUM(LoadPath)
+
+    // Version passed to QMainWindow::saveState/restoreState and stored
+    // next to the blob; bump it when the dock set changes meaning.
+    static const int kNativeStateVersion = 1;
+
     explicit LayoutManager(QMainWindow *parent = nullptr);
-    void saveLayoutToFile(const QString &fileName);
-    void loadLayoutFromFile(const QString &fileName);
+    ~LayoutManager();
+    bool saveLayoutToFile(const QString &fileName);
+    bool loadLayoutFromFile(const QString &fileName);
+    bool saveLayoutToLibrary(LayoutLibrary *library, const QString &name);
+    bool loadLayoutFromLibrary(const LayoutLibrary *library, const QString &name);
+
+    // Reads and checks the file on a worker thread, reporting loadProgress,
+    // then applies it on the GUI thread. Ends with layoutLoaded,
+    // layoutFailed or loadCanceled; a new load cancels the previous one.
+    void loadLayoutFromFileAsync(const QString &fileName);
+    void cancelLoad();
+    bool isLoading() const { return m_pendingLoad != nullptr; }
+
+    LoadPath lastLoadPath() const { return m_lastLoadPath; }
+    qint64 lastLoadTime() const { return m_lastLoadTime; } // microseconds
+    static QString loadPathName(LoadPath path);
+
+    // Saves without indentation or newlines
+    void setCompactOutput(bool compact) { m_writer.setCompact(compact); }
+    bool isCompactOutput() const { return m_writer.isCompact(); }
 
 signals:
-    void saveDockWidgetsLayoutRequested(QXmlStreamWriter &xmlWriter);
+    void saveDockWidgetsLayoutRequested(LayoutWriter &writer);
     void loadDockWidgetsLayoutRequested(QXmlStreamReader &xmlReader);
+    void loadDockWidgetPropertiesRequested(QXmlStreamReader &xmlReader);
+    // Emitted before a parsed layout is applied to the docks
+    void layoutAboutToLoad(const QString &fileName);
+    void layoutLoaded(const QString &fileName, LayoutManager::LoadPath path, qint64 elapsedUs);
+    void layoutSaved(const QString &fileName, qint64 elapsedUs);
+    void layoutFailed(const QString &fileName, const QString &message);
+    // Emitted after layoutLoaded for each part of the layout that could
+    // not be applied, such as a log file that would not open
+    void layoutWarning(const QString &fileName, const QString &message);
+    void loadProgress(const QString &fileName, qint64 bytesRead, qint64 bytesTotal);
+    void loadCanceled(const QString &fileName);
 
 private:
-    void saveMainWindowGeometry(QXmlStreamWriter &xmlWriter);
+    void writeLayout();
+    LoadPath loadLayoutFromData(const QString &fileName, const QByteArray &data);
+    void placeDockWidgets(const QByteArray &data);
+    void finishLoad(const QString &fileName, LoadPath path, qint64 elapsedUs);
+    QStringList dockWidgetNames() const;
+    bool hasOverlayPanels() const;
+    void saveNativeState(LayoutWriter &writer);
+    QByteArray readNativeState(QXmlStreamReader &xmlReader);
+
+    void saveMainWindowGeometry(LayoutWriter &writer);
     void loadMainWindowGeometry(QXmlStreamReader &xmlReader);
-    void saveCentralWidgetProperties(QXmlStreamWriter &xmlWriter);
+    void saveCentralWidgetProperties(LayoutWriter &writer);
     void loadCentralWidgetProperties(QXmlStreamReader &xmlReader);
 
     QMainWindow *m_mainWindow;
+    LoadPath m_lastLoadPath = FailedLoad;
+    qint64 m_lastLoadTime = 0;
+    QStringList m_loadWarnings;
+    QThreadPool m_loadPool;
+    std::shared_ptr<std::atomic<bool>> m_pendingLoad;
+    QString m_pendingFile;
+    LayoutWriter m_writer;
 };
 
 #endif // LAYOUTMANAGER_H
@@ -0,0 +1,625 @@
+#include "layoutsync.h"
+#include "dockmanager.h"
+#include "floatingoverlay.h"
+#include "layoutmanager.h"
+#include "workspace.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDockWidget>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QLoggingCategory>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QtEndian>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(lcSync, "mainwindows.sync", QtWarningMsg)
+
+// Local changes are collected for one frame before they are sent
+static const int kBatchIntervalMs = 16;
+// Resizes right after a remote batch are the layout settling, not the user
+static const int kSettleMs = 100;
+static const int kConnectTimeoutMs = 200;
+// Far above any snapshot; a longer frame means the stream is corrupt
+static const quint32 kMaxFrameBytes = 4 * 1024 * 1024;
+
+LayoutSync::LayoutSync(const QString &serverName, QObject *parent)
+    : QObject(parent), m_serverName(serverName)
+{
+    m_clock.start();
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kBatchIntervalMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &LayoutSync::flushOutgoing);
+
+    m_rejoinTimer.setSingleShot(true);
+    connect(&m_rejoinTimer, &QTimer::timeout, this, &LayoutSync::start);
+}
+
+LayoutSync::~LayoutSync()
+{
+    flushOutgoing();
+}
+
+bool LayoutSync::requested(const QStringList &arguments, QString *serverName)
+{
+    for (const QString &argument : arguments) {
+        if (argument == "--sync") {
+            *serverName = "MainWindows-layout-sync";
+            return true;
+        }
+        if (argument.startsWith("--sync=")) {
+            *serverName = argument.mid(7);
+            return true;
+        }
+    }
+    return false;
+}
+
+void LayoutSync::setWorkspace(Workspace *workspace)
+{
+    if (m_workspace) {
+        disconnect(m_workspace->dockManager(), nullptr, this, nullptr);
+        disconnect(m_workspace->layoutManager(), nullptr, this, nullptr);
+        m_workspace->removeEventFilter(this);
+    }
+    m_workspace = workspace;
+    m_loading = false;
+    if (!workspace)
+        return;
+    connectWorkspace();
+    queueSnapshot();
+}
+
+LayoutSync::Delta LayoutSync::snapshot() const
+{
+    Delta snapshot;
+    snapshot.type = Snapshot;
+    snapshot.state = m_workspace->saveState(LayoutManager::kNativeStateVersion);
+    if (const FloatingOverlay *overlay = FloatingOverlay::find(m_workspace)) {
+        for (QDockWidget *dock : overlay->docks()) {
+            Panel panel;
+            panel.dock = dock->objectName();
+            panel.position = FloatingOverlay::floatingGeometry(dock).topLeft();
+            panel.size = dock->size();
+            panel.visible = !dock->isHidden();
+            snapshot.panels.append(panel);
+        }
+    }
+    return snapshot;
+}
+
+// Only when joined: joining brings a snapshot of its own
+void LayoutSync::queueSnapshot()
+{
+    if (!m_joined)
+        return;
+    queueLocal(snapshot());
+}
+
+// Resizing the window relays the docks out; the other instances' windows
+// have their own sizes, so none of that is sent
+bool LayoutSync::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_workspace.data() && event->type() == QEvent::Resize) {
+        m_settleUntil = m_clock.elapsed() + kSettleMs;
+        // Dock resizes from this relayout may already be queued
+        m_outgoing.erase(std::remove_if(m_outgoing.begin(), m_outgoing.end(), [](const Delta &delta) {
+            return delta.type == Resize;
+        }), m_outgoing.end());
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void LayoutSync::connectWorkspace()
+{
+    DockManager *dockManager = m_workspace->dockManager();
+    connect(dockManager, &DockManager::dockWidgetMoved, this, [this](const QString &name, Qt::DockWidgetArea area) {
+        Delta delta;
+        delta.type = Move;
+        delta.dock = name;
+        delta.area = quint8(area);
+        queueLocal(delta);
+    });
+    connect(dockManager, &DockManager::dockWidgetTabified, this, [this](const QString &name, const QString &target) {
+        Delta delta;
+        delta.type = Tab;
+        delta.dock = name;
+        delta.target = target;
+        queueLocal(delta);
+    });
+    connect(dockManager, &DockManager::dockWidgetFloated, this, [this](const QString &name, bool floating, const QPoint &position) {
+        Delta delta;
+        delta.type = Float;
+        delta.dock = name;
+        delta.flag = floating;
+        delta.position = position;
+        queueLocal(delta);
+    });
+    connect(dockManager, &DockManager::dockWidgetResized, this, [this](const QString &name, const QSize &size) {
+        Delta delta;
+        delta.type = Resize;
+        delta.dock = name;
+        delta.size = size;
+        queueLocal(delta);
+    });
+    connect(dockManager, &DockManager::dockWidgetVisibilityChanged, this, [this](const QString &name, bool visible) {
+        Delta delta;
+        delta.type = Visible;
+        delta.dock = name;
+        delta.flag = visible;
+        queueLocal(delta);
+    });
+
+    // A layout load moves every dock; one snapshot afterwards replaces the
+    // deltas it would produce. A failed load may have moved some already.
+    LayoutManager *layoutManager = m_workspace->layoutManager();
+    connect(layoutManager, &LayoutManager::layoutAboutToLoad, this, [this]() {
+        m_loading = true;
+        m_outgoing.clear();
+    });
+    auto finishLoad = [this]() {
+        if (!m_loading)
+            return;
+        m_loading = false;
+        m_settleUntil = m_clock.elapsed() + kSettleMs;
+        queueSnapshot();
+    };
+    connect(layoutManager, &LayoutManager::layoutLoaded, this, finishLoad);
+    connect(layoutManager, &LayoutManager::layoutFailed, this, finishLoad);
+
+    m_workspace->installEventFilter(this);
+}
+
+void LayoutSync::start()
+{
+    if (m_server || m_hub)
+        return;
+
+    QLocalSocket *socket = new QLocalSocket(this);
+    socket->connectToServer(m_serverName);
+    if (!socket->waitForConnected(kConnectTimeoutMs)) {
+        const QLocalSocket::LocalSocketError error = socket->error();
+        delete socket;
+        // A refused connection means a stale socket file left by a crashed hub
+        if (error == QLocalSocket::ConnectionRefusedError)
+            QLocalServer::removeServer(m_serverName);
+        becomeHub();
+        return;
+    }
+
+    m_hub = socket;
+    connect(m_hub, &QLocalSocket::readyRead, this, &LayoutSync::readFromHub);
+    connect(m_hub, &QLocalSocket::disconnected, this, &LayoutSync::hubLost);
+    qCDebug(lcSync) << "Layout sync: joined" << m_serverName << "as peer";
+}
+
+void LayoutSync::becomeHub()
+{
+    QLocalServer *server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server->listen(m_serverName)) {
+        // Another instance won the race; join it instead
+        delete server;
+        m_rejoinTimer.start(QRandomGenerator::global()->bounded(20, 200));
+        return;
+    }
+
+    m_server = server;
+    connect(m_server, &QLocalServer::newConnection, this, &LayoutSync::acceptPeer);
+    m_joined = true;
+    qCDebug(lcSync) << "Layout sync: listening on" << m_serverName << "as hub";
+    emit joined();
+}
+
+void LayoutSync::hubLost()
+{
+    qCDebug(lcSync) << "Layout sync: hub went away, rejoining";
+    m_readBuffers.remove(m_hub);
+    m_hub->deleteLater();
+    m_hub = nullptr;
+    m_joined = false;
+    // Spread the peers out so one of them wins the election cleanly
+    m_rejoinTimer.start(QRandomGenerator::global()->bounded(20, 200));
+}
+
+void LayoutSync::acceptPeer()
+{
+    while (QLocalSocket *peer = m_server->nextPendingConnection()) {
+        m_peers.append(peer);
+        connect(peer, &QLocalSocket::readyRead, this, &LayoutSync::readFromPeer);
+        connect(peer, &QLocalSocket::disconnected, this, [this, peer]() {
+            m_peers.removeOne(peer);
+            m_readBuffers.remove(peer);
+            peer->deleteLater();
+        });
+        // Deltas already applied here must reach the others before the snapshot
+        flushOutgoing();
+        sendSnapshot(peer);
+    }
+}
+
+void LayoutSync::sendSnapshot(QLocalSocket *socket)
+{
+    if (!m_workspace)
+        return;
+    const QByteArray frame = encode(snapshot());
+    socket->write(frame);
+    m_bytesSent += frame.size();
+}
+
+void LayoutSync::sendToPeers(const QByteArray &frames, QLocalSocket *skip)
+{
+    for (QLocalSocket *peer : qAsConst(m_peers)) {
+        if (peer != skip) {
+            peer->write(frames);
+            m_bytesSent += frames.size();
+        }
+    }
+}
+
+bool LayoutSync::suppressLocal(MessageType type) const
+{
+    if (m_applying || m_loading)
+        return true;
+    return type == Resize && m_clock.elapsed() < m_settleUntil;
+}
+
+void LayoutSync::queueLocal(const Delta &delta)
+{
+    if (suppressLocal(delta.type))
+        return;
+
+    // Only the last size or floating position of a dock in a batch matters
+    if (delta.type == Resize || (delta.type == Float && delta.flag)) {
+        for (Delta &pending : m_outgoing) {
+            if (pending.type == delta.type && pending.dock == delta.dock && pending.flag == delta.flag) {
+                pending = delta;
+                return;
+            }
+        }
+    }
+    m_outgoing.append(delta);
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+void LayoutSync::flushOutgoing()
+{
+    if (m_outgoing.isEmpty())
+        return;
+    m_flushTimer.stop();
+
+    QByteArray frames;
+    for (const Delta &delta : qAsConst(m_outgoing))
+        frames += encode(delta);
+    const int count = m_outgoing.size();
+    m_outgoing.clear();
+
+    if (m_server) {
+        // The hub's own changes are already applied and take their place in
+        // the sequence now
+        sendToPeers(frames);
+        m_deltasApplied += count;
+    } else if (m_hub && m_joined) {
+        m_hub->write(frames);
+        m_bytesSent += frames.size();
+    } else {
+        // Not joined: the snapshot on join supersedes these
+        return;
+    }
+    m_deltasSent += count;
+}
+
+void LayoutSync::readFromPeer()
+{
+    QLocalSocket *peer = qobject_cast<QLocalSocket*>(sender());
+    if (!peer)
+        return;
+    QByteArray &buffer = m_readBuffers[peer];
+    buffer += peer->readAll();
+    bool valid = true;
+    const QVector<Delta> deltas = takeFrames(buffer, &valid);
+    if (!valid) {
+        dropConnection(peer);
+        return;
+    }
+    if (deltas.isEmpty())
+        return;
+
+    // Local changes first, so the peers see the same order the hub applied
+    flushOutgoing();
+    QByteArray frames;
+    for (const Delta &delta : deltas)
+        frames += encode(delta);
+    sendToPeers(frames);
+    applyBatch(deltas);
+}
+
+void LayoutSync::readFromHub()
+{
+    QByteArray &buffer = m_readBuffers[m_hub];
+    buffer += m_hub->readAll();
+    bool valid = true;
+    QVector<Delta> deltas = takeFrames(buffer, &valid);
+    if (!valid) {
+        dropConnection(m_hub);
+        return;
+    }
+    if (deltas.isEmpty())
+        return;
+
+    if (!m_joined) {
+        // The first message after connecting is the hub's snapshot
+        if (deltas.first().type != Snapshot)
+            return;
+        m_outgoing.clear();
+        m_joined = true;
+        emit joined();
+    }
+    applyBatch(deltas);
+}
+
+// Stops at the first frame longer than kMaxFrameBytes, clearing valid;
+// the caller drops the connection since the stream cannot be resynced
+QVector<LayoutSync::Delta> LayoutSync::takeFrames(QByteArray &buffer, bool *valid)
+{
+    QVector<Delta> deltas;
+    int offset = 0;
+    while (buffer.size() - offset >= 4) {
+        const quint32 length = qFromBigEndian<quint32>(buffer.constData() + offset);
+        if (length > kMaxFrameBytes) {
+            *valid = false;
+            return deltas;
+        }
+        if (buffer.size() - offset - 4 < int(length))
+            break;
+        Delta delta;
+        if (decode(buffer.mid(offset + 4, int(length)), &delta))
+            deltas.append(delta);
+        offset += 4 + int(length);
+    }
+    buffer.remove(0, offset);
+    return deltas;
+}
+
+// The buffer goes first: disconnecting may remove it from m_readBuffers
+void LayoutSync::dropConnection(QLocalSocket *socket)
+{
+    qWarning() << "Layout sync: dropping connection after an oversized frame";
+    m_readBuffers.remove(socket);
+    socket->disconnectFromServer();
+}
+
+// One pass per batch: widgets are updated once and all sizes go through a
+// single resizeDocks() call per orientation.
+void LayoutSync::applyBatch(const QVector<Delta> &deltas)
+{
+    if (!m_workspace)
+        return;
+
+    m_applying = true;
+    m_workspace->setUpdatesEnabled(false);
+    int applied = 0;
+    for (const Delta &delta : deltas) {
+        apply(delta);
+        if (delta.type != Snapshot)
+            ++applied;
+    }
+
+    if (!m_pendingSizes.isEmpty()) {
+        QList<QDockWidget*> docks;
+        QList<int> widths;
+        QList<int> heights;
+        for (auto it = m_pendingSizes.cbegin(); it != m_pendingSizes.cend(); ++it) {
+            QDockWidget *dock = m_workspace->dockManager()->findDockWidget(it.key());
+            if (!dock)
+                continue;
+            if (FloatingOverlay::isFloating(dock)) {
+                dock->resize(it.value());
+                continue;
+            }
+            docks.append(dock);
+            widths.append(it.value().width());
+            heights.append(it.value().height());
+        }
+        if (!docks.isEmpty()) {
+            m_workspace->resizeDocks(docks, widths, Qt::Horizontal);
+            m_workspace->resizeDocks(docks, heights, Qt::Vertical);
+        }
+        m_pendingSizes.clear();
+    }
+
+    m_workspace->setUpdatesEnabled(true);
+    m_applying = false;
+    m_settleUntil = m_clock.elapsed() + kSettleMs;
+    m_deltasApplied += applied;
+    emit deltasReceived(applied);
+}
+
+void LayoutSync::apply(const Delta &delta)
+{
+    if (delta.type == Snapshot) {
+        applySnapshot(delta);
+        return;
+    }
+
+    QDockWidget *dock = m_workspace->dockManager()->findDockWidget(delta.dock);
+    if (!dock)
+        return;
+
+    switch (delta.type) {
+    case Move:
+        // Always re-add: the sender's dock also left any tab group it was in
+        m_workspace->addDockWidget(Qt::DockWidgetArea(delta.area), dock);
+        break;
+    case Float:
+        // Positions are global whichever way either side floats its docks
+        if (delta.flag || FloatingOverlay::isFloating(dock))
+            FloatingOverlay::setFloating(dock, delta.flag, delta.flag ? delta.position : QPoint());
+        break;
+    case Tab:
+        if (QDockWidget *target = m_workspace->dockManager()->findDockWidget(delta.target)) {
+            if (target != dock && !m_workspace->tabifiedDockWidgets(target).contains(dock))
+                m_workspace->tabifyDockWidget(target, dock);
+        }
+        break;
+    case Resize:
+        m_pendingSizes[delta.dock] = delta.size;
+        break;
+    case Visible:
+        dock->setVisible(delta.flag);
+        break;
+    default:
+        break;
+    }
+}
+
+void LayoutSync::applySnapshot(const Delta &snapshot)
+{
+    // restoreState() only places docks of the main window, so panels the
+    // snapshot does not have are docked first
+    QSet<QString> panelDocks;
+    for (const Panel &panel : snapshot.panels)
+        panelDocks.insert(panel.dock);
+    if (FloatingOverlay *overlay = FloatingOverlay::find(m_workspace)) {
+        for (QDockWidget *dock : overlay->docks()) {
+            if (!panelDocks.contains(dock->objectName()))
+                FloatingOverlay::setFloating(dock, false);
+        }
+    }
+    m_workspace->restoreState(snapshot.state, LayoutManager::kNativeStateVersion);
+
+    for (const Panel &panel : snapshot.panels) {
+        QDockWidget *dock = m_workspace->dockManager()->findDockWidget(panel.dock);
+        if (!dock)
+            continue;
+        FloatingOverlay::setFloating(dock, true, panel.position);
+        if (panel.size.isValid())
+            dock->resize(panel.size);
+        dock->setVisible(panel.visible);
+    }
+}
+
+QByteArray LayoutSync::encode(const Delta &delta)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << quint8(delta.type) << delta.dock.toUtf8();
+    switch (delta.type) {
+    case Snapshot:
+        stream << delta.state << quint32(delta.panels.size());
+        for (const Panel &panel : delta.panels) {
+            stream << panel.dock.toUtf8() << qint32(panel.position.x()) << qint32(panel.position.y())
+                   << qint32(panel.size.width()) << qint32(panel.size.height()) << panel.visible;
+        }
+        break;
+    case Move:
+        stream << delta.area;
+        break;
+    case Float:
+        stream << delta.flag << qint32(delta.position.x()) << qint32(delta.position.y());
+        break;
+    case Tab:
+        stream << delta.target.toUtf8();
+        break;
+    case Resize:
+        stream << qint32(delta.size.width()) << qint32(delta.size.height());
+        break;
+    case Visible:
+        stream << delta.flag;
+        break;
+    }
+
+    QByteArray frame(4, Qt::Uninitialized);
+    qToBigEndian<quint32>(quint32(payload.size()), frame.data());
+    return frame + payload;
+}
+
+bool LayoutSync::decode(const QByteArray &frame, Delta *delta)
+{
+    QDataStream stream(frame);
+    stream.setVersion(QDataStream::Qt_5_12);
+    quint8 type = 0;
+    QByteArray dock;
+    stream >> type >> dock;
+    delta->type = MessageType(type);
+    delta->dock = QString::fromUtf8(dock);
+
+    qint32 x = 0;
+    qint32 y = 0;
+    switch (delta->type) {
+    case Snapshot: {
+        quint32 count = 0;
+        stream >> delta->state >> count;
+        // Each panel takes well over one byte, so a count past the frame is corrupt
+        if (count > quint32(frame.size()))
+            return false;
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            Panel panel;
+            QByteArray name;
+            qint32 width = 0;
+            qint32 height = 0;
+            stream >> name >> x >> y >> width >> height >> panel.visible;
+            panel.dock = QString::fromUtf8(name);
+            panel.position = QPoint(x, y);
+            panel.size = QSize(width, height);
+            delta->panels.append(panel);
+        }
+        break;
+    }
+    case Move:
+        stream >> delta->area;
+        break;
+    case Float:
+        stream >> delta->flag >> x >> y;
+        delta->position = QPoint(x, y);
+        break;
+    case Tab: {
+        QByteArray target;
+        stream >> target;
+        delta->target = QString::fromUtf8(target);
+        break;
+    }
+    case Resize:
+        stream >> x >> y;
+        delta->size = QSize(x, y);
+        break;
+    case Visible:
+        stream >> delta->flag;
+        break;
+    default:
+        return false;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+QByteArray LayoutSync::digest() const
+{
+    if (!m_workspace)
+        return QByteArray();
+
+    QList<QDockWidget*> docks = m_workspace->dockManager()->allDockWidgets();
+    std::sort(docks.begin(), docks.end(), [](QDockWidget *a, QDockWidget *b) {
+        return a->objectName() < b->objectName();
+    });
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (QDockWidget *dock : docks) {
+        QStringList group = { dock->objectName() };
+        for (QDockWidget *tabbed : m_workspace->tabifiedDockWidgets(dock))
+            group.append(tabbed->objectName());
+        group.sort();
+        const QString line = QString("%1|%2|%3|%4|%5\n")
+                                 .arg(dock->objectName())
+                                 .arg(int(m_workspace->dockWidgetArea(dock)))
+                                 .arg(FloatingOverlay::isFloating(dock))
+                                 .arg(!dock->isHidden())
+                                 .arg(group.first());
+        hash.addData(line.toUtf8());
+    }
+    return hash.result().toHex().left(16);
+}
@@ -0,0 +1,137 @@
+#ifndef LAYOUTSYNC_H
+#define LAYOUTSYNC_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QPoint>
+#include <QPointer>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+
+class QLocalServer;
+class QLocalSocket;
+class Workspace;
+
+// Keeps the dock arrangement of several local instances in step. The first
+// instance to start listens on the server name and becomes the hub; the
+// others connect to it. Local changes are sent as small delta messages,
+// batched per frame; a layout load is sent as one snapshot instead, and
+// dock resizes caused by resizing the window are not sent at all. The hub
+// applies each delta and relays it to every peer, the sender included, so
+// all instances apply the same sequence and converge. A peer receives a
+// full snapshot only when it (re)joins; if the hub goes away the peers
+// elect a new one and rejoin.
+class LayoutSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum MessageType : quint8 {
+        Snapshot = 1,
+        Move,
+        Float,
+        Tab,
+        Resize,
+        Visible
+    };
+
+    // A dock floating in the overlay, which the native state leaves out
+    struct Panel
+    {
+        QString dock;
+        QPoint position;
+        QSize size;
+        bool visible = true;
+    };
+
+    struct Delta
+    {
+        MessageType type = Move;
+        QString dock;
+        QString target;
+        quint8 area = 0;
+        bool flag = false;
+        QPoint position;
+        QSize size;
+        QByteArray state;
+        QVector<Panel> panels;
+    };
+
+    explicit LayoutSync(const QString &serverName, QObject *parent = nullptr);
+    ~LayoutSync();
+
+    // Attaching another workspace publishes it as a snapshot, since a
+    // preset switch replaces the whole arrangement.
+    void setWorkspace(Workspace *workspace);
+    void start();
+
+    bool isHub() const { return m_server != nullptr; }
+    bool hasJoined() const { return m_joined; }
+    quint64 deltasSent() const { return m_deltasSent; }
+    quint64 deltasApplied() const { return m_deltasApplied; }
+    quint64 bytesSent() const { return m_bytesSent; }
+
+    // Hash of what sync keeps equal: area, floating, visibility and tab
+    // group of every dock. Sizes are left out since windows may differ.
+    QByteArray digest() const;
+
+    // --sync[=name]
+    static bool requested(const QStringList &arguments, QString *serverName);
+
+    static QByteArray encode(const Delta &delta);
+    static bool decode(const QByteArray &frame, Delta *delta);
+
+signals:
+    void joined();
+    void deltasReceived(int count);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void acceptPeer();
+    void readFromHub();
+    void readFromPeer();
+    void hubLost();
+    void flushOutgoing();
+
+private:
+    void becomeHub();
+    void connectWorkspace();
+    Delta snapshot() const;
+    void queueSnapshot();
+    void queueLocal(const Delta &delta);
+    void sendToPeers(const QByteArray &frames, QLocalSocket *skip = nullptr);
+    void sendSnapshot(QLocalSocket *socket);
+    QVector<Delta> takeFrames(QByteArray &buffer, bool *valid);
+    void dropConnection(QLocalSocket *socket);
+    void applyBatch(const QVector<Delta> &deltas);
+    void apply(const Delta &delta);
+    void applySnapshot(const Delta &snapshot);
+    bool suppressLocal(MessageType type) const;
+
+    QString m_serverName;
+    QPointer<Workspace> m_workspace;
+    QLocalServer *m_server = nullptr;
+    QLocalSocket *m_hub = nullptr;
+    QList<QLocalSocket*> m_peers;
+    QHash<QLocalSocket*, QByteArray> m_readBuffers;
+    QVector<Delta> m_outgoing;
+    QTimer m_flushTimer;
+    QTimer m_rejoinTimer;
+    QElapsedTimer m_clock;
+    QMap<QString, QSize> m_pendingSizes;
+    bool m_joined = false;
+    bool m_applying = false;
+    // Between layoutAboutToLoad and the load's end
+    bool m_loading = false;
+    qint64 m_settleUntil = 0;
+    quint64 m_deltasSent = 0;
+    quint64 m_deltasApplied = 0;
+    quint64 m_bytesSent = 0;
+};
+
+#endif // LAYOUTSYNC_H
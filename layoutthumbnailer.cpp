@@ -0,0 +1,190 @@
+#include "layoutthumbnailer.h"
+#include "layoutdocument.h"
+#include "colorswatch.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QMap>
+
+// Bump when the thumbnail drawing changes so stale cache entries are ignored
+static const int kThumbnailFormatVersion = 1;
+// A few hundred thumbnails; one of the menu's is a couple of KB
+static const qint64 kMaxCacheBytes = 4 * 1024 * 1024;
+
+LayoutThumbnailer::LayoutThumbnailer(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+LayoutThumbnailer::~LayoutThumbnailer()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QString LayoutThumbnailer::cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/layout-thumbnails";
+}
+
+void LayoutThumbnailer::requestThumbnail(const QString &fileName, const QSize &size, qreal devicePixelRatio)
+{
+    const quint64 generation = ++m_generation;
+    m_generations.insert(fileName, generation);
+    m_pool.start([this, fileName, size, devicePixelRatio, generation]() {
+        QFile file(fileName);
+        if (!file.open(QFile::ReadOnly))
+            return;
+        const QByteArray data = file.readAll();
+        file.close();
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(data);
+        const QString cacheName = QString("%1-%2x%3@%4-v%5.png")
+                                      .arg(QString::fromLatin1(hash.result().toHex()))
+                                      .arg(size.width()).arg(size.height())
+                                      .arg(devicePixelRatio).arg(kThumbnailFormatVersion);
+        const QString cachePath = cacheDirectory() + "/" + cacheName;
+
+        QImage image;
+        if (image.load(cachePath)) {
+            image.setDevicePixelRatio(devicePixelRatio);
+            // Pruning goes by modification time, so a hit counts as a use
+            QFile cached(cachePath);
+            if (cached.open(QIODevice::ReadOnly))
+                cached.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        } else {
+            LayoutDocument document;
+            if (!document.read(data))
+                return;
+            image = renderThumbnail(document, size, devicePixelRatio);
+
+            QDir().mkpath(cacheDirectory());
+            QSaveFile cacheFile(cachePath);
+            if (cacheFile.open(QIODevice::WriteOnly) && image.save(&cacheFile, "PNG") && cacheFile.commit())
+                pruneCache(cacheName);
+        }
+
+        QMetaObject::invokeMethod(this, [this, fileName, image, generation]() {
+            // A file edited while its thumbnail was rendering is requested
+            // again; the older render may finish last
+            if (m_generations.value(fileName) != generation)
+                return;
+            m_generations.remove(fileName);
+            emit thumbnailReady(fileName, image);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Runs on a pool thread after a new entry is written. Entries are removed
+// least recently used first; two threads pruning at once only race to remove the same file.
+void LayoutThumbnailer::pruneCache(const QString &keep)
+{
+    QDir dir(cacheDirectory());
+    const QFileInfoList entries = dir.entryInfoList({ "*.png" }, QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo &entry : entries) {
+        total += entry.size();
+        if (total > kMaxCacheBytes && entry.fileName() != keep)
+            QFile::remove(entry.absoluteFilePath());
+    }
+}
+
+// Lays the docks out the way QMainWindow does by default: top and bottom
+// areas span the full width, left and right areas fill the space between
+// them, and docks in one area share it in proportion to their saved size.
+QImage LayoutThumbnailer::renderThumbnail(const LayoutDocument &document, const QSize &size, qreal devicePixelRatio)
+{
+    QImage image(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(QColor("#FFFFFF"));
+
+    const QSize windowSize = document.geometry.size().isValid()
+                                 ? document.geometry.size() : QSize(800, 600);
+    const qreal sx = qreal(size.width()) / windowSize.width();
+    const qreal sy = qreal(size.height()) / windowSize.height();
+
+    QMap<QString, QVector<const LayoutDocument::DockEntry*>> areas;
+    QVector<const LayoutDocument::DockEntry*> floating;
+    QStringList tabFollowers;
+    for (const LayoutDocument::DockEntry &dock : document.docks)
+        tabFollowers += dock.tabbedWith;
+    for (const LayoutDocument::DockEntry &dock : document.docks) {
+        if (!dock.visible || tabFollowers.contains(dock.name))
+            continue;
+        if (dock.floating)
+            floating.append(&dock);
+        else
+            areas[dock.dockArea.isEmpty() ? QString("Left") : dock.dockArea].append(&dock);
+    }
+
+    auto bandThickness = [&](const QString &area, bool horizontal) {
+        int thickness = 0;
+        for (const LayoutDocument::DockEntry *dock : areas.value(area))
+            thickness = qMax(thickness, horizontal ? dock->size.height() : dock->size.width());
+        return horizontal ? qRound(thickness * sy) : qRound(thickness * sx);
+    };
+
+    const int maxW = size.width() * 2 / 5;
+    const int maxH = size.height() * 2 / 5;
+    const int top = qMin(bandThickness("Top", true), maxH);
+    const int bottom = qMin(bandThickness("Bottom", true), maxH);
+    const int left = qMin(bandThickness("Left", false), maxW);
+    const int right = qMin(bandThickness("Right", false), maxW);
+
+    QPainter painter(&image);
+    auto fillBand = [&](const QString &area, const QRect &band, bool horizontal) {
+        const QVector<const LayoutDocument::DockEntry*> docks = areas.value(area);
+        if (docks.isEmpty() || band.isEmpty())
+            return;
+        int total = 0;
+        for (const LayoutDocument::DockEntry *dock : docks)
+            total += qMax(1, horizontal ? dock->size.width() : dock->size.height());
+
+        int offset = 0;
+        for (int i = 0; i < docks.size(); ++i) {
+            const LayoutDocument::DockEntry *dock = docks.at(i);
+            const int length = horizontal ? band.width() : band.height();
+            const int weight = qMax(1, horizontal ? dock->size.width() : dock->size.height());
+            const int extent = i == docks.size() - 1 ? length - offset : length * weight / total;
+            const QRect r = horizontal ? QRect(band.left() + offset, band.top(), extent, band.height())
+                                       : QRect(band.left(), band.top() + offset, band.width(), extent);
+            const QColor color = fgColorForName(LayoutDocument::colorNameForDock(dock->name));
+            painter.fillRect(r, color);
+            painter.setPen(color.darker(150));
+            painter.drawRect(r.adjusted(0, 0, -1, -1));
+            if (!dock->tabbedWith.isEmpty())
+                painter.fillRect(QRect(r.left() + 1, r.bottom() - 2, qMax(2, r.width() / 3), 2), color.darker(150));
+            offset += extent;
+        }
+    };
+
+    fillBand("Top", QRect(0, 0, size.width(), top), true);
+    fillBand("Bottom", QRect(0, size.height() - bottom, size.width(), bottom), true);
+    fillBand("Left", QRect(0, top, left, size.height() - top - bottom), false);
+    fillBand("Right", QRect(size.width() - right, top, right, size.height() - top - bottom), false);
+
+    for (const LayoutDocument::DockEntry *dock : floating) {
+        const QPoint pos = dock->position - document.geometry.topLeft();
+        QRect r(qRound(pos.x() * sx), qRound(pos.y() * sy),
+                qMax(4, qRound(dock->size.width() * sx)), qMax(4, qRound(dock->size.height() * sy)));
+        r = r.intersected(QRect(QPoint(0, 0), size));
+        const QColor color = fgColorForName(LayoutDocument::colorNameForDock(dock->name));
+        painter.setOpacity(0.8);
+        painter.fillRect(r, color);
+        painter.setOpacity(1.0);
+        painter.setPen(color.darker(150));
+        painter.drawRect(r.adjusted(0, 0, -1, -1));
+    }
+
+    painter.setPen(QColor("#AAAAAA"));
+    painter.drawRect(QRect(QPoint(0, 0), size).adjusted(0, 0, -1, -1));
+    return image;
+}
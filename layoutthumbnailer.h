@@ -0,0 +1,42 @@
+#ifndef LAYOUTTHUMBNAILER_H
+#define LAYOUTTHUMBNAILER_H
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QSize>
+#include <QThreadPool>
+
+class LayoutDocument;
+
+// Renders small previews of layout files on worker threads. Thumbnails are
+// drawn straight from the parsed file (no widgets are built) and cached on
+// disk keyed by the file's content hash; the oldest cache entries are
+// removed once the cache outgrows its budget. Only the latest request for
+// a file is reported.
+class LayoutThumbnailer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LayoutThumbnailer(QObject *parent = nullptr);
+    ~LayoutThumbnailer();
+
+    void requestThumbnail(const QString &fileName, const QSize &size, qreal devicePixelRatio = 1.0);
+
+    static QImage renderThumbnail(const LayoutDocument &document, const QSize &size, qreal devicePixelRatio);
+    static QString cacheDirectory();
+
+signals:
+    void thumbnailReady(const QString &fileName, const QImage &image);
+
+private:
+    static void pruneCache(const QString &keep);
+
+    QThreadPool m_pool;
+    // Latest request per file; results of older ones are dropped
+    QHash<QString, quint64> m_generations;
+    quint64 m_generation = 0;
+};
+
+#endif // LAYOUTTHUMBNAILER_H
@@ -0,0 +1,286 @@
+#include "layouttool.h"
+#include "dockmanager.h"
+#include "layoutlibrary.h"
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
+
+bool LayoutTool::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--layout-tool") == 0)
+            return true;
+    }
+    return false;
+}
+
+void LayoutTool::printUsage()
+{
+    QTextStream(stderr)
+        << "Usage: MainWindows --layout-tool <command> [options] files...\n"
+           "Commands:\n"
+           "  validate    check files and report problems\n"
+           "  normalize   rewrite files in canonical form (in place unless --output-dir)\n"
+           "  convert     write files in another format next to the input or into --output-dir\n"
+           "  pack        add files to the layout library given by --library, named by base name\n"
+           "  list        print the index of the layout library given by --library\n"
+           "Options:\n"
+           "  --to=xml|compact|json   output format for convert (default xml)\n"
+           "  --output-dir=DIR        directory for normalized or converted files\n"
+           "  --library=FILE          layout library for pack and list\n"
+           "  --match=TEXT            list only layouts whose name contains TEXT\n"
+           "  --known-docks=A,B,...   dock names to accept (default: the built-in docks)\n"
+           "  --any-docks             do not check dock names\n"
+           "  --jobs=N                worker threads (default: all cores)\n"
+           "  --strict                treat warnings as errors\n"
+           "  --dry-run               check and convert but do not write files\n";
+}
+
+bool LayoutTool::parseArguments(const QStringList &arguments)
+{
+    m_knownDocks = DockManager::defaultDockNames();
+
+    bool afterTool = false;
+    for (const QString &argument : arguments.mid(1)) {
+        if (!afterTool) {
+            afterTool = argument == "--layout-tool";
+            continue;
+        }
+        if (argument.startsWith("--to=")) {
+            m_format = argument.mid(5);
+        } else if (argument.startsWith("--output-dir=")) {
+            m_outputDirectory = argument.mid(13);
+        } else if (argument.startsWith("--library=")) {
+            m_library = argument.mid(10);
+        } else if (argument.startsWith("--match=")) {
+            m_match = argument.mid(8);
+        } else if (argument.startsWith("--known-docks=")) {
+            m_knownDocks = argument.mid(14).split(',', Qt::SkipEmptyParts);
+        } else if (argument == "--any-docks") {
+            m_knownDocks.clear();
+        } else if (argument.startsWith("--jobs=")) {
+            m_jobs = argument.mid(7).toInt();
+        } else if (argument == "--strict") {
+            m_strict = true;
+        } else if (argument == "--dry-run") {
+            m_dryRun = true;
+        } else if (argument.startsWith("--")) {
+            QTextStream(stderr) << "Unknown option: " << argument << "\n";
+            return false;
+        } else if (m_command.isEmpty()) {
+            m_command = argument;
+        } else {
+            m_files.append(argument);
+        }
+    }
+
+    static const QStringList commands = { "validate", "normalize", "convert", "pack", "list" };
+    static const QStringList formats = { "xml", "compact", "json" };
+    if (!commands.contains(m_command)) {
+        QTextStream(stderr) << "Unknown command: " << m_command << "\n";
+        return false;
+    }
+    if (!formats.contains(m_format)) {
+        QTextStream(stderr) << "Unknown format: " << m_format << "\n";
+        return false;
+    }
+    if ((m_command == "pack" || m_command == "list") && m_library.isEmpty()) {
+        QTextStream(stderr) << m_command << " needs --library\n";
+        return false;
+    }
+    if (m_files.isEmpty() && m_command != "list") {
+        QTextStream(stderr) << "No layout files given\n";
+        return false;
+    }
+    return true;
+}
+
+int LayoutTool::run(const QStringList &arguments)
+{
+    if (!parseArguments(arguments)) {
+        printUsage();
+        return UsageError;
+    }
+    if (m_command == "list")
+        return listLibrary();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Results are preallocated so every task writes only its own slot
+    QVector<Result> results(m_files.size());
+    for (int i = 0; i < m_files.size(); ++i)
+        results[i].fileName = m_files.at(i);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_jobs > 0 ? m_jobs : QThread::idealThreadCount());
+    Result *entries = results.data();
+    for (int i = 0; i < results.size(); ++i)
+        pool.start([this, entries, i]() { process(entries[i]); });
+    pool.waitForDone();
+
+    QTextStream out(stdout);
+    int failedFiles = 0;
+    int errors = 0;
+    int warnings = 0;
+    for (const Result &result : results) {
+        for (const LayoutDocument::Issue &issue : result.issues) {
+            const bool error = issue.severity == LayoutDocument::Issue::Error;
+            out << result.fileName << ":" << issue.line << ": "
+                << (error ? "error: " : "warning: ") << issue.message << "\n";
+            if (error)
+                ++errors;
+            else
+                ++warnings;
+        }
+        if (result.failed)
+            ++failedFiles;
+        else if (!result.outputName.isEmpty() && !m_dryRun)
+            out << result.fileName << ": wrote " << result.outputName << "\n";
+    }
+
+    if (m_command == "pack" && !m_dryRun) {
+        QString errorString;
+        if (!packLibrary(results, &errorString)) {
+            out << m_library << ": " << errorString << "\n";
+            ++failedFiles;
+        }
+    }
+
+    out << QString("%1 %2 file(s): %3 failed, %4 error(s), %5 warning(s) in %6 ms on %7 thread(s)\n")
+               .arg(m_command).arg(results.size()).arg(failedFiles).arg(errors).arg(warnings)
+               .arg(timer.elapsed()).arg(pool.maxThreadCount());
+    return failedFiles > 0 ? Failed : Success;
+}
+
+void LayoutTool::process(Result &result) const
+{
+    QFile file(result.fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        result.issues.append({ LayoutDocument::Issue::Error, 0, file.errorString() });
+        result.failed = true;
+        return;
+    }
+
+    LayoutDocument document;
+    const bool parsed = document.read(&file);
+    file.close();
+    if (parsed)
+        document.validate(m_knownDocks);
+    result.issues = document.issues;
+
+    bool failed = !parsed || document.hasErrors();
+    if (m_strict && !result.issues.isEmpty())
+        failed = true;
+    result.failed = failed;
+    if (failed || m_command == "validate")
+        return;
+
+    // Packed layouts are stored normalized; the library is written once
+    // all files are processed
+    if (m_command == "pack") {
+        QBuffer buffer(&result.packed);
+        buffer.open(QIODevice::WriteOnly);
+        document.write(&buffer, false);
+        return;
+    }
+
+    result.outputName = outputNameFor(result.fileName);
+    QString errorString;
+    if (!writeOutput(document, result.outputName, &errorString)) {
+        result.issues.append({ LayoutDocument::Issue::Error, 0, errorString });
+        result.failed = true;
+    }
+}
+
+QString LayoutTool::outputNameFor(const QString &fileName) const
+{
+    const QFileInfo info(fileName);
+    QString name = info.fileName();
+    if (m_command == "convert")
+        name = info.completeBaseName() + (m_format == "json" ? ".json" : ".xml");
+
+    if (!m_outputDirectory.isEmpty())
+        return QDir(m_outputDirectory).filePath(name);
+    if (m_command == "convert" && name == info.fileName())
+        name = info.completeBaseName() + "-" + m_format + ".xml";
+    return info.dir().filePath(name);
+}
+
+bool LayoutTool::writeOutput(const LayoutDocument &document, const QString &fileName, QString *errorString) const
+{
+    QByteArray data;
+    if (m_format == "json") {
+        data = QJsonDocument(document.toJson()).toJson(QJsonDocument::Indented);
+    } else {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        document.write(&buffer, m_format == "compact");
+    }
+    if (m_dryRun)
+        return true;
+
+    if (!m_outputDirectory.isEmpty())
+        QDir().mkpath(m_outputDirectory);
+
+    // Normalizing in place must never leave a half-written layout behind
+    QSaveFile output(fileName);
+    if (!output.open(QIODevice::WriteOnly) || output.write(data) != data.size() || !output.commit()) {
+        *errorString = QString("cannot write %1: %2").arg(fileName, output.errorString());
+        return false;
+    }
+    return true;
+}
+
+int LayoutTool::listLibrary() const
+{
+    QElapsedTimer timer;
+    timer.start();
+    LayoutLibrary library;
+    QTextStream out(stdout);
+    if (!library.open(m_library)) {
+        out << m_library << ": " << library.errorString() << "\n";
+        return Failed;
+    }
+
+    const QVector<LayoutLibrary::Entry> entries = library.entries();
+    const QVector<int> matches = library.find(m_match);
+    for (int index : matches) {
+        const LayoutLibrary::Entry &entry = entries.at(index);
+        out << entry.name << "\t" << entry.modified.toString(Qt::ISODate) << "\t"
+            << entry.dockCount << " dock(s)\tschema " << entry.schemaVersion << "\t"
+            << entry.size << " bytes\t" << entry.hash.toHex().left(12) << "\n";
+    }
+    out << QString("list %1 of %2 layout(s) in %3 ms\n")
+               .arg(matches.size()).arg(entries.size()).arg(timer.elapsed());
+    return Success;
+}
+
+bool LayoutTool::packLibrary(const QVector<Result> &results, QString *errorString) const
+{
+    QMap<QString, QByteArray> layouts;
+    for (const Result &result : results) {
+        if (!result.failed)
+            layouts.insert(QFileInfo(result.fileName).completeBaseName(), result.packed);
+    }
+    if (layouts.isEmpty())
+        return true;
+
+    LayoutLibrary library;
+    if (!library.open(m_library) || !library.update(layouts)) {
+        *errorString = library.errorString();
+        return false;
+    }
+    QTextStream(stdout) << m_library << ": packed " << layouts.size() << " layout(s), "
+                        << library.entries().size() << " in library\n";
+    return true;
+}
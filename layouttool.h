@@ -0,0 +1,55 @@
+#ifndef LAYOUTTOOL_H
+#define LAYOUTTOOL_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "layoutdocument.h"
+
+// Headless layout file checker. Started with
+//   --layout-tool validate|normalize|convert|pack [options] files...
+// it processes the files in parallel without a display and returns
+// non-zero when any file has errors. "list" prints a layout library's
+// index.
+class LayoutTool
+{
+public:
+    enum ExitCode { Success = 0, Failed = 1, UsageError = 2 };
+
+    // Must be checked before any application object exists so the tool
+    // can run under QCoreApplication.
+    static bool requested(int argc, char *argv[]);
+
+    int run(const QStringList &arguments);
+
+private:
+    struct Result
+    {
+        QString fileName;
+        QString outputName;
+        QByteArray packed;
+        QVector<LayoutDocument::Issue> issues;
+        bool failed = false;
+    };
+
+    bool parseArguments(const QStringList &arguments);
+    void process(Result &result) const;
+    QString outputNameFor(const QString &fileName) const;
+    bool writeOutput(const LayoutDocument &document, const QString &fileName, QString *errorString) const;
+    int listLibrary() const;
+    bool packLibrary(const QVector<Result> &results, QString *errorString) const;
+    static void printUsage();
+
+    QString m_command;
+    QString m_format = "xml";
+    QString m_outputDirectory;
+    QString m_library;
+    QString m_match;
+    QStringList m_knownDocks;
+    QStringList m_files;
+    int m_jobs = 0;
+    bool m_strict = false;
+    bool m_dryRun = false;
+};
+
+#endif // LAYOUTTOOL_H
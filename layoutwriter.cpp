@@ -0,0 +1,266 @@
+#include "layoutwriter.h"
+#include <QIODevice>
+#include <QLocale>
+#include <charconv>
+#include <cstring>
+
+static const int kIndentWidth = 4;
+
+LayoutWriter::LayoutWriter(bool compact)
+    : m_compact(compact)
+{
+}
+
+void LayoutWriter::reset()
+{
+    m_size = 0;
+    m_open.clear();
+    m_startTagOpen = false;
+}
+
+bool LayoutWriter::writeTo(QIODevice *device) const
+{
+    return device->write(m_buffer.constData(), m_size) == m_size;
+}
+
+// Returns room for bytes more bytes; the caller moves m_size past what it used
+char *LayoutWriter::reserve(int bytes)
+{
+    if (m_size + bytes > m_buffer.size())
+        m_buffer.resize(qMax(m_size + bytes, qMax(4096, m_buffer.size() * 2)));
+    return m_buffer.data() + m_size;
+}
+
+void LayoutWriter::append(const char *data, int length)
+{
+    std::memcpy(reserve(length), data, size_t(length));
+    m_size += length;
+}
+
+void LayoutWriter::appendName(const char *name)
+{
+    append(name, int(std::strlen(name)));
+}
+
+// Worst case per UTF-16 unit is "&quot;", so 6 bytes each is always enough
+void LayoutWriter::appendEscaped(const QString &text, bool attribute)
+{
+    const QChar *in = text.constData();
+    const int length = text.size();
+    char *out = reserve(length * 6);
+    char *const start = out;
+
+    for (int i = 0; i < length; ++i) {
+        uint code = in[i].unicode();
+        if (code < 0x80) {
+            switch (code) {
+            case '<': std::memcpy(out, "&lt;", 4); out += 4; continue;
+            case '>': std::memcpy(out, "&gt;", 4); out += 4; continue;
+            case '&': std::memcpy(out, "&amp;", 5); out += 5; continue;
+            case '"':
+                if (attribute) {
+                    std::memcpy(out, "&quot;", 6);
+                    out += 6;
+                    continue;
+                }
+                break;
+            case '\n':
+            case '\r':
+            case '\t':
+                // Attribute values would be normalized to spaces otherwise
+                if (attribute) {
+                    *out++ = '&';
+                    *out++ = '#';
+                    if (code >= 10)
+                        *out++ = char('0' + code / 10);
+                    *out++ = char('0' + code % 10);
+                    *out++ = ';';
+                    continue;
+                }
+                break;
+            default:
+                // Other control characters cannot appear in XML 1.0
+                if (code < 0x20)
+                    continue;
+            }
+            *out++ = char(code);
+        } else if (code < 0x800) {
+            *out++ = char(0xc0 | (code >> 6));
+            *out++ = char(0x80 | (code & 0x3f));
+        } else {
+            if (QChar::isHighSurrogate(code) && i + 1 < length && in[i + 1].isLowSurrogate()) {
+                code = QChar::surrogateToUcs4(ushort(code), in[++i].unicode());
+                *out++ = char(0xf0 | (code >> 18));
+                *out++ = char(0x80 | ((code >> 12) & 0x3f));
+            } else if (QChar::isSurrogate(code)) {
+                continue;
+            } else {
+                *out++ = char(0xe0 | (code >> 12));
+            }
+            *out++ = char(0x80 | ((code >> 6) & 0x3f));
+            *out++ = char(0x80 | (code & 0x3f));
+        }
+    }
+    m_size += int(out - start);
+}
+
+void LayoutWriter::closeStartTag()
+{
+    if (m_startTagOpen) {
+        append(">", 1);
+        m_startTagOpen = false;
+    }
+}
+
+void LayoutWriter::indent(int depth)
+{
+    if (m_compact)
+        return;
+    char *out = reserve(1 + depth * kIndentWidth);
+    *out = '\n';
+    std::memset(out + 1, ' ', size_t(depth * kIndentWidth));
+    m_size += 1 + depth * kIndentWidth;
+}
+
+void LayoutWriter::writeStartDocument()
+{
+    static const char declaration[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    append(declaration, int(sizeof(declaration)) - 1);
+}
+
+void LayoutWriter::writeEndDocument()
+{
+    while (!m_open.isEmpty())
+        writeEndElement();
+    if (!m_compact)
+        append("\n", 1);
+}
+
+void LayoutWriter::writeStartElement(const char *name)
+{
+    closeStartTag();
+    if (!m_open.isEmpty())
+        m_open.last().hasChildren = true;
+    // The declaration is followed by a newline as well
+    if (m_size > 0)
+        indent(m_open.size());
+    append("<", 1);
+    appendName(name);
+    m_open.append({ name, false });
+    m_startTagOpen = true;
+}
+
+void LayoutWriter::writeEndElement()
+{
+    if (m_open.isEmpty())
+        return;
+    const Open element = m_open.last();
+    m_open.removeLast();
+    if (m_startTagOpen) {
+        append("/>", 2);
+        m_startTagOpen = false;
+        return;
+    }
+    if (element.hasChildren)
+        indent(m_open.size());
+    append("</", 2);
+    appendName(element.name);
+    append(">", 1);
+}
+
+void LayoutWriter::writeAttribute(const char *name, const QString &value)
+{
+    append(" ", 1);
+    appendName(name);
+    append("=\"", 2);
+    appendEscaped(value, true);
+    append("\"", 1);
+}
+
+void LayoutWriter::writeAttribute(const char *name, qint64 value)
+{
+    append(" ", 1);
+    appendName(name);
+    append("=\"", 2);
+    appendNumber(value);
+    append("\"", 1);
+}
+
+void LayoutWriter::writeCharacters(const QString &text)
+{
+    closeStartTag();
+    appendEscaped(text, false);
+}
+
+// For text already known to need no escaping, such as base64
+void LayoutWriter::writeLatin1(const char *text, int length)
+{
+    closeStartTag();
+    append(text, length);
+}
+
+void LayoutWriter::appendNumber(qint64 value)
+{
+    char *out = reserve(24);
+    m_size += int(std::to_chars(out, out + 24, value).ptr - out);
+}
+
+void LayoutWriter::writeNumber(qint64 value)
+{
+    closeStartTag();
+    appendNumber(value);
+}
+
+// Shortest text that reads back as the same double
+void LayoutWriter::writeDouble(double value)
+{
+    closeStartTag();
+    // Floating point to_chars came later than the integer one
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    char *out = reserve(32);
+    m_size += int(std::to_chars(out, out + 32, value).ptr - out);
+#else
+    const QByteArray text = QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+    append(text.constData(), text.size());
+#endif
+}
+
+void LayoutWriter::writeTextElement(const char *name, const QString &text)
+{
+    writeStartElement(name);
+    writeCharacters(text);
+    writeEndElement();
+}
+
+void LayoutWriter::writeTextElement(const char *name, const char *latin1)
+{
+    writeStartElement(name);
+    writeLatin1(latin1, int(std::strlen(latin1)));
+    writeEndElement();
+}
+
+void LayoutWriter::writeNumberElement(const char *name, qint64 value)
+{
+    writeStartElement(name);
+    writeNumber(value);
+    writeEndElement();
+}
+
+void LayoutWriter::writeNumbersElement(const char *name, std::initializer_list<int> values)
+{
+    writeStartElement(name);
+    closeStartTag();
+    bool first = true;
+    for (int value : values) {
+        if (!first)
+            append(",", 1);
+        appendNumber(value);
+        first = false;
+    }
+    writeEndElement();
+}
+
+void LayoutWriter::writeBoolElement(const char *name, bool value)
+{
+    writeTextElement(name, value ? "true" : "false");
+}
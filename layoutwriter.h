@@ -0,0 +1,77 @@
+#ifndef LAYOUTWRITER_H
+#define LAYOUTWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVarLengthArray>
+#include <initializer_list>
+
+class QIODevice;
+
+// XML writer for saved layouts. It appends UTF-8 straight into a byte
+// buffer that is kept between saves and formats numbers with
+// std::to_chars, so a save allocates only when the buffer has to grow,
+// however many elements it writes. The output matches QXmlStreamWriter
+// with auto-formatting, or has no whitespace at all when compact.
+//
+// Element names are not copied and must outlive the element; string
+// literals and QMetaProperty::name() both do.
+class LayoutWriter
+{
+public:
+    explicit LayoutWriter(bool compact = false);
+
+    void setCompact(bool compact) { m_compact = compact; }
+    bool isCompact() const { return m_compact; }
+
+    // Drops the output but keeps the buffer for the next save
+    void reset();
+    const char *constData() const { return m_buffer.constData(); }
+    int size() const { return m_size; }
+    int capacity() const { return m_buffer.size(); }
+    // A copy of the output, for callers that need to keep it
+    QByteArray toByteArray() const { return QByteArray(m_buffer.constData(), m_size); }
+    bool writeTo(QIODevice *device) const;
+
+    void writeStartDocument();
+    void writeEndDocument();
+    void writeStartElement(const char *name);
+    void writeEndElement();
+
+    void writeAttribute(const char *name, const QString &value);
+    void writeAttribute(const char *name, qint64 value);
+    void writeCharacters(const QString &text);
+    void writeLatin1(const char *text, int length);
+    void writeNumber(qint64 value);
+    void writeDouble(double value);
+
+    void writeTextElement(const char *name, const QString &text);
+    void writeTextElement(const char *name, const char *latin1);
+    void writeNumberElement(const char *name, qint64 value);
+    // Comma-separated, as in "x,y,width,height"
+    void writeNumbersElement(const char *name, std::initializer_list<int> values);
+    void writeBoolElement(const char *name, bool value);
+
+private:
+    struct Open
+    {
+        const char *name;
+        bool hasChildren;
+    };
+
+    char *reserve(int bytes);
+    void append(const char *data, int length);
+    void appendName(const char *name);
+    void appendNumber(qint64 value);
+    void appendEscaped(const QString &text, bool attribute);
+    void closeStartTag();
+    void indent(int depth);
+
+    QByteArray m_buffer;
+    int m_size = 0;
+    QVarLengthArray<Open, 16> m_open;
+    bool m_startTagOpen = false;
+    bool m_compact;
+};
+
+#endif // LAYOUTWRITER_H
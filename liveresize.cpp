@@ -0,0 +1,179 @@
+#include "liveresize.h"
+#include "stallwatchdog.h"
+#include <QApplication>
+#include <QEvent>
+#include <QPainter>
+#include <QWidget>
+
+static const int kSettleDelayMs = 150;
+
+QSet<QString> LiveResizeFilter::s_enabledTypes = { QStringLiteral("ColorDock") };
+
+namespace {
+
+// Covers the content while it is being resized. It is opaque, so the
+// backing store skips the content and its children underneath entirely.
+class SnapshotOverlay : public QWidget
+{
+public:
+    explicit SnapshotOverlay(QWidget *parent) : QWidget(parent)
+    {
+        setAttribute(Qt::WA_OpaquePaintEvent);
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+    }
+
+    void setSnapshot(const QPixmap &snapshot) { m_snapshot = snapshot; }
+
+protected:
+    void paintEvent(QPaintEvent *) override
+    {
+        // Fast transform on purpose: the frame is replaced once the drag settles
+        QPainter painter(this);
+        painter.drawPixmap(rect(), m_snapshot);
+    }
+
+private:
+    QPixmap m_snapshot;
+};
+
+}
+
+LiveResizeFilter::LiveResizeFilter(QObject *parent)
+    : QObject(parent)
+{
+    m_settleTimer.setSingleShot(true);
+    m_settleTimer.setInterval(kSettleDelayMs);
+    connect(&m_settleTimer, &QTimer::timeout, this, &LiveResizeFilter::settle);
+}
+
+LiveResizeFilter::~LiveResizeFilter()
+{
+    for (auto it = m_states.begin(); it != m_states.end(); ++it)
+        it.key()->removeEventFilter(this);
+    for (QWidget *window : qAsConst(m_windows))
+        window->removeEventFilter(this);
+}
+
+void LiveResizeFilter::setEnabledForType(const QString &type, bool enabled)
+{
+    if (enabled)
+        s_enabledTypes.insert(type);
+    else
+        s_enabledTypes.remove(type);
+}
+
+bool LiveResizeFilter::isEnabledForType(const QString &type)
+{
+    return s_enabledTypes.contains(type);
+}
+
+void LiveResizeFilter::watch(QWidget *content)
+{
+    if (!content || m_states.contains(content))
+        return;
+    m_states.insert(content, State());
+    content->installEventFilter(this);
+    connect(content, &QObject::destroyed, this, [this, content]() { m_states.remove(content); });
+}
+
+void LiveResizeFilter::unwatch(QWidget *content)
+{
+    auto it = m_states.find(content);
+    if (it == m_states.end())
+        return;
+    delete it->overlay;
+    content->removeEventFilter(this);
+    disconnect(content, nullptr, this, nullptr);
+    m_states.erase(it);
+}
+
+bool LiveResizeFilter::isLive(QWidget *content) const
+{
+    const State state = m_states.value(content);
+    return state.overlay && state.overlay->isVisible();
+}
+
+void LiveResizeFilter::watchWindow(QWidget *window)
+{
+    if (m_windows.contains(window))
+        return;
+    m_windows.insert(window);
+    window->installEventFilter(this);
+    connect(window, &QObject::destroyed, this, [this, window]() { m_windows.remove(window); });
+}
+
+// Splitter and dock separator drags hold the mouse; a frame drag is done
+// by the window system, whose resizes are spontaneous
+bool LiveResizeFilter::isInteractive() const
+{
+    return !m_requireDrag || QApplication::mouseButtons() != Qt::NoButton || m_windowResizing;
+}
+
+bool LiveResizeFilter::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() != QEvent::Resize)
+        return QObject::eventFilter(watched, event);
+
+    QWidget *widget = static_cast<QWidget*>(watched);
+    auto it = m_states.find(widget);
+    if (it == m_states.end()) {
+        // The content may see the first resize of a frame drag before
+        // this; going live takes a second one anyway
+        if (event->spontaneous() && m_windows.contains(widget)) {
+            m_windowResizing = true;
+            m_settleTimer.start();
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+    if (widget->isVisible()) {
+        // Docks floating natively have a window of their own
+        watchWindow(widget->window());
+        State &state = it.value();
+        // A single resize is a layout change rather than a drag and
+        // repaints normally; the second one within the delay goes live
+        if (state.overlay && state.overlay->isVisible())
+            state.overlay->setGeometry(widget->rect());
+        else if (state.resizing && isInteractive())
+            enterLive(widget, state);
+        else
+            state.resizing = true;
+        m_settleTimer.start();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void LiveResizeFilter::enterLive(QWidget *content, State &state)
+{
+    StallWatchdog::Scope scope("LiveResizeFilter::enterLive");
+    SnapshotOverlay *overlay = static_cast<SnapshotOverlay*>(state.overlay);
+    if (!overlay) {
+        overlay = new SnapshotOverlay(content);
+        state.overlay = overlay;
+    }
+    // Content that has not settled yet has nothing cached
+    if (state.snapshot.isNull())
+        state.snapshot = content->grab();
+    overlay->setSnapshot(state.snapshot);
+    overlay->setGeometry(content->rect());
+    overlay->raise();
+    overlay->show();
+}
+
+void LiveResizeFilter::settle()
+{
+    StallWatchdog::Scope scope("LiveResizeFilter::settle");
+    m_windowResizing = false;
+    for (auto it = m_states.begin(); it != m_states.end(); ++it) {
+        State &state = it.value();
+        state.resizing = false;
+        if (!state.overlay || !state.overlay->isVisible())
+            continue;
+        // Hiding the overlay exposes the content, which repaints once.
+        // Layout loads, maximizing or adding a dock never went live and
+        // are not grabbed here.
+        state.overlay->hide();
+        static_cast<SnapshotOverlay*>(state.overlay)->setSnapshot(QPixmap());
+        state.snapshot = it.key()->grab();
+    }
+}
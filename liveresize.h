@@ -0,0 +1,73 @@
+#ifndef LIVERESIZE_H
+#define LIVERESIZE_H
+
+#include <QObject>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
+#include <QTimer>
+
+class QWidget;
+
+// Live-resize mode for dock content. Once a watched widget is resized
+// twice in quick succession by a drag (a splitter or dock separator with
+// the mouse held, or the window frame), an opaque overlay showing a
+// snapshot of the content, scaled to the current size, covers it, so
+// intermediate frames cost a pixmap blit instead of a full repaint.
+// Resizes the program makes itself never go live. When no watched widget
+// has been resized for settleDelay() ms the overlays go away and the real
+// content repaints once. Content that went live is also grabbed then, so
+// its next drag starts from that snapshot; content that never went live
+// is grabbed when its first drag starts.
+class LiveResizeFilter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LiveResizeFilter(QObject *parent = nullptr);
+    ~LiveResizeFilter();
+
+    // Content types using live resize: the content widget's class name
+    // for built-in docks, the manifest type for plugin docks
+    static void setEnabledForType(const QString &type, bool enabled);
+    static bool isEnabledForType(const QString &type);
+
+    void watch(QWidget *content);
+    void unwatch(QWidget *content);
+    bool isLive(QWidget *content) const;
+
+    int settleDelay() const { return m_settleTimer.interval(); }
+    void setSettleDelay(int milliseconds) { m_settleTimer.setInterval(milliseconds); }
+    // When false, any resize counts as a drag, for synthetic ones
+    bool requiresDrag() const { return m_requireDrag; }
+    void setRequiresDrag(bool required) { m_requireDrag = required; }
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void settle();
+
+private:
+    struct State
+    {
+        QWidget *overlay = nullptr;
+        // Taken when a drag over the content last settled
+        QPixmap snapshot;
+        bool resizing = false;
+    };
+
+    void watchWindow(QWidget *window);
+    bool isInteractive() const;
+    void enterLive(QWidget *content, State &state);
+
+    QHash<QWidget*, State> m_states;
+    // Top-level windows of watched content, for frame drags
+    QSet<QWidget*> m_windows;
+    bool m_windowResizing = false;
+    bool m_requireDrag = true;
+    QTimer m_settleTimer;
+    static QSet<QString> s_enabledTypes;
+};
+
+#endif // LIVERESIZE_H
@@ -0,0 +1,411 @@
+#include "logview.h"
+#include "stallwatchdog.h"
+#include <QDebug>
+#include <QEvent>
+#include <QFontDatabase>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <algorithm>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+// Bytes indexed per event loop turn: a few milliseconds of memchr
+static const qint64 kSliceBytes = 8 * 1024 * 1024;
+static const int kAppendPollMs = 500;
+// Longer lines are cut when drawn
+static const int kMaxLineBytes = 64 * 1024;
+static const int kMargin = 4;
+
+static bool offsetLess(const TextSearch::Match &match, qint64 offset)
+{
+    return match.offset < offset;
+}
+
+// True once the name leads to another file than the open one, as after a
+// rotation renames the log and creates a new one. The open file does not
+// shrink then, so its size alone misses that.
+static bool isReplaced(const QFile &file)
+{
+#ifdef Q_OS_UNIX
+    struct stat opened;
+    struct stat named;
+    // Between the rename and the new file there is nothing to switch to
+    if (::fstat(file.handle(), &opened) != 0 || ::stat(QFile::encodeName(file.fileName()).constData(), &named) != 0)
+        return false;
+    return opened.st_ino != named.st_ino || opened.st_dev != named.st_dev;
+#else
+    Q_UNUSED(file);
+    return false;
+#endif
+}
+
+LogView::LogView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_lineHeight = fontMetrics().lineSpacing();
+    m_charWidth = qMax(1, fontMetrics().horizontalAdvance(QLatin1Char('0')));
+    setFocusPolicy(Qt::StrongFocus);
+
+    m_indexTimer.setSingleShot(true);
+    m_indexTimer.setInterval(0);
+    connect(&m_indexTimer, &QTimer::timeout, this, &LogView::indexSlice);
+    m_appendTimer.setInterval(kAppendPollMs);
+    connect(&m_appendTimer, &QTimer::timeout, this, &LogView::checkForAppend);
+}
+
+LogView::~LogView()
+{
+    closeFile();
+}
+
+bool LogView::openFile(const QString &fileName)
+{
+    closeFile();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = tr("Cannot open %1: %2").arg(fileName, m_file.errorString());
+        qWarning().noquote() << m_errorString;
+        m_file.setFileName(QString());
+        return false;
+    }
+    if (!mapFile(m_file.size())) {
+        const QString error = m_errorString;
+        closeFile();
+        m_errorString = error;
+        return false;
+    }
+    m_appendTimer.start();
+    m_indexTimer.start();
+    emit fileChanged(fileName);
+    viewport()->update();
+    return true;
+}
+
+void LogView::closeFile()
+{
+    m_indexTimer.stop();
+    m_appendTimer.stop();
+    unmapFile();
+    if (m_file.isOpen())
+        m_file.close();
+    m_file.setFileName(QString());
+    m_lineStarts.clear();
+    m_lineStarts.squeeze();
+    m_indexedTo = 0;
+    m_longestLine = 0;
+    m_pendingTopLine = -1;
+    clearMatches();
+    updateScrollBars();
+    viewport()->update();
+}
+
+void LogView::setPlaceholderText(const QString &text)
+{
+    m_placeholderText = text;
+    if (!m_file.isOpen())
+        viewport()->update();
+}
+
+bool LogView::mapFile(qint64 size)
+{
+    unmapFile();
+    // An empty file cannot be mapped; it is polled until it grows
+    if (size == 0)
+        return true;
+    m_map = m_file.map(0, size);
+    if (!m_map) {
+        m_errorString = tr("Cannot map %1: %2").arg(m_file.fileName(), m_file.errorString());
+        qWarning().noquote() << m_errorString;
+        return false;
+    }
+    m_mapSize = size;
+    if (m_lineStarts.isEmpty())
+        m_lineStarts.append(0);
+    return true;
+}
+
+// Touching a mapped page past the end of a truncated file raises SIGBUS,
+// so code reading the mapping checks the size first. That leaves the
+// moment between the check and the read instead of the whole poll
+// interval. A truncation found this way reopens the file.
+bool LogView::isMappingIntact()
+{
+    if (!m_map || m_file.size() >= m_mapSize)
+        return true;
+    QMetaObject::invokeMethod(this, &LogView::checkForAppend, Qt::QueuedConnection);
+    return false;
+}
+
+void LogView::unmapFile()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+}
+
+// The last start opens a line that is either still being indexed or,
+// after a trailing newline, empty; neither is shown
+int LogView::lineCount() const
+{
+    if (m_lineStarts.isEmpty())
+        return 0;
+    if (isIndexing() || m_lineStarts.last() >= m_mapSize)
+        return m_lineStarts.size() - 1;
+    return m_lineStarts.size();
+}
+
+int LogView::topLine() const
+{
+    return m_pendingTopLine >= 0 ? m_pendingTopLine : verticalScrollBar()->value();
+}
+
+void LogView::setTopLine(int line)
+{
+    if (line < lineCount() || !isIndexing()) {
+        m_pendingTopLine = -1;
+        verticalScrollBar()->setValue(line);
+    } else {
+        m_pendingTopLine = line;
+    }
+}
+
+void LogView::addMatches(const QVector<TextSearch::Match> &matches)
+{
+    if (matches.isEmpty())
+        return;
+    StallWatchdog::Scope scope("LogView::addMatches");
+    // Each batch is sorted; batches arrive in any order
+    const int middle = m_matches.size();
+    m_matches += matches;
+    if (middle > 0 && m_matches.at(middle - 1).offset > m_matches.at(middle).offset) {
+        std::inplace_merge(m_matches.begin(), m_matches.begin() + middle, m_matches.end(),
+                           [](const TextSearch::Match &a, const TextSearch::Match &b) { return a.offset < b.offset; });
+    }
+    viewport()->update();
+}
+
+void LogView::clearMatches()
+{
+    m_matches.clear();
+    m_matches.squeeze();
+    m_currentMatchOffset = -1;
+    viewport()->update();
+}
+
+int LogView::currentMatch() const
+{
+    if (m_currentMatchOffset < 0)
+        return -1;
+    return int(std::lower_bound(m_matches.cbegin(), m_matches.cend(), m_currentMatchOffset, offsetLess)
+               - m_matches.cbegin());
+}
+
+bool LogView::showNextMatch(bool backward)
+{
+    if (m_matches.isEmpty())
+        return false;
+    int index;
+    if (m_currentMatchOffset < 0) {
+        // The first search result shown is the one nearest the top of the view
+        const qint64 top = topLine() < lineCount() ? m_lineStarts.at(topLine()) : 0;
+        index = int(std::lower_bound(m_matches.cbegin(), m_matches.cend(), top, offsetLess) - m_matches.cbegin());
+        if (backward)
+            --index;
+    } else if (backward) {
+        index = currentMatch() - 1;
+    } else {
+        index = int(std::upper_bound(m_matches.cbegin(), m_matches.cend(), m_currentMatchOffset,
+                                     [](qint64 offset, const TextSearch::Match &match) { return offset < match.offset; })
+                    - m_matches.cbegin());
+    }
+    if (index < 0)
+        index = m_matches.size() - 1;
+    else if (index >= m_matches.size())
+        index = 0;
+    m_currentMatchOffset = m_matches.at(index).offset;
+    scrollToOffset(m_currentMatchOffset);
+    viewport()->update();
+    return true;
+}
+
+// -1 for an offset the index has not reached yet
+int LogView::lineForOffset(qint64 offset) const
+{
+    if (m_lineStarts.isEmpty() || offset >= m_indexedTo)
+        return -1;
+    return int(std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend(), offset) - m_lineStarts.cbegin()) - 1;
+}
+
+int LogView::xForOffset(int line, qint64 offset) const
+{
+    const qint64 start = m_lineStarts.at(line);
+    const int length = int(qMin<qint64>(offset - start, kMaxLineBytes));
+    return kMargin + fontMetrics().horizontalAdvance(QString::fromUtf8(reinterpret_cast<const char*>(m_map + start), length));
+}
+
+void LogView::scrollToOffset(qint64 offset)
+{
+    const int line = lineForOffset(offset);
+    if (line < 0 || !isMappingIntact())
+        return;
+    const int visibleLines = qMax(1, viewport()->height() / m_lineHeight);
+    const int top = verticalScrollBar()->value();
+    if (line < top || line >= top + visibleLines)
+        setTopLine(qMax(0, line - visibleLines / 2));
+
+    const int x = xForOffset(line, offset);
+    QScrollBar *horizontal = horizontalScrollBar();
+    if (x < horizontal->value() || x > horizontal->value() + viewport()->width() - 4 * m_charWidth)
+        horizontal->setValue(qMax(0, x - viewport()->width() / 3));
+}
+
+void LogView::indexSlice()
+{
+    StallWatchdog::Scope scope("LogView::indexSlice");
+    if (!isMappingIntact())
+        return;
+    const qint64 end = qMin(m_mapSize, m_indexedTo + kSliceBytes);
+    qint64 position = m_indexedTo;
+    qint64 lineStart = m_lineStarts.isEmpty() ? 0 : m_lineStarts.last();
+    while (position < end) {
+        const void *found = std::memchr(m_map + position, '\n', size_t(end - position));
+        if (!found)
+            break;
+        position = static_cast<const uchar*>(found) - m_map + 1;
+        m_longestLine = int(qMin<qint64>(kMaxLineBytes, qMax<qint64>(m_longestLine, position - 1 - lineStart)));
+        m_lineStarts.append(position);
+        lineStart = position;
+    }
+    m_indexedTo = end;
+    if (!isIndexing())
+        m_longestLine = int(qMin<qint64>(kMaxLineBytes, qMax<qint64>(m_longestLine, m_mapSize - lineStart)));
+
+    updateScrollBars();
+    if (m_pendingTopLine >= 0 && (m_pendingTopLine < lineCount() || !isIndexing()))
+        setTopLine(m_pendingTopLine);
+    viewport()->update();
+
+    if (isIndexing())
+        m_indexTimer.start();
+    else
+        emit indexingFinished(lineCount());
+}
+
+void LogView::checkForAppend()
+{
+    if (isReplaced(m_file)) {
+        // Rotated: the new file has nothing in common with the old one
+        openFile(m_file.fileName());
+        return;
+    }
+    const qint64 size = m_file.size();
+    if (size == m_mapSize)
+        return;
+    if (size < m_mapSize) {
+        // Truncated: start over where the view was
+        const int top = topLine();
+        if (openFile(m_file.fileName()))
+            setTopLine(top);
+        return;
+    }
+    if (!mapFile(size)) {
+        closeFile();
+        return;
+    }
+    if (!m_indexTimer.isActive())
+        m_indexTimer.start();
+}
+
+void LogView::updateScrollBars()
+{
+    const int visibleLines = qMax(1, viewport()->height() / m_lineHeight);
+    QScrollBar *vertical = verticalScrollBar();
+    // A view showing the last line keeps showing it as lines are added
+    const bool following = m_pendingTopLine < 0 && vertical->value() >= vertical->maximum();
+    vertical->setRange(0, qMax(0, lineCount() - visibleLines));
+    vertical->setPageStep(visibleLines);
+    vertical->setSingleStep(1);
+    if (following)
+        vertical->setValue(vertical->maximum());
+
+    QScrollBar *horizontal = horizontalScrollBar();
+    horizontal->setRange(0, qMax(0, m_longestLine * m_charWidth + 2 * kMargin - viewport()->width()));
+    horizontal->setPageStep(viewport()->width());
+    horizontal->setSingleStep(m_charWidth);
+}
+
+QString LogView::lineText(int line) const
+{
+    const qint64 start = m_lineStarts.at(line);
+    qint64 end = line + 1 < m_lineStarts.size() ? m_lineStarts.at(line + 1) - 1 : m_mapSize;
+    if (end > start && m_map[end - 1] == '\r')
+        --end;
+    const int length = int(qMin<qint64>(end - start, kMaxLineBytes));
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_map + start), length);
+}
+
+void LogView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    const QRect exposed = event->rect();
+
+    if (!m_map || !isMappingIntact()) {
+        if (!m_file.isOpen() && !m_placeholderText.isEmpty()) {
+            painter.setPen(palette().color(QPalette::PlaceholderText));
+            painter.drawText(viewport()->rect().adjusted(kMargin, kMargin, -kMargin, -kMargin),
+                             Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap, m_placeholderText);
+        }
+        return;
+    }
+
+    // Only the rows intersecting the exposed rect are decoded
+    const int first = verticalScrollBar()->value() + exposed.top() / m_lineHeight;
+    const int last = qMin(lineCount() - 1, verticalScrollBar()->value() + exposed.bottom() / m_lineHeight);
+    const int x = kMargin - horizontalScrollBar()->value();
+    const int ascent = fontMetrics().ascent();
+    if (first > last)
+        return;
+
+    // Matches are looked up for the painted lines only
+    auto match = std::lower_bound(m_matches.cbegin(), m_matches.cend(), m_lineStarts.at(first), offsetLess);
+    const qint64 paintedEnd = last + 1 < m_lineStarts.size() ? m_lineStarts.at(last + 1) : m_mapSize;
+    for (int line = first; match != m_matches.cend() && match->offset < paintedEnd; ++match) {
+        while (line + 1 < m_lineStarts.size() && m_lineStarts.at(line + 1) <= match->offset)
+            ++line;
+        if (match->offset - m_lineStarts.at(line) >= kMaxLineBytes)
+            continue;
+        const int left = xForOffset(line, match->offset);
+        const int right = xForOffset(line, match->offset + match->length);
+        const int y = (line - verticalScrollBar()->value()) * m_lineHeight;
+        const bool current = match->offset == m_currentMatchOffset;
+        painter.fillRect(QRect(left - horizontalScrollBar()->value(), y, qMax(1, right - left), m_lineHeight),
+                         current ? QColor("#FFB300") : QColor("#FFE082"));
+    }
+
+    painter.setPen(palette().color(QPalette::Text));
+    for (int line = first; line <= last; ++line) {
+        const int y = (line - verticalScrollBar()->value()) * m_lineHeight;
+        painter.drawText(QPoint(x, y + ascent), lineText(line));
+    }
+}
+
+void LogView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LogView::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::FontChange) {
+        m_lineHeight = qMax(1, fontMetrics().lineSpacing());
+        m_charWidth = qMax(1, fontMetrics().horizontalAdvance(QLatin1Char('0')));
+        updateScrollBars();
+    }
+    QAbstractScrollArea::changeEvent(event);
+}
@@ -0,0 +1,92 @@
+#ifndef LOGVIEW_H
+#define LOGVIEW_H
+
+#include "textsearch.h"
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QTimer>
+#include <QVector>
+
+// Read-only view of a text file of any size. The file is memory-mapped
+// and its line index is built a slice at a time from the event loop, so
+// opening is immediate and the scroll range grows as lines are found.
+// Only the lines in the viewport are decoded and drawn. While open the
+// file is polled for appends, which are indexed the same way; a view
+// scrolled to the end, as a newly opened one is, stays there. A file that
+// shrinks, or that a rotation replaced, is reopened.
+class LogView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LogView(QWidget *parent = nullptr);
+    ~LogView();
+
+    bool openFile(const QString &fileName);
+    void closeFile();
+    QString fileName() const { return m_file.fileName(); }
+    QString errorString() const { return m_errorString; }
+
+    // Shown while no file is open
+    void setPlaceholderText(const QString &text);
+    QString placeholderText() const { return m_placeholderText; }
+
+    int lineCount() const;
+    bool isIndexing() const { return m_indexedTo < m_mapSize; }
+    qint64 indexBytes() const { return qint64(m_lineStarts.capacity()) * qint64(sizeof(qint64)); }
+
+    // First visible line; a line not indexed yet is scrolled to once it is
+    int topLine() const;
+    void setTopLine(int line);
+
+    // Search results, kept sorted whatever order they are added in. Only
+    // the ones on visible lines are drawn. Closing the file clears them.
+    void addMatches(const QVector<TextSearch::Match> &matches);
+    void clearMatches();
+    int matchCount() const { return m_matches.size(); }
+    // Index of the match last shown, -1 before any
+    int currentMatch() const;
+    // Scrolls to the match after, or before, the current one, wrapping
+    bool showNextMatch(bool backward = false);
+
+signals:
+    void fileChanged(const QString &fileName);
+    void indexingFinished(int lineCount);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private slots:
+    void indexSlice();
+    void checkForAppend();
+
+private:
+    bool mapFile(qint64 size);
+    bool isMappingIntact();
+    void unmapFile();
+    void updateScrollBars();
+    QString lineText(int line) const;
+    int lineForOffset(qint64 offset) const;
+    int xForOffset(int line, qint64 offset) const;
+    void scrollToOffset(qint64 offset);
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+    QVector<qint64> m_lineStarts;
+    qint64 m_indexedTo = 0;
+    int m_longestLine = 0;
+    int m_pendingTopLine = -1;
+    int m_lineHeight = 1;
+    int m_charWidth = 1;
+    QVector<TextSearch::Match> m_matches;
+    qint64 m_currentMatchOffset = -1;
+    QTimer m_indexTimer;
+    QTimer m_appendTimer;
+    QString m_placeholderText;
+    QString m_errorString;
+};
+
+#endif // LOGVIEW_H
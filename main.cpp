@@ -1,12 +1,54 @@
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "layoutsync.h"
+#include "layouttool.h"
+#include "memoryaccounting.h"
+#include "sessionreplayer.h"
+#include "sessiontrace.h"
+#include "stallwatchdog.h"
+#include "syncselftest.h"
+#include "themestyle.h"
+#include "startupprofiler.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTextStream>
 #include <QLocale>
 #include <QTranslator>
 
 int main(int argc, char *argv[])
 {
+    // The layout tool needs no display, so it never creates a QApplication
+    if (LayoutTool::requested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        LayoutTool tool;
+        return tool.run(app.arguments());
+    }
+
+    if (SyncSelfTest::peerRequested(argc, argv)) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+        QApplication app(argc, argv);
+        return SyncSelfTest::runPeer(app.arguments());
+    }
+    if (SyncSelfTest::requested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        SyncSelfTest selfTest;
+        return selfTest.run(app.arguments());
+    }
+
+    StartupProfiler::begin();
+    const bool benchmarkMode = Benchmark::requested(argc, argv);
+    const bool replayMode = SessionReplayer::requested(argc, argv);
+    if (benchmarkMode || replayMode)
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
     QApplication a(argc, argv);
+    a.setStyle(new ThemeStyle);
+    StartupProfiler *profiler = StartupProfiler::instance();
+    profiler->mark("application");
 
     QTranslator translator;
     const QStringList uiLanguages = QLocale::system().uiLanguages();
@@ -17,7 +59,61 @@ int main(int argc, char *argv[])
             break;
         }
     }
+    profiler->mark("translations");
+
+    if (benchmarkMode) {
+        Benchmark benchmark;
+        return benchmark.run(a.arguments());
+    }
+    if (replayMode) {
+        SessionReplayer replayer;
+        return replayer.run(a.arguments());
+    }
+
+    QString stallReportFile;
+    int stallThresholdMs = 50;
+    const bool stallReport = StallWatchdog::requested(a.arguments(), &stallReportFile, &stallThresholdMs);
+    // Otherwise the diagnostics dock runs it while it is open
+    if (stallReport) {
+        StallWatchdog *watchdog = StallWatchdog::instance();
+        watchdog->start(stallThresholdMs);
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, watchdog, [watchdog, stallReportFile]() {
+            const QByteArray json = QJsonDocument(watchdog->toJson()).toJson(QJsonDocument::Indented);
+            if (stallReportFile.isEmpty()) {
+                QTextStream(stdout) << json;
+                return;
+            }
+            QSaveFile file(stallReportFile);
+            if (file.open(QIODevice::WriteOnly) && file.write(json) == json.size())
+                file.commit();
+        });
+    }
+
+    profiler->setExitWhenSettled(StartupProfiler::requested(argc, argv));
     MainWindow w;
+    for (const QString &argument : a.arguments()) {
+        if (argument.startsWith("--workspaces="))
+            w.setWorkspaceCapacity(argument.mid(13).toInt());
+        else if (argument.startsWith("--log="))
+            w.openLogFile(argument.mid(6));
+        else if (argument == "--floating=overlay")
+            w.setFloatingMode(DockManager::OverlayFloating);
+    }
+    QString syncServerName;
+    if (LayoutSync::requested(a.arguments(), &syncServerName))
+        w.enableLayoutSync(syncServerName);
+    QString traceFile;
+    if (SessionRecorder::requested(a.arguments(), &traceFile))
+        w.startRecording(traceFile);
+    QString memoryReportFile;
+    if (MemoryAccounting::requested(a.arguments(), &memoryReportFile)) {
+        QObject::connect(profiler, &StartupProfiler::settled, &w, [&w, memoryReportFile]() {
+            const bool written = w.writeMemoryReport(memoryReportFile);
+            QCoreApplication::exit(written ? 0 : 1);
+        });
+    }
+    profiler->watchWindow(&w);
     w.show();
+    profiler->mark("show");
     return a.exec();
 }
@@ -1,14 +1,35 @@
 #include "mainwindow.h"
+#include "diagnosticsdock.h"
 #include "dockmanager.h"
+#include "findbar.h"
+#include "layoutlibrary.h"
 #include "layoutmanager.h"
+#include "layoutsync.h"
+#include "logview.h"
+#include "memoryaccounting.h"
 #include "menumanager.h"
-#include <QTextEdit>
+#include "pixmapatlas.h"
+#include "sessiontrace.h"
+#include "stallwatchdog.h"
+#include "startupprofiler.h"
+#include "statusnotifier.h"
+#include "workspace.h"
+#include "workspacecache.h"
+#include <QStackedWidget>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMenu>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QElapsedTimer>
 #include <QFile>
-#include <QMessageBox>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QApplication>
 #include <QCloseEvent>
 #include <QShowEvent>
+#include <QSignalBlocker>
+#include <QAction>
 #include <QDebug>
 #include <QTimer>
 
@@ -17,14 +38,37 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
 {
     setObjectName("MainWindow");
     setWindowTitle("Qt Main Window Example");
-    setDockNestingEnabled(true);
 
+    StartupProfiler *profiler = StartupProfiler::instance();
     setupCentralWidget();
+    setupStatusBar();
+    profiler->mark("central-widget");
 
     // Initialize managers
-    m_dockManager = new DockManager(this);
-    m_layoutManager = new LayoutManager(this);
+    m_workspace = createWorkspace();
+    m_workspaceCache->setCurrent(m_workspace);
+    profiler->mark("docks");
     m_menuManager = new MenuManager(this);
+    profiler->mark("menus");
+    // Opening maps the file and reads its index only
+    m_layoutLibrary = new LayoutLibrary(this);
+    if (!m_layoutLibrary->open("layouts.mwl"))
+        qWarning().noquote() << m_layoutLibrary->errorString();
+    m_menuManager->setLayoutLibrary(m_layoutLibrary);
+    profiler->mark("layout-library");
+    setupDiagnostics();
+
+    m_overlayFloatingAction = m_menuManager->toolsMenu()->addAction(tr("Float Docks Inside Window"));
+    m_overlayFloatingAction->setCheckable(true);
+    connect(m_overlayFloatingAction, &QAction::toggled, this, [this](bool inside) {
+        setFloatingMode(inside ? DockManager::OverlayFloating : DockManager::NativeFloating);
+    });
+
+    // Hidden until a search is asked for; it follows the current workspace
+    m_findBar = new FindBar(this);
+    addToolBar(Qt::BottomToolBarArea, m_findBar);
+    m_findBar->hide();
+    m_findBar->setView(qobject_cast<LogView*>(m_workspace->centralWidget()));
 
     // Connect menu signals
     connect(m_menuManager, &MenuManager::saveLayoutRequested, this, &MainWindow::saveLayout);
@@ -35,107 +79,393 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     connect(m_menuManager, &MenuManager::loadLayout3Requested, this, &MainWindow::loadLayout3);
     connect(m_menuManager, &MenuManager::loadLayout4Requested, this, &MainWindow::loadLayout4);
     connect(m_menuManager, &MenuManager::loadLayout5Requested, this, &MainWindow::loadLayout5);
+    connect(m_menuManager, &MenuManager::libraryLayoutRequested, this, &MainWindow::loadLibraryLayout);
+    connect(m_menuManager, &MenuManager::saveToLibraryRequested, this, &MainWindow::saveLayoutToLibrary);
+    connect(m_menuManager, &MenuManager::openLogRequested, this, &MainWindow::openLog);
+    connect(m_menuManager, &MenuManager::findRequested, this, &MainWindow::showFindBar);
 
-    // Connect layout manager signals to dock manager
-    connect(m_layoutManager, &LayoutManager::saveDockWidgetsLayoutRequested,
-            m_dockManager, &DockManager::saveDockWidgetsLayout);
-    connect(m_layoutManager, &LayoutManager::loadDockWidgetsLayoutRequested,
-            m_dockManager, &DockManager::loadDockWidgetsLayout);
+    connect(m_workspaceCache, &WorkspaceCache::workspaceEvicted, this, [this](Workspace *workspace) {
+        m_workspaceStack->removeWidget(workspace);
+    });
 
-    // Load default layout if exists
+    // Load default layout if exists. This stays ahead of show() so the
+    // first frame already has the saved arrangement.
     QFile layoutFile("layout.xml");
     if (layoutFile.exists()) {
-        m_layoutManager->loadLayoutFromFile("layout.xml");
+        m_workspace->layoutManager()->loadLayoutFromFile("layout.xml");
     }
+    profiler->mark("layout");
+
+    // Work the first frame does not need waits until it is on screen
+    connect(profiler, &StartupProfiler::firstFrame, this, &MainWindow::runDeferredStartupWork);
+}
+
+void MainWindow::runDeferredStartupWork()
+{
+    m_menuManager->refreshLayoutThumbnails();
+    StartupProfiler::instance()->mark("deferred-work");
 }
 
 MainWindow::~MainWindow()
 {
-    delete m_dockManager;
-    delete m_layoutManager;
     delete m_menuManager;
 }
 
+void MainWindow::setupStatusBar()
+{
+    m_notifier = new StatusNotifier(this);
+    connect(m_notifier, &StatusNotifier::cancelRequested, this, &MainWindow::cancelLayoutLoad);
+}
+
 void MainWindow::setupCentralWidget()
 {
-    QTextEdit *center = new QTextEdit(this);
-    center->setReadOnly(true);
-    center->setMinimumSize(400, 205);
-    center->setText(tr("This is the central widget.\n\n"
-                       "You can dock other widgets around this area.\n"
-                       "Use the View menu to toggle dock widgets.\n"
-                       "Layouts can be saved and loaded from the File menu.\n"
-                       "Use the buttons below to quickly switch between layouts."));
-    setCentralWidget(center);
+    m_workspaceStack = new QStackedWidget(this);
+    setCentralWidget(m_workspaceStack);
+    m_workspaceCache = new WorkspaceCache(this);
+}
+
+Workspace *MainWindow::createWorkspace()
+{
+    Workspace *workspace = new Workspace(m_workspaceStack);
+    // Pages other than the current one are not laid out by the stack, so
+    // size new workspaces up front for the layout load to see real areas.
+    workspace->resize(m_workspaceStack->size());
+    m_workspaceStack->addWidget(workspace);
+
+    workspace->dockManager()->setFloatingMode(m_floatingMode);
+
+    LayoutManager *layoutManager = workspace->layoutManager();
+    connect(layoutManager, &LayoutManager::layoutSaved, this, &MainWindow::handleLayoutSaved);
+    connect(layoutManager, &LayoutManager::layoutLoaded, this, &MainWindow::handleLayoutLoaded);
+    connect(layoutManager, &LayoutManager::layoutFailed, this, &MainWindow::handleLayoutFailed);
+    connect(layoutManager, &LayoutManager::layoutWarning, this, &MainWindow::handleLayoutWarning);
+    connect(layoutManager, &LayoutManager::loadProgress, this, &MainWindow::handleLoadProgress);
+    connect(layoutManager, &LayoutManager::loadCanceled, this, &MainWindow::handleLoadCanceled);
+    return workspace;
+}
+
+void MainWindow::setCurrentWorkspace(Workspace *workspace)
+{
+    if (workspace == m_workspace)
+        return;
+    // A load still running would land in a workspace that is no longer shown
+    m_workspace->layoutManager()->cancelLoad();
+    m_workspace->dockManager()->suspendFloatingDocks();
+    m_workspace = workspace;
+    m_workspaceCache->setCurrent(workspace);
+    workspace->resize(m_workspaceStack->size());
+    m_workspaceStack->setCurrentWidget(workspace);
+    workspace->dockManager()->resumeFloatingDocks();
+    if (m_layoutSync)
+        m_layoutSync->setWorkspace(workspace);
+    if (m_sessionRecorder)
+        m_sessionRecorder->setWorkspace(workspace);
+    m_findBar->setView(qobject_cast<LogView*>(workspace->centralWidget()));
+}
+
+void MainWindow::setWorkspaceCapacity(int capacity)
+{
+    m_workspaceCache->setCapacity(capacity);
+    if (capacity > 0)
+        m_workspaceCache->insert(m_workspace);
+}
+
+QString MainWindow::workspaceMemoryReport() const
+{
+    return m_workspaceCache->memoryReport();
+}
+
+void MainWindow::setFloatingMode(DockManager::FloatingMode mode)
+{
+    m_floatingMode = mode;
+    for (Workspace *workspace : liveWorkspaces())
+        workspace->dockManager()->setFloatingMode(mode);
+    const QSignalBlocker blocker(m_overlayFloatingAction);
+    m_overlayFloatingAction->setChecked(mode == DockManager::OverlayFloating);
+}
+
+// Workspaces whose docks currently exist: the cached ones, or just the
+// current one when the cache is off.
+QList<Workspace*> MainWindow::liveWorkspaces() const
+{
+    QList<Workspace*> workspaces = m_workspaceCache->workspaces();
+    if (!workspaces.contains(m_workspace))
+        workspaces.prepend(m_workspace);
+    return workspaces;
+}
+
+void MainWindow::setupDiagnostics()
+{
+    m_memoryAccounting = new MemoryAccounting(this);
+
+    m_memoryAccounting->addProvider("docks", [this]() {
+        const QList<Workspace*> workspaces = liveWorkspaces();
+        QVector<MemoryAccounting::Entry> entries;
+        for (const Workspace *workspace : workspaces) {
+            QVector<MemoryAccounting::Entry> docks = workspace->dockManager()->memoryEntries();
+            if (workspaces.size() > 1) {
+                const QString prefix = workspace->presetFile().isEmpty() ? QString("(unsaved)") : workspace->presetFile();
+                for (MemoryAccounting::Entry &entry : docks)
+                    entry.name = prefix + "/" + entry.name;
+            }
+            entries += docks;
+        }
+        return entries;
+    });
+
+    m_memoryAccounting->addProvider("workspaces", [this]() {
+        QVector<MemoryAccounting::Entry> entries;
+        for (const Workspace *workspace : liveWorkspaces()) {
+            MemoryAccounting::Entry entry;
+            entry.name = workspace->presetFile().isEmpty() ? QString("(unsaved)") : workspace->presetFile();
+            entry.bytes = workspace->estimatedBytes(false);
+            entry.detail = workspace == m_workspace ? "visible; central widget and managers, docks excluded"
+                                                    : "cached; central widget and managers, docks excluded";
+            entries.append(entry);
+        }
+        return entries;
+    });
+
+    m_memoryAccounting->addProvider("pixmaps", []() {
+        MemoryAccounting::Entry entry;
+        entry.name = "PixmapAtlas";
+        entry.bytes = PixmapAtlas::cacheBytes();
+        entry.detail = QString("%1 decodes").arg(PixmapAtlas::decodeCount());
+        return QVector<MemoryAccounting::Entry>{ entry };
+    });
+
+    m_memoryAccounting->addProvider("thumbnails", [this]() {
+        return m_menuManager->thumbnailMemoryEntries();
+    });
+
+    m_diagnosticsDock = new DiagnosticsDock(m_memoryAccounting, this);
+    addDockWidget(Qt::RightDockWidgetArea, m_diagnosticsDock);
+    m_diagnosticsDock->hide();
+    m_menuManager->toolsMenu()->addAction(m_diagnosticsDock->toggleViewAction());
+}
+
+bool MainWindow::writeMemoryReport(const QString &fileName) const
+{
+    const QByteArray json = QJsonDocument(m_memoryAccounting->toJson()).toJson(QJsonDocument::Indented);
+    if (fileName.isEmpty()) {
+        QTextStream(stdout) << json;
+        return true;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        qWarning() << "Failed to write memory report to" << fileName << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::enableLayoutSync(const QString &serverName)
+{
+    if (m_layoutSync)
+        return;
+    m_layoutSync = new LayoutSync(serverName, this);
+    m_layoutSync->setWorkspace(m_workspace);
+    connect(m_layoutSync, &LayoutSync::joined, this, [this]() {
+        const QString role = m_layoutSync->isHub() ? tr("hosting") : tr("joined");
+        m_notifier->showMessage(tr("Layout sync %1").arg(role), StatusNotifier::Info);
+    });
+    m_layoutSync->start();
+}
+
+bool MainWindow::startRecording(const QString &fileName)
+{
+    if (!m_sessionRecorder)
+        m_sessionRecorder = new SessionRecorder(this);
+    if (!m_sessionRecorder->start(fileName))
+        return false;
+    m_sessionRecorder->setWorkspace(m_workspace);
+    m_notifier->showMessage(tr("Recording dock session to %1").arg(fileName), StatusNotifier::Info);
+    return true;
+}
+
+// With the workspace cache enabled a preset switch swaps in a workspace
+// that is already laid out; otherwise the current one is rearranged in
+// the background.
+void MainWindow::loadPreset(const QString &fileName)
+{
+    StallWatchdog::Scope scope("MainWindow::loadPreset");
+    if (!QFile::exists(fileName)) {
+        m_notifier->showMessage(tr("%1 not found").arg(fileName), StatusNotifier::Error);
+        return;
+    }
+
+    // The workspace takes the preset name once the load has succeeded
+    if (m_workspaceCache->capacity() == 0) {
+        m_workspace->layoutManager()->loadLayoutFromFileAsync(fileName);
+        m_notifier->beginProgress(tr("Loading %1...").arg(fileName));
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Workspace *workspace = m_workspaceCache->acquire(fileName);
+    const bool cached = workspace != nullptr;
+    if (!workspace) {
+        workspace = createWorkspace();
+        if (!workspace->layoutManager()->loadLayoutFromFile(fileName)) {
+            m_workspaceStack->removeWidget(workspace);
+            workspace->deleteLater();
+            return;
+        }
+        m_workspaceCache->insert(workspace);
+    }
+    setCurrentWorkspace(workspace);
+    if (m_sessionRecorder)
+        m_sessionRecorder->recordPresetLoad(fileName);
+
+    const QString message = tr("Switched to %1 (%2) in %3 ms")
+                                .arg(fileName, cached ? tr("cached workspace") : tr("new workspace"))
+                                .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1);
+    m_notifier->showMessage(message, StatusNotifier::Success);
 }
 
 void MainWindow::saveLayout()
 {
-    m_layoutManager->saveLayoutToFile("layout.xml");
-    QMessageBox::information(this, tr("Save Layout"), tr("Layout saved to layout.xml"));
+    StallWatchdog::Scope scope("MainWindow::saveLayout");
+    if (m_workspace->layoutManager()->saveLayoutToFile("layout.xml"))
+        m_menuManager->refreshLayoutThumbnails();
 }
 
 void MainWindow::saveLayoutAs()
 {
+    StallWatchdog::Scope scope("MainWindow::saveLayoutAs");
     QString fileName = QFileDialog::getSaveFileName(this, tr("Save Layout As"), "", tr("XML Files (*.xml)"));
-    if (!fileName.isEmpty()) {
-        m_layoutManager->saveLayoutToFile(fileName);
-        QMessageBox::information(this, tr("Save Layout As"), tr("Layout saved to %1").arg(fileName));
-    }
+    if (!fileName.isEmpty() && m_workspace->layoutManager()->saveLayoutToFile(fileName))
+        m_menuManager->refreshLayoutThumbnails();
 }
 
 void MainWindow::loadLayout()
 {
+    StallWatchdog::Scope scope("MainWindow::loadLayout");
     QString fileName = QFileDialog::getOpenFileName(this, tr("Load Layout"), "", tr("XML Files (*.xml)"));
     if (!fileName.isEmpty()) {
-        m_layoutManager->loadLayoutFromFile(fileName);
-        QMessageBox::information(this, tr("Load Layout"), tr("Layout loaded from %1").arg(fileName));
+        m_workspace->layoutManager()->loadLayoutFromFileAsync(fileName);
+        m_notifier->beginProgress(tr("Loading %1...").arg(fileName));
     }
 }
 
-void MainWindow::loadLayout1()
+void MainWindow::loadLibraryLayout(const QString &name)
+{
+    StallWatchdog::Scope scope("MainWindow::loadLibraryLayout");
+    m_workspace->layoutManager()->loadLayoutFromLibrary(m_layoutLibrary, name);
+}
+
+void MainWindow::saveLayoutToLibrary()
 {
-    if (QFile::exists("layout.xml")) {
-        m_layoutManager->loadLayoutFromFile("layout.xml");
-    } else {
-        QMessageBox::warning(this, tr("Error"), tr("layout.xml not found"));
+    bool accepted = false;
+    const QString name = QInputDialog::getText(this, tr("Save to Layout Library"), tr("Layout name:"),
+                                               QLineEdit::Normal, QString(), &accepted).trimmed();
+    if (!accepted || name.isEmpty())
+        return;
+    m_workspace->layoutManager()->saveLayoutToLibrary(m_layoutLibrary, name);
+}
+
+void MainWindow::openLog()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Open Log"), QString(),
+                                                          tr("Log Files (*.log *.txt);;All Files (*)"));
+    if (!fileName.isEmpty())
+        openLogFile(fileName);
+}
+
+void MainWindow::showFindBar()
+{
+    m_findBar->setView(qobject_cast<LogView*>(m_workspace->centralWidget()));
+    m_findBar->activate();
+}
+
+bool MainWindow::openLogFile(const QString &fileName)
+{
+    LogView *logView = qobject_cast<LogView*>(m_workspace->centralWidget());
+    if (!logView)
+        return false;
+    if (!logView->openFile(fileName)) {
+        m_notifier->showMessage(logView->errorString(), StatusNotifier::Error);
+        return false;
     }
+    return true;
+}
+
+void MainWindow::handleLayoutSaved(const QString &fileName, qint64 elapsedUs)
+{
+    // Switching to a preset cached before this save would show what the
+    // file held then
+    m_workspaceCache->discard(fileName, m_workspace);
+    m_notifier->showMessage(tr("Layout saved to %1 in %2 ms").arg(fileName).arg(elapsedUs / 1000.0, 0, 'f', 1),
+                            StatusNotifier::Success);
+}
+
+void MainWindow::handleLayoutLoaded(const QString &fileName, LayoutManager::LoadPath path, qint64 elapsedUs)
+{
+    m_notifier->endProgress();
+    m_notifier->showMessage(tr("Layout loaded from %1 via %2 in %3 ms")
+                                .arg(fileName, LayoutManager::loadPathName(path))
+                                .arg(elapsedUs / 1000.0, 0, 'f', 1),
+                            StatusNotifier::Success);
+}
+
+void MainWindow::handleLayoutFailed(const QString &fileName, const QString &message)
+{
+    Q_UNUSED(fileName)
+    m_notifier->endProgress();
+    m_notifier->showMessage(message, StatusNotifier::Error);
+    qWarning().noquote() << message;
+}
+
+// Comes after the load's success message and replaces it
+void MainWindow::handleLayoutWarning(const QString &fileName, const QString &message)
+{
+    Q_UNUSED(fileName)
+    m_notifier->showMessage(message, StatusNotifier::Error);
+    qWarning().noquote() << message;
+}
+
+void MainWindow::handleLoadProgress(const QString &fileName, qint64 bytesRead, qint64 bytesTotal)
+{
+    Q_UNUSED(fileName)
+    m_notifier->setProgress(bytesRead, bytesTotal);
+}
+
+void MainWindow::handleLoadCanceled(const QString &fileName)
+{
+    m_notifier->endProgress();
+    m_notifier->showMessage(tr("Loading %1 canceled").arg(fileName));
+}
+
+void MainWindow::cancelLayoutLoad()
+{
+    m_workspace->layoutManager()->cancelLoad();
+}
+
+void MainWindow::loadLayout1()
+{
+    loadPreset("layout.xml");
 }
 
 void MainWindow::loadLayout2()
 {
-    if (QFile::exists("layout2.xml")) {
-        m_layoutManager->loadLayoutFromFile("layout2.xml");
-    } else {
-        QMessageBox::warning(this, tr("Error"), tr("layout2.xml not found"));
-    }
+    loadPreset("layout2.xml");
 }
 
 void MainWindow::loadLayout3()
 {
-    if (QFile::exists("layout3.xml")) {
-        m_layoutManager->loadLayoutFromFile("layout3.xml");
-    } else {
-        QMessageBox::warning(this, tr("Error"), tr("layout3.xml not found"));
-    }
+    loadPreset("layout3.xml");
 }
 
 void MainWindow::loadLayout4()
 {
-    if (QFile::exists("layout4.xml")) {
-        m_layoutManager->loadLayoutFromFile("layout4.xml");
-    } else {
-        QMessageBox::warning(this, tr("Error"), tr("layout4.xml not found"));
-    }
+    loadPreset("layout4.xml");
 }
 
 void MainWindow::loadLayout5()
 {
-    if (QFile::exists("layout5.xml")) {
-        m_layoutManager->loadLayoutFromFile("layout5.xml");
-    } else {
-        QMessageBox::warning(this, tr("Error"), tr("layout5.xml not found"));
-    }
+    loadPreset("layout5.xml");
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -3,10 +3,21 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include "dockmanager.h"
+#include "layoutmanager.h"
 
-class DockManager;
-class LayoutManager;
+class QAction;
+class QStackedWidget;
+class DiagnosticsDock;
+class FindBar;
+class LayoutLibrary;
+class LayoutSync;
+class MemoryAccounting;
 class MenuManager;
+class SessionRecorder;
+class StatusNotifier;
+class Workspace;
+class WorkspaceCache;
 
 class MainWindow : public QMainWindow
 {
@@ -16,6 +27,26 @@ public:
     explicit MainWindow(QWidget *parent = nullptr, Qt::WindowFlags flags = {});
     ~MainWindow();
 
+    Workspace *currentWorkspace() const { return m_workspace; }
+
+    // Number of preset workspaces kept alive; 0 rearranges one workspace
+    void setWorkspaceCapacity(int capacity);
+    QString workspaceMemoryReport() const;
+    // Applies to every live workspace and to those created later
+    void setFloatingMode(DockManager::FloatingMode mode);
+
+    MemoryAccounting *memoryAccounting() const { return m_memoryAccounting; }
+    // Writes the memory estimates as JSON; an empty file name means stdout
+    bool writeMemoryReport(const QString &fileName) const;
+
+    // Mirrors the current workspace's arrangement with other instances
+    // listening on the same server name
+    void enableLayoutSync(const QString &serverName);
+    // Records dock operations for --replay; follows workspace switches
+    bool startRecording(const QString &fileName);
+    // Shows the file in the current workspace's central log view
+    bool openLogFile(const QString &fileName);
+
 signals:
     void shown();
 
@@ -32,14 +63,41 @@ private slots:
     void loadLayout3();
     void loadLayout4();
     void loadLayout5();
+    void runDeferredStartupWork();
+    void handleLayoutSaved(const QString &fileName, qint64 elapsedUs);
+    void handleLayoutLoaded(const QString &fileName, LayoutManager::LoadPath path, qint64 elapsedUs);
+    void handleLayoutFailed(const QString &fileName, const QString &message);
+    void handleLayoutWarning(const QString &fileName, const QString &message);
+    void handleLoadProgress(const QString &fileName, qint64 bytesRead, qint64 bytesTotal);
+    void handleLoadCanceled(const QString &fileName);
+    void cancelLayoutLoad();
+    void loadLibraryLayout(const QString &name);
+    void saveLayoutToLibrary();
+    void openLog();
+    void showFindBar();
 
 private:
     void setupCentralWidget();
-    void setupStatusBar();  // ADD THIS DECLARATION
+    void setupStatusBar();
+    void setupDiagnostics();
+    QList<Workspace*> liveWorkspaces() const;
+    Workspace *createWorkspace();
+    void setCurrentWorkspace(Workspace *workspace);
+    void loadPreset(const QString &fileName);
 
-    DockManager *m_dockManager;
-    LayoutManager *m_layoutManager;
+    QStackedWidget *m_workspaceStack;
+    WorkspaceCache *m_workspaceCache;
+    Workspace *m_workspace;
     MenuManager *m_menuManager;
+    StatusNotifier *m_notifier;
+    FindBar *m_findBar;
+    QAction *m_overlayFloatingAction;
+    DockManager::FloatingMode m_floatingMode = DockManager::NativeFloating;
+    MemoryAccounting *m_memoryAccounting;
+    DiagnosticsDock *m_diagnosticsDock;
+    LayoutLibrary *m_layoutLibrary;
+    LayoutSync *m_layoutSync = nullptr;
+    SessionRecorder *m_sessionRecorder = nullptr;
 };
 
 #endif // MAINWINDOW_H
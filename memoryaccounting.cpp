@@ -0,0 +1,107 @@
+#include "memoryaccounting.h"
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QPixmap>
+
+MemoryAccounting::MemoryAccounting(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void MemoryAccounting::addProvider(const QString &subsystem, const Provider &provider)
+{
+    if (!m_providers.contains(subsystem))
+        m_order.append(subsystem);
+    m_providers.insert(subsystem, provider);
+}
+
+QVector<MemoryAccounting::Entry> MemoryAccounting::collect(const QString &subsystem) const
+{
+    const Provider provider = m_providers.value(subsystem);
+    return provider ? provider() : QVector<Entry>();
+}
+
+qint64 MemoryAccounting::totalBytes() const
+{
+    qint64 bytes = 0;
+    for (const QString &subsystem : m_order) {
+        for (const Entry &entry : collect(subsystem))
+            bytes += entry.bytes;
+    }
+    return bytes;
+}
+
+QJsonObject MemoryAccounting::toJson() const
+{
+    QJsonObject subsystemsObject;
+    qint64 total = 0;
+    for (const QString &subsystem : m_order) {
+        QJsonArray entries;
+        qint64 subtotal = 0;
+        for (const Entry &entry : collect(subsystem)) {
+            QJsonObject object{
+                { "name", entry.name },
+                { "bytes", entry.bytes },
+                { "objects", entry.objects },
+                { "widgets", entry.widgets }
+            };
+            if (!entry.detail.isEmpty())
+                object.insert("detail", entry.detail);
+            entries.append(object);
+            subtotal += entry.bytes;
+        }
+        subsystemsObject.insert(subsystem, QJsonObject{ { "bytes", subtotal }, { "entries", entries } });
+        total += subtotal;
+    }
+    return QJsonObject{ { "estimatedBytes", total }, { "subsystems", subsystemsObject } };
+}
+
+MemoryAccounting::Entry MemoryAccounting::estimateObjectTree(const QString &name, const QObject *root,
+                                                             const QList<const QObject*> &exclude)
+{
+    Entry entry;
+    entry.name = name;
+
+    QList<const QObject*> pending = { root };
+    while (!pending.isEmpty()) {
+        const QObject *object = pending.takeLast();
+        if (object->isWidgetType()) {
+            entry.bytes += kWidgetBytes;
+            ++entry.widgets;
+        } else {
+            entry.bytes += object->inherits("QAction") ? kActionBytes : kObjectBytes;
+            ++entry.objects;
+        }
+        for (const QObject *child : object->children()) {
+            if (!exclude.contains(child))
+                pending.append(child);
+        }
+    }
+    return entry;
+}
+
+qint64 MemoryAccounting::pixmapBytes(const QPixmap &pixmap)
+{
+    return pixmap.isNull() ? 0 : qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+qint64 MemoryAccounting::imageBytes(const QImage &image)
+{
+    return image.sizeInBytes();
+}
+
+bool MemoryAccounting::requested(const QStringList &arguments, QString *fileName)
+{
+    for (const QString &argument : arguments) {
+        if (argument == "--memory-report") {
+            fileName->clear();
+            return true;
+        }
+        if (argument.startsWith("--memory-report=")) {
+            *fileName = argument.mid(16);
+            return true;
+        }
+    }
+    return false;
+}
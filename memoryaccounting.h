@@ -0,0 +1,66 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <functional>
+
+class QJsonObject;
+class QPixmap;
+class QImage;
+
+// Estimates, not measurements, of the memory held by docks and the
+// subsystems around them. Each subsystem registers a provider that lists
+// its entries; the diagnostics dock and --memory-report read them back.
+class MemoryAccounting : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry
+    {
+        QString name;
+        qint64 bytes = 0;
+        int objects = 0;
+        int widgets = 0;
+        QString detail;
+    };
+
+    using Provider = std::function<QVector<Entry>()>;
+
+    // Rough per-instance heap cost of Qt objects, including their private data
+    static const qint64 kObjectBytes = 256;
+    static const qint64 kWidgetBytes = 1024;
+    static const qint64 kActionBytes = 512;
+    // One node of a QMap/QHash plus its key and value
+    static const qint64 kMapEntryBytes = 48;
+
+    explicit MemoryAccounting(QObject *parent = nullptr);
+
+    void addProvider(const QString &subsystem, const Provider &provider);
+    QStringList subsystems() const { return m_order; }
+    QVector<Entry> collect(const QString &subsystem) const;
+    qint64 totalBytes() const;
+
+    QJsonObject toJson() const;
+
+    // Fixed cost per object and widget in root's tree; subtrees rooted at
+    // an object in exclude are left to whoever reports them.
+    static Entry estimateObjectTree(const QString &name, const QObject *root,
+                                    const QList<const QObject*> &exclude = {});
+    static qint64 pixmapBytes(const QPixmap &pixmap);
+    static qint64 imageBytes(const QImage &image);
+
+    // Returns true when --memory-report[=file] was given; fileName is empty
+    // for stdout.
+    static bool requested(const QStringList &arguments, QString *fileName);
+
+private:
+    QMap<QString, Provider> m_providers;
+    QStringList m_order;
+};
+
+#endif // MEMORYACCOUNTING_H
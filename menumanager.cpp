@@ -1,16 +1,35 @@
 #include "menumanager.h"
+#include "layoutlibrary.h"
+#include "layoutthumbnailer.h"
+#include "themestyle.h"
 #include <QMenuBar>
 #include <QAction>
 #include <QMainWindow>
 #include <QToolBar>
 #include <QPushButton>
 #include <QLabel>
+#include <QFileInfo>
+#include <QIcon>
+#include <QPixmap>
+#include <QLocale>
+
+static const char *const kPresetFiles[] = {
+    "layout.xml", "layout2.xml", "layout3.xml", "layout4.xml", "layout5.xml"
+};
+
+static const QSize kThumbnailSize(48, 30);
 
 MenuManager::MenuManager(QMainWindow *parent)
     : QObject(parent),
     m_mainWindow(parent),
-    m_layoutToolBar(nullptr)
+    m_layoutToolBar(nullptr),
+    m_toolsMenu(nullptr),
+    m_libraryMenu(nullptr),
+    m_thumbnailer(new LayoutThumbnailer(this))
 {
+    connect(m_thumbnailer, &LayoutThumbnailer::thumbnailReady,
+            this, &MenuManager::applyLayoutThumbnail);
+
     setupMenuBar();
     setupLayoutToolBar();
 }
@@ -28,50 +47,34 @@ void MenuManager::setupMenuBar()
     QAction *loadLayoutAction = fileMenu->addAction(tr("Load Layout..."));
     connect(loadLayoutAction, &QAction::triggered, this, &MenuManager::loadLayoutRequested);
 
+    // Filled from the library index each time it opens; nothing is parsed
+    m_libraryMenu = fileMenu->addMenu(tr("Layout &Library"));
+    connect(m_libraryMenu, &QMenu::aboutToShow, this, &MenuManager::populateLibraryMenu);
+
+    fileMenu->addSeparator();
+    QAction *openLogAction = fileMenu->addAction(tr("Open &Log..."));
+    connect(openLogAction, &QAction::triggered, this, &MenuManager::openLogRequested);
+    QAction *findAction = fileMenu->addAction(tr("&Find in Log..."));
+    findAction->setShortcut(QKeySequence::Find);
+    connect(findAction, &QAction::triggered, this, &MenuManager::findRequested);
+
     fileMenu->addSeparator();
     fileMenu->addAction(tr("&Quit"), m_mainWindow, &QWidget::close);
+
+    m_toolsMenu = m_mainWindow->menuBar()->addMenu(tr("&Tools"));
 }
 
 void MenuManager::setupLayoutToolBar()
 {
-    // Create the toolbar with improved styling
+    // Create the toolbar; its look comes from ThemeStyle rather than style sheets
     m_layoutToolBar = new QToolBar(tr("Layouts"), m_mainWindow);
     m_layoutToolBar->setObjectName("LayoutToolBar");
-    m_layoutToolBar->setStyleSheet(
-        "QToolBar {"
-        "   background: #f0f0f0;"
-        "   border-top: 1px solid #ccc;"
-        "   border-bottom: 1px solid #ccc;"
-        "   spacing: 5px;"
-        "   padding: 3px;"
-        "}"
-        "QToolButton {"
-        "   padding: 5px;"
-        "   margin: 2px;"
-        "}"
-        );
+    ThemeStyle::apply(m_layoutToolBar, ThemeStyle::LayoutToolBar);
     m_layoutToolBar->setMovable(false);
     m_layoutToolBar->setFloatable(false);
     m_layoutToolBar->setAllowedAreas(Qt::TopToolBarArea);
     m_mainWindow->addToolBar(Qt::TopToolBarArea, m_layoutToolBar);
 
-    // Button style
-    QString buttonStyle =
-        "QPushButton {"
-        "   padding: 6px;"
-        "   margin: 2px;"
-        "   min-width: 80px;"
-        "   background: #e0e0e0;"
-        "   border: 1px solid #aaa;"
-        "   border-radius: 3px;"
-        "}"
-        "QPushButton:hover {"
-        "   background: #d0d0d0;"
-        "}"
-        "QPushButton:pressed {"
-        "   background: #c0c0c0;"
-        "}";
-
     // Create layout buttons
     QPushButton *btn1 = new QPushButton(tr("Layout 1"), m_mainWindow);
     QPushButton *btn2 = new QPushButton(tr("Layout 2"), m_mainWindow);
@@ -80,11 +83,11 @@ void MenuManager::setupLayoutToolBar()
     QPushButton *btn5 = new QPushButton(tr("Layout 5"), m_mainWindow);
 
     // Apply style to buttons
-    btn1->setStyleSheet(buttonStyle);
-    btn2->setStyleSheet(buttonStyle);
-    btn3->setStyleSheet(buttonStyle);
-    btn4->setStyleSheet(buttonStyle);
-    btn5->setStyleSheet(buttonStyle);
+    ThemeStyle::apply(btn1, ThemeStyle::ToolBarButton);
+    ThemeStyle::apply(btn2, ThemeStyle::ToolBarButton);
+    ThemeStyle::apply(btn3, ThemeStyle::ToolBarButton);
+    ThemeStyle::apply(btn4, ThemeStyle::ToolBarButton);
+    ThemeStyle::apply(btn5, ThemeStyle::ToolBarButton);
 
     // Connect buttons
     connect(btn1, &QPushButton::clicked, this, &MenuManager::loadLayout1Requested);
@@ -100,6 +103,7 @@ void MenuManager::setupLayoutToolBar()
     m_layoutToolBar->addWidget(btn3);
     m_layoutToolBar->addWidget(btn4);
     m_layoutToolBar->addWidget(btn5);
+    m_layoutButtons = { btn1, btn2, btn3, btn4, btn5 };
 
     // Add separator
     m_layoutToolBar->addSeparator();
@@ -107,10 +111,66 @@ void MenuManager::setupLayoutToolBar()
     // Add save/load buttons
     QPushButton *saveBtn = new QPushButton(tr("Save Current"), m_mainWindow);
     QPushButton *loadBtn = new QPushButton(tr("Load Custom"), m_mainWindow);
-    saveBtn->setStyleSheet(buttonStyle);
-    loadBtn->setStyleSheet(buttonStyle);
+    ThemeStyle::apply(saveBtn, ThemeStyle::ToolBarButton);
+    ThemeStyle::apply(loadBtn, ThemeStyle::ToolBarButton);
     connect(saveBtn, &QPushButton::clicked, this, &MenuManager::saveLayoutAsRequested);
     connect(loadBtn, &QPushButton::clicked, this, &MenuManager::loadLayoutRequested);
     m_layoutToolBar->addWidget(saveBtn);
     m_layoutToolBar->addWidget(loadBtn);
 }
+
+void MenuManager::populateLibraryMenu()
+{
+    m_libraryMenu->clear();
+    if (m_library) {
+        const QVector<LayoutLibrary::Entry> entries = m_library->entries();
+        for (const LayoutLibrary::Entry &entry : entries) {
+            QAction *action = m_libraryMenu->addAction(entry.name);
+            action->setToolTip(tr("%1 docks, saved %2")
+                                   .arg(entry.dockCount)
+                                   .arg(QLocale().toString(entry.modified.toLocalTime(), QLocale::ShortFormat)));
+            const QString name = entry.name;
+            connect(action, &QAction::triggered, this, [this, name]() { emit libraryLayoutRequested(name); });
+        }
+        if (entries.isEmpty())
+            m_libraryMenu->addAction(tr("(empty)"))->setEnabled(false);
+        m_libraryMenu->setToolTipsVisible(true);
+    }
+    m_libraryMenu->addSeparator();
+    QAction *saveAction = m_libraryMenu->addAction(tr("Save Current Layout to Library..."));
+    connect(saveAction, &QAction::triggered, this, &MenuManager::saveToLibraryRequested);
+}
+
+void MenuManager::refreshLayoutThumbnails()
+{
+    const qreal dpr = m_mainWindow->devicePixelRatioF();
+    for (const char *fileName : kPresetFiles) {
+        if (QFileInfo::exists(fileName))
+            m_thumbnailer->requestThumbnail(fileName, kThumbnailSize, dpr);
+    }
+}
+
+void MenuManager::applyLayoutThumbnail(const QString &fileName, const QImage &image)
+{
+    for (int i = 0; i < m_layoutButtons.size(); ++i) {
+        if (fileName == QLatin1String(kPresetFiles[i])) {
+            m_layoutButtons[i]->setIconSize(kThumbnailSize);
+            const QPixmap pixmap = QPixmap::fromImage(image);
+            m_layoutButtons[i]->setIcon(QIcon(pixmap));
+            m_thumbnailBytes[fileName] = MemoryAccounting::pixmapBytes(pixmap);
+        }
+    }
+}
+
+QVector<MemoryAccounting::Entry> MenuManager::thumbnailMemoryEntries() const
+{
+    QVector<MemoryAccounting::Entry> entries;
+    for (auto it = m_thumbnailBytes.cbegin(); it != m_thumbnailBytes.cend(); ++it) {
+        MemoryAccounting::Entry entry;
+        entry.name = it.key();
+        entry.bytes = it.value() + MemoryAccounting::kMapEntryBytes;
+        entry.detail = "preset button icon";
+        entries.append(entry);
+    }
+    return entries;
+}
@@ -3,9 +3,15 @@
 
 #include <QObject>
 #include <QMainWindow>
+#include <QMap>
+#include "memoryaccounting.h"
 
+class QMenu;
 class QToolBar;
 class QPushButton;
+class QImage;
+class LayoutLibrary;
+class LayoutThumbnailer;
 
 class MenuManager : public QObject
 {
@@ -15,6 +21,11 @@ public:
     explicit MenuManager(QMainWindow *parent = nullptr);
     void setupMenuBar();
     void setupLayoutToolBar();
+    void refreshLayoutThumbnails();
+    QMenu *toolsMenu() const { return m_toolsMenu; }
+    // Library whose layouts the File > Layout Library menu lists
+    void setLayoutLibrary(LayoutLibrary *library) { m_library = library; }
+    QVector<MemoryAccounting::Entry> thumbnailMemoryEntries() const;
 
 signals:
     void saveLayoutRequested();
@@ -25,10 +36,24 @@ signals:
     void loadLayout3Requested();
     void loadLayout4Requested();
     void loadLayout5Requested();
+    void libraryLayoutRequested(const QString &name);
+    void saveToLibraryRequested();
+    void openLogRequested();
+    void findRequested();
+
+private slots:
+    void applyLayoutThumbnail(const QString &fileName, const QImage &image);
+    void populateLibraryMenu();
 
 private:
     QMainWindow *m_mainWindow;
     QToolBar *m_layoutToolBar;
+    QMenu *m_toolsMenu;
+    QMenu *m_libraryMenu;
+    LayoutLibrary *m_library = nullptr;
+    LayoutThumbnailer *m_thumbnailer;
+    QList<QPushButton*> m_layoutButtons;
+    QMap<QString, qint64> m_thumbnailBytes;
 };
 
 #endif // MENUMANAGER_H
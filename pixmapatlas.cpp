@@ -0,0 +1,88 @@
+#include "pixmapatlas.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <cmath>
+
+static int s_decodeCount = 0;
+
+QHash<QString, QPixmap> &PixmapAtlas::cache()
+{
+    static QHash<QString, QPixmap> pixmaps;
+    static bool cleanupRegistered = false;
+    if (!cleanupRegistered) {
+        // Release the pixmaps while the application still exists
+        qAddPostRoutine(PixmapAtlas::clear);
+        cleanupRegistered = true;
+    }
+    return pixmaps;
+}
+
+QPixmap PixmapAtlas::pixmap(const QString &resource, qreal devicePixelRatio)
+{
+    // Fractional ratios share the next integer variant; the painter scales
+    // it down, which looks better than scaling a 1x image up.
+    const int ratio = qMax(1, int(std::ceil(devicePixelRatio - 0.01)));
+    const QString key = resource + QLatin1Char('@') + QString::number(ratio);
+
+    QHash<QString, QPixmap> &pixmaps = cache();
+    auto it = pixmaps.constFind(key);
+    if (it != pixmaps.constEnd())
+        return it.value();
+
+    QPixmap result = load(resource, ratio);
+    pixmaps.insert(key, result);
+    return result;
+}
+
+QPixmap PixmapAtlas::load(const QString &resource, int ratio)
+{
+    // Prefer a dedicated @Nx resource, otherwise scale the 1x image
+    if (ratio > 1) {
+        const QFileInfo info(resource);
+        const QString variant = info.path() + "/" + info.completeBaseName()
+                                + QString("@%1x.").arg(ratio) + info.suffix();
+        if (QFile::exists(variant)) {
+            QPixmap decoded(variant);
+            ++s_decodeCount;
+            decoded.setDevicePixelRatio(ratio);
+            return decoded;
+        }
+
+        QPixmap base = pixmap(resource, 1.0);
+        if (base.isNull())
+            return base;
+        QPixmap scaled = base.scaled(base.size() * ratio, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        scaled.setDevicePixelRatio(ratio);
+        return scaled;
+    }
+
+    QPixmap decoded(resource);
+    ++s_decodeCount;
+    return decoded;
+}
+
+QSize PixmapAtlas::logicalSize(const QPixmap &pixmap)
+{
+    const qreal ratio = pixmap.devicePixelRatio();
+    return QSize(qRound(pixmap.width() / ratio), qRound(pixmap.height() / ratio));
+}
+
+int PixmapAtlas::decodeCount()
+{
+    return s_decodeCount;
+}
+
+qint64 PixmapAtlas::cacheBytes()
+{
+    qint64 bytes = 0;
+    const QHash<QString, QPixmap> &pixmaps = cache();
+    for (auto it = pixmaps.constBegin(); it != pixmaps.constEnd(); ++it)
+        bytes += qint64(it.value().width()) * it.value().height() * it.value().depth() / 8;
+    return bytes;
+}
+
+void PixmapAtlas::clear()
+{
+    cache().clear();
+}
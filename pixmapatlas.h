@@ -0,0 +1,29 @@
+#ifndef PIXMAPATLAS_H
+#define PIXMAPATLAS_H
+
+#include <QHash>
+#include <QPixmap>
+#include <QString>
+
+// Process-wide cache of decoded resource pixmaps. Each resource is decoded
+// once per device-pixel ratio and handed out as an implicitly shared copy,
+// so widgets that are created many times (title bars) never decode PNGs
+// themselves. GUI thread only, like QPixmap.
+class PixmapAtlas
+{
+public:
+    static QPixmap pixmap(const QString &resource, qreal devicePixelRatio = 1.0);
+
+    // Size of a pixmap in device-independent pixels
+    static QSize logicalSize(const QPixmap &pixmap);
+
+    static int decodeCount();
+    static qint64 cacheBytes();
+    static void clear();
+
+private:
+    static QHash<QString, QPixmap> &cache();
+    static QPixmap load(const QString &resource, int ratio);
+};
+
+#endif // PIXMAPATLAS_H
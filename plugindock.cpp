@@ -0,0 +1,36 @@
+#include "plugindock.h"
+#include <QIcon>
+#include <QLabel>
+#include <QMainWindow>
+
+PluginDock::PluginDock(const DockPluginRegistry::Manifest &manifest, QMainWindow *parent)
+    : QDockWidget(manifest.title, parent), m_manifest(manifest)
+{
+    setObjectName(DockPluginRegistry::dockName(manifest.type));
+    if (!manifest.iconPath.isEmpty())
+        toggleViewAction()->setIcon(QIcon(manifest.iconPath));
+}
+
+void PluginDock::ensureContent()
+{
+    if (m_contentCreated)
+        return;
+    m_contentCreated = true;
+
+    QString errorString;
+    QWidget *content = DockPluginRegistry::instance()->createContent(m_manifest.type, this, &errorString);
+    if (!content) {
+        QLabel *label = new QLabel(errorString, this);
+        label->setWordWrap(true);
+        label->setAlignment(Qt::AlignCenter);
+        content = label;
+    }
+    setWidget(content);
+    emit contentCreated(content);
+}
+
+void PluginDock::showEvent(QShowEvent *event)
+{
+    ensureContent();
+    QDockWidget::showEvent(event);
+}
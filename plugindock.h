@@ -0,0 +1,33 @@
+#ifndef PLUGINDOCK_H
+#define PLUGINDOCK_H
+
+#include <QDockWidget>
+#include "dockpluginregistry.h"
+
+// Dock whose content comes from a plugin. It is created from the manifest
+// alone and asks the registry for its content the first time it is shown
+// or a layout refers to it.
+class PluginDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PluginDock(const DockPluginRegistry::Manifest &manifest, QMainWindow *parent = nullptr);
+
+    QString contentType() const { return m_manifest.type; }
+    Qt::DockWidgetArea defaultArea() const { return m_manifest.area; }
+    bool hasContent() const { return m_contentCreated; }
+    void ensureContent();
+
+signals:
+    void contentCreated(QWidget *content);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private:
+    DockPluginRegistry::Manifest m_manifest;
+    bool m_contentCreated = false;
+};
+
+#endif // PLUGINDOCK_H
@@ -0,0 +1,26 @@
+#include "clockdockplugin.h"
+#include <QLCDNumber>
+#include <QPlainTextEdit>
+#include <QTime>
+#include <QTimer>
+
+QWidget *ClockDockPlugin::createContent(const QString &type, QWidget *parent)
+{
+    if (type == "Clock") {
+        QLCDNumber *clock = new QLCDNumber(8, parent);
+        clock->setSegmentStyle(QLCDNumber::Flat);
+        auto tick = [clock]() { clock->display(QTime::currentTime().toString("hh:mm:ss")); };
+        tick();
+        QTimer *timer = new QTimer(clock);
+        QObject::connect(timer, &QTimer::timeout, clock, tick);
+        timer->start(1000);
+        return clock;
+    }
+
+    if (type == "Notes") {
+        QPlainTextEdit *notes = new QPlainTextEdit(parent);
+        notes->setPlaceholderText(QObject::tr("Notes"));
+        return notes;
+    }
+    return nullptr;
+}
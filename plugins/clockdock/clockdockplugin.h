@@ -0,0 +1,18 @@
+#ifndef CLOCKDOCKPLUGIN_H
+#define CLOCKDOCKPLUGIN_H
+
+#include <QObject>
+#include "dockcontentinterface.h"
+
+// Example dock content plugin providing a clock and a notes pad
+class ClockDockPlugin : public QObject, public DockContentInterface
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID DockContentInterface_iid FILE "clockdock.json")
+    Q_INTERFACES(DockContentInterface)
+
+public:
+    QWidget *createContent(const QString &type, QWidget *parent) override;
+};
+
+#endif // CLOCKDOCKPLUGIN_H
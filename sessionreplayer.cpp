@@ -0,0 +1,142 @@
+#include "sessionreplayer.h"
+#include "benchmark.h"
+#include "dockmanager.h"
+#include "floatingoverlay.h"
+#include "layoutmanager.h"
+#include "workspace.h"
+#include <QApplication>
+#include <QDir>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+bool SessionReplayer::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrncmp(argv[i], "--replay=", 9) == 0)
+            return true;
+    }
+    return false;
+}
+
+int SessionReplayer::run(const QStringList &arguments)
+{
+    QString fileName;
+    int runs = 1;
+    for (const QString &argument : arguments) {
+        if (argument.startsWith("--replay="))
+            fileName = argument.mid(9);
+        else if (argument.startsWith("--replay-runs="))
+            runs = qMax(1, argument.mid(14).toInt());
+    }
+
+    QVector<SessionTrace::Event> events;
+    QString errorString;
+    if (!SessionTrace::read(fileName, &events, &errorString)) {
+        QTextStream(stderr) << "Cannot replay " << fileName << ": " << errorString << '\n';
+        return 1;
+    }
+
+    // Preset saves go to a scratch directory, never over the recorded files
+    QTemporaryDir saveDirectory;
+    if (!saveDirectory.isValid()) {
+        QTextStream(stderr) << "Cannot create a directory for replayed saves\n";
+        return 1;
+    }
+
+    QElapsedTimer wallClock;
+    wallClock.start();
+    for (int run = 0; run < runs; ++run) {
+        // A fresh workspace per run so every run starts from the same layout
+        Workspace workspace;
+        workspace.resize(1280, 800);
+        workspace.show();
+        QApplication::processEvents();
+
+        for (const SessionTrace::Event &event : qAsConst(events)) {
+            QElapsedTimer timer;
+            timer.start();
+            if (!replay(&workspace, event, saveDirectory.path())) {
+                ++m_skipped;
+                continue;
+            }
+            // Count the relayout and repaint the operation caused
+            QApplication::sendPostedEvents();
+            m_samples[event.operation].append(timer.nsecsElapsed());
+        }
+    }
+    const qint64 wallUs = wallClock.nsecsElapsed() / 1000;
+
+    QTextStream out(stdout);
+    const qint64 recordedUs = events.isEmpty() ? 0 : events.last().timeUs;
+    out << QString::asprintf("Replayed %d operations x %d runs in %.1f ms (recorded session: %.1f s)\n",
+                             int(events.size()), runs, wallUs / 1000.0, recordedUs / 1e6);
+    out << QString::asprintf("%-16s %7s %10s %10s %10s %10s\n",
+                             "operation", "count", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    for (auto it = m_samples.cbegin(); it != m_samples.cend(); ++it) {
+        const QVector<qint64> &samples = it.value();
+        out << QString::asprintf("%-16s %7d %10.1f %10.1f %10.1f %10.1f\n",
+                                 qPrintable(SessionTrace::operationName(it.key())), int(samples.size()),
+                                 Benchmark::percentile(samples, 50) / 1000.0,
+                                 Benchmark::percentile(samples, 90) / 1000.0,
+                                 Benchmark::percentile(samples, 99) / 1000.0,
+                                 Benchmark::percentile(samples, 100) / 1000.0);
+    }
+    if (m_skipped > 0)
+        out << "Skipped " << m_skipped << " operations on unknown docks or missing presets\n";
+    return 0;
+}
+
+bool SessionReplayer::replay(Workspace *workspace, const SessionTrace::Event &event, const QString &saveDirectory)
+{
+    DockManager *dockManager = workspace->dockManager();
+    if (event.operation == SessionTrace::LoadPreset) {
+        if (!QFileInfo::exists(event.name))
+            return false;
+        return workspace->layoutManager()->loadLayoutFromFile(event.name);
+    }
+    if (event.operation == SessionTrace::SavePreset) {
+        const QString fileName = QDir(saveDirectory).filePath(QFileInfo(event.name).fileName());
+        return workspace->layoutManager()->saveLayoutToFile(fileName);
+    }
+
+    QDockWidget *dock = dockManager->findDockWidget(event.name);
+    if (!dock)
+        return false;
+
+    switch (event.operation) {
+    case SessionTrace::Place:
+        workspace->addDockWidget(Qt::DockWidgetArea(event.value), dock);
+        return true;
+    case SessionTrace::Split:
+        if (QDockWidget *target = dockManager->findDockWidget(event.target)) {
+            workspace->splitDockWidget(target, dock, Qt::Orientation(event.value));
+            return true;
+        }
+        return false;
+    case SessionTrace::Tab:
+        if (QDockWidget *target = dockManager->findDockWidget(event.target)) {
+            workspace->tabifyDockWidget(target, dock);
+            return true;
+        }
+        return false;
+    case SessionTrace::Float:
+        FloatingOverlay::setFloating(dock, event.flag, event.flag ? event.position : QPoint());
+        return true;
+    case SessionTrace::Resize:
+        if (FloatingOverlay::isFloating(dock)) {
+            dock->resize(event.size);
+        } else {
+            workspace->resizeDocks({ dock }, { event.size.width() }, Qt::Horizontal);
+            workspace->resizeDocks({ dock }, { event.size.height() }, Qt::Vertical);
+        }
+        return true;
+    case SessionTrace::Visible:
+        dock->setVisible(event.flag);
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef SESSIONREPLAYER_H
+#define SESSIONREPLAYER_H
+
+#include "sessiontrace.h"
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+class Workspace;
+
+// Replays a recorded dock session (--replay=<trace>) offscreen, without
+// the pauses between operations, and prints latency percentiles per
+// operation type. --replay-runs=N repeats the trace for steadier numbers.
+class SessionReplayer
+{
+public:
+    // Must be checked before QApplication exists, like --benchmark
+    static bool requested(int argc, char *argv[]);
+
+    int run(const QStringList &arguments);
+
+private:
+    bool replay(Workspace *workspace, const SessionTrace::Event &event, const QString &saveDirectory);
+
+    QMap<SessionTrace::Operation, QVector<qint64>> m_samples;
+    int m_skipped = 0;
+};
+
+#endif // SESSIONREPLAYER_H
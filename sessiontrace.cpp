@@ -0,0 +1,443 @@
+#include "sessiontrace.h"
+#include "dockmanager.h"
+#include "layoutmanager.h"
+#include "workspace.h"
+#include <QDebug>
+
+static const char kMagic[] = "MWTR";
+static const int kFlushBytes = 64 * 1024;
+static const int kFlushIntervalMs = 1000;
+// Dock resizes this soon after a structural change or a window resize are
+// the layout settling, not the user
+static const qint64 kSettleUs = 100 * 1000;
+
+static void writeVarint(QByteArray *out, quint64 value)
+{
+    while (value >= 0x80) {
+        out->append(char(value | 0x80));
+        value >>= 7;
+    }
+    out->append(char(value));
+}
+
+static void writeSigned(QByteArray *out, qint64 value)
+{
+    writeVarint(out, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+static void writeString(QByteArray *out, QHash<QString, int> *strings, const QString &value)
+{
+    auto it = strings->constFind(value);
+    if (it != strings->constEnd()) {
+        writeVarint(out, quint64(it.value()));
+        return;
+    }
+    // The next free index announces a new entry, spelled out once
+    const int index = strings->size();
+    strings->insert(value, index);
+    const QByteArray utf8 = value.toUtf8();
+    writeVarint(out, quint64(index));
+    writeVarint(out, quint64(utf8.size()));
+    out->append(utf8);
+}
+
+namespace {
+
+class TraceReader
+{
+public:
+    explicit TraceReader(const QByteArray &data, int offset) : m_data(data), m_offset(offset) {}
+
+    bool atEnd() const { return m_offset >= m_data.size(); }
+    bool ok() const { return m_ok; }
+
+    quint64 varint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (atEnd()) {
+                m_ok = false;
+                return 0;
+            }
+            const quint8 byte = quint8(m_data.at(m_offset++));
+            value |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    qint64 signedVarint()
+    {
+        const quint64 value = varint();
+        return qint64(value >> 1) ^ -qint64(value & 1);
+    }
+
+    quint8 byte()
+    {
+        if (atEnd()) {
+            m_ok = false;
+            return 0;
+        }
+        return quint8(m_data.at(m_offset++));
+    }
+
+    QString string()
+    {
+        const quint64 index = varint();
+        if (index < quint64(m_strings.size()))
+            return m_strings.at(int(index));
+        const quint64 length = varint();
+        if (index != quint64(m_strings.size()) || length > quint64(m_data.size() - m_offset)) {
+            m_ok = false;
+            return QString();
+        }
+        m_strings.append(QString::fromUtf8(m_data.constData() + m_offset, int(length)));
+        m_offset += int(length);
+        return m_strings.last();
+    }
+
+private:
+    const QByteArray &m_data;
+    int m_offset;
+    QStringList m_strings;
+    bool m_ok = true;
+};
+
+}
+
+QByteArray SessionTrace::header()
+{
+    QByteArray header(kMagic, 4);
+    header.append(char(kVersion));
+    return header;
+}
+
+void SessionTrace::encode(const Event &event, qint64 previousUs, QHash<QString, int> *strings, QByteArray *out)
+{
+    out->append(char(event.operation));
+    writeVarint(out, quint64(qMax<qint64>(0, event.timeUs - previousUs)));
+    writeString(out, strings, event.name);
+
+    switch (event.operation) {
+    case Place:
+        writeVarint(out, quint64(event.value));
+        break;
+    case Split:
+        writeString(out, strings, event.target);
+        writeVarint(out, quint64(event.value));
+        break;
+    case Tab:
+        writeString(out, strings, event.target);
+        break;
+    case Float:
+        out->append(char(event.flag));
+        writeSigned(out, event.position.x());
+        writeSigned(out, event.position.y());
+        break;
+    case Resize:
+        writeVarint(out, quint64(qMax(0, event.size.width())));
+        writeVarint(out, quint64(qMax(0, event.size.height())));
+        break;
+    case Visible:
+        out->append(char(event.flag));
+        break;
+    case LoadPreset:
+    case SavePreset:
+        break;
+    }
+}
+
+bool SessionTrace::read(const QString &fileName, QVector<Event> *events, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorString = file.errorString();
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    if (!data.startsWith(header().left(4))) {
+        *errorString = QObject::tr("not a session trace");
+        return false;
+    }
+    if (data.size() < 5 || quint8(data.at(4)) > kVersion) {
+        *errorString = QObject::tr("unsupported trace version");
+        return false;
+    }
+
+    TraceReader reader(data, 5);
+    qint64 timeUs = 0;
+    while (!reader.atEnd()) {
+        Event event;
+        const quint8 operation = reader.byte();
+        timeUs += qint64(reader.varint());
+        event.operation = Operation(operation);
+        event.timeUs = timeUs;
+        event.name = reader.string();
+
+        switch (event.operation) {
+        case Place:
+            event.value = int(reader.varint());
+            break;
+        case Split:
+            event.target = reader.string();
+            event.value = int(reader.varint());
+            break;
+        case Tab:
+            event.target = reader.string();
+            break;
+        case Float: {
+            event.flag = reader.byte() != 0;
+            const int x = int(reader.signedVarint());
+            event.position = QPoint(x, int(reader.signedVarint()));
+            break;
+        }
+        case Resize: {
+            const int width = int(reader.varint());
+            event.size = QSize(width, int(reader.varint()));
+            break;
+        }
+        case Visible:
+            event.flag = reader.byte() != 0;
+            break;
+        case LoadPreset:
+        case SavePreset:
+            break;
+        default:
+            if (reader.ok()) {
+                *errorString = QObject::tr("unknown operation %1 at event %2").arg(operation).arg(events->size());
+                return false;
+            }
+            break;
+        }
+
+        // A trace cut short by a crash keeps the events before the damage
+        if (!reader.ok()) {
+            qWarning() << "Session trace" << fileName << "is truncated after" << events->size() << "events";
+            break;
+        }
+        events->append(event);
+    }
+    return true;
+}
+
+QString SessionTrace::operationName(Operation operation)
+{
+    switch (operation) {
+    case Place: return "place";
+    case Split: return "split";
+    case Tab: return "tab";
+    case Float: return "float";
+    case Resize: return "resize";
+    case Visible: return "visibility";
+    case LoadPreset: return "preset-load";
+    case SavePreset: return "preset-save";
+    }
+    return "unknown";
+}
+
+SessionRecorder::SessionRecorder(QObject *parent)
+    : QObject(parent)
+{
+    m_flushTimer.setInterval(kFlushIntervalMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &SessionRecorder::flush);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+bool SessionRecorder::requested(const QStringList &arguments, QString *fileName)
+{
+    for (const QString &argument : arguments) {
+        if (argument.startsWith("--record=")) {
+            *fileName = argument.mid(9);
+            return !fileName->isEmpty();
+        }
+    }
+    return false;
+}
+
+bool SessionRecorder::start(const QString &fileName)
+{
+    stop();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot record session to" << fileName << m_file.errorString();
+        return false;
+    }
+    m_buffer = SessionTrace::header();
+    m_strings.clear();
+    m_previousUs = 0;
+    m_eventCount = 0;
+    m_settleUntilUs = 0;
+    m_hasPendingPlace = false;
+    m_clock.start();
+    m_flushTimer.start();
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    if (!m_file.isOpen())
+        return;
+    m_flushTimer.stop();
+    commitPendingPlace();
+    flush();
+    m_file.close();
+}
+
+void SessionRecorder::flush()
+{
+    if (m_buffer.isEmpty() || !m_file.isOpen())
+        return;
+    m_file.write(m_buffer);
+    m_file.flush();
+    m_buffer.clear();
+}
+
+void SessionRecorder::setWorkspace(Workspace *workspace)
+{
+    commitPendingPlace();
+    if (m_workspace) {
+        disconnect(m_workspace->dockManager(), nullptr, this, nullptr);
+        disconnect(m_workspace->layoutManager(), nullptr, this, nullptr);
+        m_workspace->removeEventFilter(this);
+    }
+    m_workspace = workspace;
+    m_loading = false;
+    if (!workspace)
+        return;
+    workspace->installEventFilter(this);
+
+    using Event = SessionTrace::Event;
+    DockManager *dockManager = workspace->dockManager();
+    connect(dockManager, &DockManager::dockWidgetMoved, this, [this](const QString &name, Qt::DockWidgetArea area) {
+        Event event;
+        event.operation = SessionTrace::Place;
+        event.name = name;
+        event.value = int(area);
+        record(event);
+    });
+    connect(dockManager, &DockManager::dockWidgetSplit, this, [this](const QString &name, const QString &target, Qt::Orientation orientation) {
+        Event event;
+        event.operation = SessionTrace::Split;
+        event.name = name;
+        event.target = target;
+        event.value = int(orientation);
+        record(event);
+    });
+    connect(dockManager, &DockManager::dockWidgetTabified, this, [this](const QString &name, const QString &target) {
+        Event event;
+        event.operation = SessionTrace::Tab;
+        event.name = name;
+        event.target = target;
+        record(event);
+    });
+    connect(dockManager, &DockManager::dockWidgetFloated, this, [this](const QString &name, bool floating, const QPoint &position) {
+        Event event;
+        event.operation = SessionTrace::Float;
+        event.name = name;
+        event.flag = floating;
+        event.position = position;
+        record(event);
+    });
+    connect(dockManager, &DockManager::dockWidgetResized, this, [this](const QString &name, const QSize &size) {
+        Event event;
+        event.operation = SessionTrace::Resize;
+        event.name = name;
+        event.size = size;
+        record(event);
+    });
+    connect(dockManager, &DockManager::dockWidgetVisibilityChanged, this, [this](const QString &name, bool visible) {
+        Event event;
+        event.operation = SessionTrace::Visible;
+        event.name = name;
+        event.flag = visible;
+        record(event);
+    });
+
+    LayoutManager *layoutManager = workspace->layoutManager();
+    connect(layoutManager, &LayoutManager::layoutAboutToLoad, this, [this]() { m_loading = true; });
+    connect(layoutManager, &LayoutManager::layoutFailed, this, [this]() { m_loading = false; });
+    connect(layoutManager, &LayoutManager::layoutLoaded, this, [this](const QString &fileName) {
+        m_loading = false;
+        recordPresetLoad(fileName);
+    });
+    connect(layoutManager, &LayoutManager::layoutSaved, this, [this](const QString &fileName) {
+        Event event;
+        event.operation = SessionTrace::SavePreset;
+        event.name = fileName;
+        record(event);
+    });
+}
+
+void SessionRecorder::recordPresetLoad(const QString &fileName)
+{
+    SessionTrace::Event event;
+    event.operation = SessionTrace::LoadPreset;
+    event.name = fileName;
+    record(event);
+}
+
+bool SessionRecorder::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_workspace.data() && event->type() == QEvent::Resize && m_clock.isValid())
+        m_settleUntilUs = m_clock.nsecsElapsed() / 1000 + kSettleUs;
+    return QObject::eventFilter(watched, event);
+}
+
+// Only what the user did is kept: the resizes a layout change causes
+// follow from replaying the change itself
+void SessionRecorder::record(SessionTrace::Event event)
+{
+    if (!m_file.isOpen())
+        return;
+    if (m_loading && event.operation != SessionTrace::LoadPreset)
+        return;
+
+    event.timeUs = m_clock.nsecsElapsed() / 1000;
+    if (event.operation == SessionTrace::Resize) {
+        if (event.timeUs < m_settleUntilUs)
+            return;
+    } else {
+        m_settleUntilUs = event.timeUs + kSettleUs;
+    }
+
+    // Splitting or tabbing a dock also reports it as placed in its new
+    // area first; the split or tab alone is what the user asked for
+    if (m_hasPendingPlace) {
+        const bool superseded = (event.operation == SessionTrace::Split || event.operation == SessionTrace::Tab)
+                                && event.name == m_pendingPlace.name;
+        if (superseded)
+            m_hasPendingPlace = false;
+        else
+            commitPendingPlace();
+    }
+    if (event.operation == SessionTrace::Place) {
+        m_pendingPlace = event;
+        m_hasPendingPlace = true;
+        QTimer::singleShot(0, this, &SessionRecorder::commitPendingPlace);
+        return;
+    }
+    write(event);
+}
+
+void SessionRecorder::commitPendingPlace()
+{
+    if (!m_hasPendingPlace)
+        return;
+    m_hasPendingPlace = false;
+    write(m_pendingPlace);
+}
+
+void SessionRecorder::write(const SessionTrace::Event &event)
+{
+    SessionTrace::encode(event, m_previousUs, &m_strings, &m_buffer);
+    m_previousUs = event.timeUs;
+    ++m_eventCount;
+    if (m_buffer.size() >= kFlushBytes)
+        flush();
+}
@@ -0,0 +1,104 @@
+#ifndef SESSIONTRACE_H
+#define SESSIONTRACE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QPoint>
+#include <QPointer>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+
+class Workspace;
+
+// Compact binary trace of dock operations. After a short header every
+// event is an opcode byte, the time since the previous event and its
+// arguments, all as varints. Dock and file names go through a string table
+// so each is spelled out only the first time it appears.
+class SessionTrace
+{
+public:
+    enum Operation : quint8 {
+        Place = 1,
+        Split,
+        Tab,
+        Float,
+        Resize,
+        Visible,
+        LoadPreset,
+        SavePreset
+    };
+
+    struct Event
+    {
+        Operation operation = Place;
+        qint64 timeUs = 0; // since the recording started
+        QString name;      // dock, or preset file for LoadPreset/SavePreset
+        QString target;
+        int value = 0;     // dock area or split orientation
+        bool flag = false;
+        QPoint position;
+        QSize size;
+    };
+
+    static const int kVersion = 1;
+
+    static QByteArray header();
+    // Appends one event; strings holds the table built so far
+    static void encode(const Event &event, qint64 previousUs, QHash<QString, int> *strings, QByteArray *out);
+    static bool read(const QString &fileName, QVector<Event> *events, QString *errorString);
+    static QString operationName(Operation operation);
+};
+
+// Records what happens to the docks of one workspace into a trace file.
+// Dock signals fired while a layout is being applied are not recorded; the
+// preset load itself stands for them. Neither are the resizes that follow
+// a structural change or a window resize, nor the placement reported
+// along with a split or a tab.
+class SessionRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SessionRecorder(QObject *parent = nullptr);
+    ~SessionRecorder();
+
+    bool start(const QString &fileName);
+    void stop();
+    bool isRecording() const { return m_file.isOpen(); }
+    int eventCount() const { return m_eventCount; }
+
+    void setWorkspace(Workspace *workspace);
+    // For preset switches that swap workspaces instead of loading into one
+    void recordPresetLoad(const QString &fileName);
+
+    // --record=<file>
+    static bool requested(const QStringList &arguments, QString *fileName);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void record(SessionTrace::Event event);
+    void commitPendingPlace();
+    void write(const SessionTrace::Event &event);
+    void flush();
+
+    QFile m_file;
+    QByteArray m_buffer;
+    QHash<QString, int> m_strings;
+    QElapsedTimer m_clock;
+    QTimer m_flushTimer;
+    QPointer<Workspace> m_workspace;
+    qint64 m_previousUs = 0;
+    int m_eventCount = 0;
+    bool m_loading = false;
+    qint64 m_settleUntilUs = 0;
+    // Held until the event loop turns, in case a split or tab follows
+    SessionTrace::Event m_pendingPlace;
+    bool m_hasPendingPlace = false;
+};
+
+#endif // SESSIONTRACE_H
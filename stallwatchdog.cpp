@@ -0,0 +1,235 @@
+#include "stallwatchdog.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+const qint64 StallWatchdog::kBucketBoundsUs[kBucketCount] = {
+    250, 500, 1000, 2000, 4000, 8000, 16000, 33000,
+    50000, 100000, 250000, 500000, 1000000, 2500000, 5000000,
+    std::numeric_limits<qint64>::max()
+};
+
+std::atomic<const char*> StallWatchdog::s_currentOperation { nullptr };
+
+StallWatchdog::Scope::Scope(const char *operation)
+    : m_previous(s_currentOperation.exchange(operation))
+{
+}
+
+StallWatchdog::Scope::~Scope()
+{
+    s_currentOperation.store(m_previous);
+}
+
+StallWatchdog::StallWatchdog(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    stop();
+}
+
+StallWatchdog *StallWatchdog::instance()
+{
+    static StallWatchdog *watchdog = new StallWatchdog(QCoreApplication::instance());
+    return watchdog;
+}
+
+void StallWatchdog::start(int thresholdMs, int probeIntervalMs)
+{
+    if (m_running.load())
+        return;
+    m_thresholdUs = qint64(thresholdMs) * 1000;
+    m_probeIntervalMs = qMax(1, probeIntervalMs);
+    m_probePending = false;
+    m_running = true;
+
+    m_thread = QThread::create([this]() { probeLoop(); });
+    m_thread->setObjectName("StallWatchdog");
+    m_thread->start(QThread::HighPriority);
+
+    // The helper thread posts to this object, so it has to be stopped
+    // before the event loop and the application go away
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+            this, &StallWatchdog::stop, Qt::UniqueConnection);
+}
+
+void StallWatchdog::stop()
+{
+    if (!m_thread)
+        return;
+    m_running = false;
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+// Helper thread: at most one probe is in flight. While it waits longer
+// than the threshold, the GUI thread's current scope is the one to blame.
+void StallWatchdog::probeLoop()
+{
+    while (m_running.load()) {
+        QThread::msleep(m_probeIntervalMs);
+        const qint64 now = m_clock.nsecsElapsed();
+        if (!m_probePending.load()) {
+            m_stallOperation = nullptr;
+            m_probeSentNs = now;
+            m_probePending = true;
+            QMetaObject::invokeMethod(this, &StallWatchdog::answerProbe, Qt::QueuedConnection);
+        } else if (!m_stallOperation.load() && now - m_probeSentNs.load() > m_thresholdUs * 1000) {
+            const char *operation = s_currentOperation.load();
+            m_stallOperation = operation ? operation : "(unscoped)";
+        }
+    }
+}
+
+void StallWatchdog::answerProbe()
+{
+    const qint64 latencyUs = (m_clock.nsecsElapsed() - m_probeSentNs.load()) / 1000;
+    const char *operation = m_stallOperation.exchange(nullptr);
+    m_probePending = false;
+    record(latencyUs);
+
+    if (latencyUs < m_thresholdUs)
+        return;
+    if (!operation)
+        operation = s_currentOperation.load() ? s_currentOperation.load() : "(unscoped)";
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_stalls.size() == kMaxStalls)
+            m_stalls.removeFirst();
+        m_stalls.append({ latencyUs, operation });
+    }
+    qWarning().noquote() << QString("GUI thread stalled for %1 ms in %2")
+                                .arg(latencyUs / 1000.0, 0, 'f', 1).arg(operation);
+    emit stallDetected(latencyUs, QString::fromLatin1(operation));
+}
+
+void StallWatchdog::record(qint64 latencyUs)
+{
+    QMutexLocker locker(&m_mutex);
+    int bucket = 0;
+    while (latencyUs > kBucketBoundsUs[bucket])
+        ++bucket;
+    ++m_buckets[bucket];
+    ++m_samples;
+    m_maxUs = qMax(m_maxUs, latencyUs);
+}
+
+qint64 StallWatchdog::sampleCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return qint64(m_samples);
+}
+
+qint64 StallWatchdog::percentileLocked(double fraction) const
+{
+    if (m_samples == 0)
+        return 0;
+    const quint64 rank = quint64(qMax(1.0, fraction * m_samples));
+    quint64 seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank)
+            return qMin(kBucketBoundsUs[i], m_maxUs);
+    }
+    return m_maxUs;
+}
+
+qint64 StallWatchdog::percentileUs(double fraction) const
+{
+    QMutexLocker locker(&m_mutex);
+    return percentileLocked(fraction);
+}
+
+qint64 StallWatchdog::maxUs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxUs;
+}
+
+QVector<StallWatchdog::Stall> StallWatchdog::stalls() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stalls;
+}
+
+void StallWatchdog::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    std::fill(std::begin(m_buckets), std::end(m_buckets), 0);
+    m_samples = 0;
+    m_maxUs = 0;
+    m_stalls.clear();
+}
+
+QString StallWatchdog::report() const
+{
+    QMutexLocker locker(&m_mutex);
+    QString result = QString::asprintf("event-loop latency: %llu probes, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                                       m_samples, percentileLocked(0.5) / 1000.0,
+                                       percentileLocked(0.99) / 1000.0, m_maxUs / 1000.0);
+    for (int i = 0; i < kBucketCount; ++i) {
+        if (m_buckets[i] == 0)
+            continue;
+        const QString bound = i == kBucketCount - 1 ? QString("longer")
+                                                    : QString("<= %1 ms").arg(kBucketBoundsUs[i] / 1000.0);
+        result += QString::asprintf("  %-14s %8llu\n", qPrintable(bound), m_buckets[i]);
+    }
+    result += QString("stalls over %1 ms: %2\n").arg(m_thresholdUs / 1000).arg(m_stalls.size());
+    for (const Stall &stall : m_stalls)
+        result += QString::asprintf("  %10.1f ms  %s\n", stall.durationUs / 1000.0, stall.operation);
+    return result;
+}
+
+QJsonObject StallWatchdog::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonArray histogram;
+    for (int i = 0; i < kBucketCount; ++i) {
+        QJsonObject bucket{ { "count", qint64(m_buckets[i]) } };
+        if (i < kBucketCount - 1)
+            bucket.insert("upToUs", kBucketBoundsUs[i]);
+        histogram.append(bucket);
+    }
+    QJsonArray stallArray;
+    for (const Stall &stall : m_stalls)
+        stallArray.append(QJsonObject{ { "durationUs", stall.durationUs }, { "operation", stall.operation } });
+
+    return QJsonObject{
+        { "thresholdUs", m_thresholdUs },
+        { "probeIntervalMs", m_probeIntervalMs },
+        { "samples", qint64(m_samples) },
+        { "p50Us", percentileLocked(0.5) },
+        { "p99Us", percentileLocked(0.99) },
+        { "maxUs", m_maxUs },
+        { "histogram", histogram },
+        { "stalls", stallArray }
+    };
+}
+
+bool StallWatchdog::requested(const QStringList &arguments, QString *fileName, int *thresholdMs)
+{
+    bool report = false;
+    for (const QString &argument : arguments) {
+        if (argument == "--stall-report") {
+            report = true;
+            fileName->clear();
+        } else if (argument.startsWith("--stall-report=")) {
+            report = true;
+            *fileName = argument.mid(15);
+        } else if (argument.startsWith("--stall-threshold=")) {
+            *thresholdMs = argument.mid(18).toInt();
+        }
+    }
+    return report;
+}
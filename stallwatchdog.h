@@ -0,0 +1,96 @@
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+#include <QStringList>
+#include <atomic>
+
+class QJsonObject;
+class QThread;
+
+// Measures GUI event-loop latency from a helper thread. Every few
+// milliseconds the helper posts a probe to the GUI thread and times how
+// long it waits to run. Latencies go into a histogram; probes slower than
+// the threshold are recorded as stalls together with the operation scope
+// that was active when the threshold was crossed.
+class StallWatchdog : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stall
+    {
+        qint64 durationUs;
+        const char *operation;
+    };
+
+    // Marks a GUI-thread operation for stall attribution. The name must be
+    // a string literal; scopes nest.
+    class Scope
+    {
+    public:
+        explicit Scope(const char *operation);
+        ~Scope();
+
+    private:
+        const char *m_previous;
+    };
+
+    static StallWatchdog *instance();
+    ~StallWatchdog();
+
+    void start(int thresholdMs = 50, int probeIntervalMs = 10);
+    void stop();
+    bool isRunning() const { return m_running.load(); }
+    int thresholdMs() const { return m_thresholdUs / 1000; }
+
+    qint64 sampleCount() const;
+    // Latency below which the given fraction of probes ran, from the
+    // histogram bucket bounds
+    qint64 percentileUs(double fraction) const;
+    qint64 maxUs() const;
+    QVector<Stall> stalls() const;
+    void reset();
+
+    QString report() const;
+    QJsonObject toJson() const;
+
+    // --stall-report[=file], --stall-threshold=ms
+    static bool requested(const QStringList &arguments, QString *fileName, int *thresholdMs);
+
+signals:
+    void stallDetected(qint64 durationUs, const QString &operation);
+
+private:
+    explicit StallWatchdog(QObject *parent = nullptr);
+    void probeLoop();
+    void answerProbe();
+    void record(qint64 latencyUs);
+    qint64 percentileLocked(double fraction) const;
+
+    static const int kBucketCount = 16;
+    static const qint64 kBucketBoundsUs[kBucketCount];
+    static const int kMaxStalls = 256;
+
+    QThread *m_thread = nullptr;
+    QElapsedTimer m_clock;
+    std::atomic<bool> m_running { false };
+    std::atomic<bool> m_probePending { false };
+    std::atomic<qint64> m_probeSentNs { 0 };
+    std::atomic<const char*> m_stallOperation { nullptr };
+    qint64 m_thresholdUs = 50000;
+    int m_probeIntervalMs = 10;
+
+    mutable QMutex m_mutex;
+    quint64 m_buckets[kBucketCount] = {};
+    quint64 m_samples = 0;
+    qint64 m_maxUs = 0;
+    QVector<Stall> m_stalls;
+
+    static std::atomic<const char*> s_currentOperation;
+};
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,101 @@
+#include "startupprofiler.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QTextStream>
+#include <QTimer>
+#include <QWidget>
+#include <cstring>
+
+static QElapsedTimer s_clock;
+static StartupProfiler *s_instance = nullptr;
+
+StartupProfiler::StartupProfiler(QObject *parent)
+    : QObject(parent)
+{
+}
+
+StartupProfiler *StartupProfiler::instance()
+{
+    if (!s_instance)
+        s_instance = new StartupProfiler(QCoreApplication::instance());
+    return s_instance;
+}
+
+// Marks taken before a restart would be measured against the old clock
+void StartupProfiler::begin()
+{
+    s_clock.start();
+    if (s_instance) {
+        s_instance->m_phases.clear();
+        s_instance->m_firstFrameSeen = false;
+        s_instance->m_settled = false;
+    }
+}
+
+bool StartupProfiler::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--startup-benchmark") == 0)
+            return true;
+    }
+    return false;
+}
+
+void StartupProfiler::mark(const char *phase)
+{
+    if (!s_clock.isValid())
+        s_clock.start();
+    m_phases.append(qMakePair(phase, s_clock.nsecsElapsed()));
+}
+
+void StartupProfiler::watchWindow(QWidget *window)
+{
+    m_window = window;
+    window->installEventFilter(this);
+}
+
+bool StartupProfiler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_window && event->type() == QEvent::Paint && !m_firstFrameSeen) {
+        m_firstFrameSeen = true;
+        // The filter runs before the window paints; the frame is done once
+        // the event has been delivered, so mark it from the event loop.
+        QTimer::singleShot(0, this, [this]() {
+            mark("first-frame");
+            emit firstFrame();
+            // Anything still queued (deferred layout passes, resize
+            // cascades) runs before this timer, so it marks the first
+            // frame nothing else changes.
+            QTimer::singleShot(0, this, &StartupProfiler::markSettled);
+        });
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void StartupProfiler::markSettled()
+{
+    if (m_settled)
+        return;
+    m_settled = true;
+    mark("settled");
+    if (m_window)
+        m_window->removeEventFilter(this);
+    emit settled();
+
+    if (m_exitWhenSettled) {
+        QTextStream(stdout) << report();
+        QCoreApplication::exit(0);
+    }
+}
+
+QString StartupProfiler::report() const
+{
+    QString result = QString::asprintf("%-24s %10s %10s\n", "phase", "at(ms)", "delta(ms)");
+    qint64 previous = 0;
+    for (const auto &phase : m_phases) {
+        result += QString::asprintf("%-24s %10.2f %10.2f\n", phase.first,
+                                    phase.second / 1e6, (phase.second - previous) / 1e6);
+        previous = phase.second;
+    }
+    return result;
+}
@@ -0,0 +1,49 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QPair>
+
+class QWidget;
+
+// Records the time of each startup phase up to the first settled frame.
+// With --startup-benchmark the phases are printed and the application
+// quits once the main window has settled.
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static StartupProfiler *instance();
+
+    // Call first thing in main(); everything is measured from here
+    static void begin();
+    static bool requested(int argc, char *argv[]);
+
+    void mark(const char *phase);
+    void watchWindow(QWidget *window);
+    void setExitWhenSettled(bool exit) { m_exitWhenSettled = exit; }
+    bool isSettled() const { return m_settled; }
+    QString report() const;
+
+signals:
+    void firstFrame();
+    void settled();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit StartupProfiler(QObject *parent = nullptr);
+    void markSettled();
+
+    QVector<QPair<const char*, qint64>> m_phases;
+    QWidget *m_window = nullptr;
+    bool m_firstFrameSeen = false;
+    bool m_settled = false;
+    bool m_exitWhenSettled = false;
+};
+
+#endif // STARTUPPROFILER_H
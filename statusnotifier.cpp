@@ -0,0 +1,93 @@
+#include "statusnotifier.h"
+#include <QLabel>
+#include <QMainWindow>
+#include <QProgressBar>
+#include <QStatusBar>
+#include <QToolButton>
+
+static const int kMessageTimeoutMs = 5000;
+static const int kErrorTimeoutMs = 15000;
+static const int kProgressDelayMs = 250;
+
+StatusNotifier::StatusNotifier(QMainWindow *parent)
+    : QObject(parent)
+{
+    QStatusBar *statusBar = parent->statusBar();
+
+    m_messageLabel = new QLabel(statusBar);
+    m_messageLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    statusBar->addWidget(m_messageLabel, 1);
+
+    m_progressBar = new QProgressBar(statusBar);
+    m_progressBar->setMaximumWidth(160);
+    m_progressBar->setTextVisible(false);
+    m_progressBar->hide();
+    statusBar->addPermanentWidget(m_progressBar);
+
+    m_cancelButton = new QToolButton(statusBar);
+    m_cancelButton->setText(tr("Cancel"));
+    m_cancelButton->setAutoRaise(true);
+    m_cancelButton->hide();
+    statusBar->addPermanentWidget(m_cancelButton);
+    connect(m_cancelButton, &QToolButton::clicked, this, &StatusNotifier::cancelRequested);
+
+    m_clearTimer.setSingleShot(true);
+    connect(&m_clearTimer, &QTimer::timeout, m_messageLabel, &QLabel::clear);
+
+    m_progressDelay.setSingleShot(true);
+    m_progressDelay.setInterval(kProgressDelayMs);
+    connect(&m_progressDelay, &QTimer::timeout, this, &StatusNotifier::showProgressArea);
+}
+
+void StatusNotifier::showMessage(const QString &text, Kind kind)
+{
+    QPalette palette = m_messageLabel->parentWidget()->palette();
+    if (kind == Error)
+        palette.setColor(QPalette::WindowText, QColor("#B00020"));
+    else if (kind == Success)
+        palette.setColor(QPalette::WindowText, QColor("#1B5E20"));
+    m_messageLabel->setPalette(palette);
+    m_messageLabel->setText(text);
+    m_messageLabel->setToolTip(text);
+
+    // A running operation keeps its message until it ends
+    if (m_busy && kind == Info)
+        m_clearTimer.stop();
+    else
+        m_clearTimer.start(kind == Error ? kErrorTimeoutMs : kMessageTimeoutMs);
+}
+
+void StatusNotifier::beginProgress(const QString &text)
+{
+    m_busy = true;
+    m_progressBar->setRange(0, 0);
+    showMessage(text, Info);
+    m_progressDelay.start();
+}
+
+void StatusNotifier::setProgress(qint64 done, qint64 total)
+{
+    if (!m_busy)
+        return;
+    // QProgressBar takes int, so report per mille
+    if (total > 0) {
+        m_progressBar->setRange(0, 1000);
+        m_progressBar->setValue(int(done * 1000 / total));
+    }
+}
+
+void StatusNotifier::endProgress()
+{
+    m_busy = false;
+    m_progressDelay.stop();
+    m_progressBar->hide();
+    m_cancelButton->hide();
+}
+
+void StatusNotifier::showProgressArea()
+{
+    if (!m_busy)
+        return;
+    m_progressBar->show();
+    m_cancelButton->show();
+}
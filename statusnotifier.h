@@ -0,0 +1,46 @@
+#ifndef STATUSNOTIFIER_H
+#define STATUSNOTIFIER_H
+
+#include <QObject>
+#include <QTimer>
+
+class QLabel;
+class QMainWindow;
+class QProgressBar;
+class QToolButton;
+
+// Non-modal notifications in the main window's status bar: a message that
+// clears itself after a while and a progress area with a cancel button.
+// Progress only appears if the operation is still running after a short
+// delay, so fast operations never flash it.
+class StatusNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind { Info, Success, Error };
+
+    explicit StatusNotifier(QMainWindow *parent);
+
+    void showMessage(const QString &text, Kind kind = Info);
+
+    void beginProgress(const QString &text);
+    void setProgress(qint64 done, qint64 total);
+    void endProgress();
+    bool isBusy() const { return m_busy; }
+
+signals:
+    void cancelRequested();
+
+private:
+    void showProgressArea();
+
+    QLabel *m_messageLabel;
+    QProgressBar *m_progressBar;
+    QToolButton *m_cancelButton;
+    QTimer m_clearTimer;
+    QTimer m_progressDelay;
+    bool m_busy = false;
+};
+
+#endif // STATUSNOTIFIER_H
@@ -0,0 +1,310 @@
+#include "syncselftest.h"
+#include "dockmanager.h"
+#include "floatingoverlay.h"
+#include "layoutsync.h"
+#include "workspace.h"
+#include <QAction>
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QTimer>
+#include <QDebug>
+
+static const int kTimeoutMs = 30000;
+static const int kPollIntervalMs = 100;
+static const int kOperationIntervalMs = 2;
+
+static QString argumentValue(const QStringList &arguments, const QString &prefix, const QString &fallback = QString())
+{
+    for (const QString &argument : arguments) {
+        if (argument.startsWith(prefix))
+            return argument.mid(prefix.size());
+    }
+    return fallback;
+}
+
+SyncSelfTest::SyncSelfTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SyncSelfTest::~SyncSelfTest()
+{
+    for (Peer &peer : m_peers) {
+        if (peer.process && peer.process->state() != QProcess::NotRunning) {
+            peer.process->kill();
+            peer.process->waitForFinished(1000);
+        }
+    }
+}
+
+bool SyncSelfTest::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--sync-selftest") == 0)
+            return true;
+    }
+    return false;
+}
+
+bool SyncSelfTest::peerRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrncmp(argv[i], "--sync-selftest-peer=", 21) == 0)
+            return true;
+    }
+    return false;
+}
+
+int SyncSelfTest::run(const QStringList &arguments)
+{
+    const int peerCount = qMax(2, argumentValue(arguments, "--sync-peers=", "4").toInt());
+    m_deltasPerPeer = qMax(1, argumentValue(arguments, "--sync-deltas=", "200").toInt());
+    m_serverName = QString("MainWindows-sync-selftest-%1").arg(QCoreApplication::applicationPid());
+
+    m_control = new QLocalServer(this);
+    if (!m_control->listen(m_serverName + "-control")) {
+        QTextStream(stderr) << "Cannot listen for peers: " << m_control->errorString() << '\n';
+        return 1;
+    }
+    connect(m_control, &QLocalServer::newConnection, this, &SyncSelfTest::acceptControl);
+
+    QTextStream out(stdout);
+    out << "Layout sync self-test: " << peerCount << " peers, "
+        << m_deltasPerPeer << " changes each\n";
+    out.flush();
+
+    QEventLoop loop;
+    QElapsedTimer timer;
+    QElapsedTimer syncTimer;
+    bool started = false;
+    int stablePolls = 0;
+
+    m_peers.resize(peerCount);
+    // The first peer is started alone so it deterministically becomes the hub
+    startPeer(0);
+
+    QTimer poll;
+    poll.setInterval(kPollIntervalMs);
+    connect(&poll, &QTimer::timeout, this, [&]() {
+        if (timer.elapsed() > kTimeoutMs) {
+            out << "FAIL: timed out\n";
+            for (int i = 0; i < m_peers.size(); ++i) {
+                const Peer &peer = m_peers.at(i);
+                out << QString::asprintf("  peer %d: ready=%d done=%d sent=%llu applied=%llu digest=%s\n",
+                                         i, peer.ready, peer.done, peer.sent, peer.applied,
+                                         peer.digest.constData());
+            }
+            loop.exit(1);
+            return;
+        }
+
+        if (!started) {
+            if (m_peers.first().ready && !m_peers.last().process) {
+                for (int i = 1; i < m_peers.size(); ++i)
+                    startPeer(i);
+            }
+            for (const Peer &peer : qAsConst(m_peers)) {
+                if (!peer.ready)
+                    return;
+            }
+            started = true;
+            syncTimer.start();
+            broadcast("go\n");
+            return;
+        }
+
+        // Two polls in a row guard against a delta sitting in a batch
+        stablePolls = converged() ? stablePolls + 1 : 0;
+        if (stablePolls >= 2) {
+            const qint64 elapsedMs = qMax<qint64>(1, syncTimer.elapsed());
+            quint64 total = 0;
+            for (const Peer &peer : qAsConst(m_peers))
+                total += peer.sent;
+            out << QString::asprintf("PASS: %llu deltas converged on %d peers in %lld ms (%.0f deltas/s, digest %s)\n",
+                                     total, m_peers.size(), elapsedMs, total * 1000.0 / elapsedMs,
+                                     m_peers.first().digest.constData());
+            broadcast("quit\n");
+            loop.exit(0);
+            return;
+        }
+        broadcast("status\n");
+    });
+    timer.start();
+    poll.start();
+
+    const int result = loop.exec();
+    poll.stop();
+    for (Peer &peer : m_peers) {
+        if (peer.process)
+            peer.process->waitForFinished(2000);
+    }
+    return result;
+}
+
+void SyncSelfTest::startPeer(int index)
+{
+    Peer &peer = m_peers[index];
+    peer.process = new QProcess(this);
+    peer.process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    peer.process->start(QCoreApplication::applicationFilePath(), {
+        QString("--sync-selftest-peer=%1").arg(index),
+        "--sync-server=" + m_serverName,
+        QString("--sync-deltas=%1").arg(m_deltasPerPeer)
+    });
+}
+
+void SyncSelfTest::acceptControl()
+{
+    while (QLocalSocket *socket = m_control->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readControl(socket); });
+    }
+}
+
+void SyncSelfTest::readControl(QLocalSocket *socket)
+{
+    QByteArray buffer = socket->property("buffer").toByteArray() + socket->readAll();
+    int index = socket->property("peer").isValid() ? socket->property("peer").toInt() : -1;
+
+    int newline;
+    while ((newline = buffer.indexOf('\n')) >= 0) {
+        const QList<QByteArray> fields = buffer.left(newline).split(' ');
+        buffer.remove(0, newline + 1);
+
+        if (fields.first() == "hello" && fields.size() == 2) {
+            index = fields.at(1).toInt();
+            if (index < 0 || index >= m_peers.size())
+                continue;
+            socket->setProperty("peer", index);
+            m_peers[index].control = socket;
+        } else if (index < 0) {
+            continue;
+        } else if (fields.first() == "ready") {
+            m_peers[index].ready = true;
+        } else if (fields.first() == "status" && fields.size() == 5) {
+            Peer &peer = m_peers[index];
+            peer.done = fields.at(1) == "1";
+            peer.sent = fields.at(2).toULongLong();
+            peer.applied = fields.at(3).toULongLong();
+            peer.digest = fields.at(4);
+        }
+    }
+    socket->setProperty("buffer", buffer);
+}
+
+void SyncSelfTest::broadcast(const QByteArray &line)
+{
+    for (const Peer &peer : qAsConst(m_peers)) {
+        if (peer.control)
+            peer.control->write(line);
+    }
+}
+
+bool SyncSelfTest::converged() const
+{
+    quint64 total = 0;
+    for (const Peer &peer : m_peers) {
+        if (!peer.done)
+            return false;
+        total += peer.sent;
+    }
+    for (const Peer &peer : m_peers) {
+        if (peer.applied != total || peer.digest != m_peers.first().digest)
+            return false;
+    }
+    return true;
+}
+
+// Peer process: one workspace kept in sync, driven over the control socket.
+int SyncSelfTest::runPeer(const QStringList &arguments)
+{
+    const int index = argumentValue(arguments, "--sync-selftest-peer=").toInt();
+    const QString serverName = argumentValue(arguments, "--sync-server=");
+    const int deltas = argumentValue(arguments, "--sync-deltas=", "200").toInt();
+
+    QLocalSocket control;
+    control.connectToServer(serverName + "-control");
+    if (!control.waitForConnected(2000)) {
+        qWarning() << "Sync peer" << index << "cannot reach the coordinator";
+        return 1;
+    }
+    control.write(QString("hello %1\n").arg(index).toUtf8());
+
+    Workspace workspace;
+    workspace.resize(1000, 700);
+    workspace.show();
+    const QList<QDockWidget*> docks = workspace.dockManager()->allDockWidgets();
+
+    LayoutSync sync(serverName);
+    sync.setWorkspace(&workspace);
+    QObject::connect(&sync, &LayoutSync::joined, &control, [&control]() { control.write("ready\n"); });
+
+    QRandomGenerator random(quint32(index) * 7919 + 1);
+    int operations = 0;
+    QTimer driver;
+    driver.setInterval(kOperationIntervalMs);
+    QObject::connect(&driver, &QTimer::timeout, &workspace, [&]() {
+        if (operations++ >= deltas) {
+            driver.stop();
+            return;
+        }
+        QDockWidget *dock = docks.at(random.bounded(docks.size()));
+        static const Qt::DockWidgetArea areas[] = {
+            Qt::LeftDockWidgetArea, Qt::RightDockWidgetArea, Qt::TopDockWidgetArea, Qt::BottomDockWidgetArea
+        };
+        switch (random.bounded(5)) {
+        case 0:
+            workspace.addDockWidget(areas[random.bounded(4)], dock);
+            break;
+        case 1:
+            FloatingOverlay::setFloating(dock, !FloatingOverlay::isFloating(dock));
+            break;
+        case 2: {
+            QDockWidget *target = docks.at(random.bounded(docks.size()));
+            if (target != dock && !FloatingOverlay::isFloating(target))
+                workspace.tabifyDockWidget(target, dock);
+            break;
+        }
+        case 3:
+            workspace.resizeDocks({ dock }, { 80 + int(random.bounded(200)) }, Qt::Horizontal);
+            break;
+        default:
+            dock->toggleViewAction()->trigger();
+            break;
+        }
+    });
+
+    QByteArray buffer;
+    QObject::connect(&control, &QLocalSocket::readyRead, &workspace, [&]() {
+        buffer += control.readAll();
+        int newline;
+        while ((newline = buffer.indexOf('\n')) >= 0) {
+            const QByteArray line = buffer.left(newline);
+            buffer.remove(0, newline + 1);
+            if (line == "go") {
+                driver.start();
+            } else if (line == "status") {
+                const bool done = operations > deltas;
+                control.write(QString("status %1 %2 %3 %4\n")
+                                  .arg(done ? 1 : 0)
+                                  .arg(sync.deltasSent())
+                                  .arg(sync.deltasApplied())
+                                  .arg(QString::fromLatin1(sync.digest()))
+                                  .toUtf8());
+            } else if (line == "quit") {
+                QCoreApplication::exit(0);
+            }
+        }
+    });
+    QObject::connect(&control, &QLocalSocket::disconnected, qApp, []() { QCoreApplication::exit(1); });
+
+    sync.start();
+    return QApplication::exec();
+}
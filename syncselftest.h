@@ -0,0 +1,58 @@
+#ifndef SYNCSELFTEST_H
+#define SYNCSELFTEST_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QLocalServer;
+class QLocalSocket;
+class QProcess;
+
+// Multi-process check for LayoutSync. --sync-selftest starts N peer
+// processes (offscreen, one Workspace each) that join the same sync server
+// and each make K random dock changes at once. The coordinator polls them
+// over a control socket until every peer has applied every delta and all
+// layout digests agree, then prints the throughput.
+class SyncSelfTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyncSelfTest(QObject *parent = nullptr);
+    ~SyncSelfTest();
+
+    // Checked before any application object exists: the coordinator needs
+    // no display and the peers must select the offscreen platform.
+    static bool requested(int argc, char *argv[]);
+    static bool peerRequested(int argc, char *argv[]);
+
+    int run(const QStringList &arguments);
+    static int runPeer(const QStringList &arguments);
+
+private:
+    struct Peer
+    {
+        QProcess *process = nullptr;
+        QLocalSocket *control = nullptr;
+        QByteArray buffer;
+        bool ready = false;
+        bool done = false;
+        quint64 sent = 0;
+        quint64 applied = 0;
+        QByteArray digest;
+    };
+
+    void startPeer(int index);
+    void acceptControl();
+    void readControl(QLocalSocket *socket);
+    void broadcast(const QByteArray &line);
+    bool converged() const;
+
+    QLocalServer *m_control = nullptr;
+    QVector<Peer> m_peers;
+    QString m_serverName;
+    int m_deltasPerPeer = 200;
+};
+
+#endif // SYNCSELFTEST_H
@@ -0,0 +1,305 @@
+#include "textsearch.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QStringView>
+#include <QThread>
+#include <atomic>
+#include <climits>
+#include <cstring>
+
+// Big enough to keep the queue short, small enough that results stream
+// and a canceled search stops within a chunk
+static const qint64 kChunkBytes = 4 * 1024 * 1024;
+// Cancellation and truncation are checked between blocks of a chunk
+static const qint64 kBlockBytes = 256 * 1024;
+
+struct TextSearch::Job
+{
+    ~Job()
+    {
+        if (data)
+            file.unmap(const_cast<uchar*>(data));
+    }
+
+    // Mapped pages past the end of a truncated file raise SIGBUS when
+    // read, so a scan checks the file still reaches the end of its chunk.
+    // Truncating between the check and the read is still possible, but
+    // only within one block. QFile is not thread-safe, hence the lock.
+    bool reaches(qint64 end)
+    {
+        QMutexLocker locker(&fileLock);
+        return file.size() >= end;
+    }
+
+    bool isStopped(qint64 end)
+    {
+        return canceled.load(std::memory_order_relaxed) || !reaches(end);
+    }
+
+    // Reserves a place among the reported matches
+    bool reserveReport()
+    {
+        return reported.load(std::memory_order_relaxed) < kMaxReportedMatches
+               && reported.fetch_add(1, std::memory_order_relaxed) < kMaxReportedMatches;
+    }
+
+    QMutex fileLock;
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    QByteArray literal;
+    QRegularExpression regex;
+    bool useRegex = false;
+    bool caseSensitive = false;
+    std::atomic<bool> canceled{false};
+    std::atomic<int> reported{0};
+    // Only touched on the thread that owns the TextSearch
+    int remaining = 0;
+    qint64 found = 0;
+    QElapsedTimer timer;
+};
+
+static inline uchar foldAscii(uchar c)
+{
+    return c >= 'A' && c <= 'Z' ? uchar(c + 32) : c;
+}
+
+static bool isAscii(const QString &text)
+{
+    for (QChar c : text) {
+        if (c.unicode() > 0x7f)
+            return false;
+    }
+    return true;
+}
+
+// Next position in [from, to) holding either byte, memchr doing the
+// scanning. Each cursor is rescanned only once it has been passed.
+static qint64 findEither(const uchar *data, qint64 from, qint64 to, uchar a, uchar b, qint64 &nextA, qint64 &nextB)
+{
+    auto next = [&](qint64 &cursor, uchar byte) {
+        if (cursor < from) {
+            const void *found = std::memchr(data + from, byte, size_t(to - from));
+            cursor = found ? static_cast<const uchar*>(found) - data : to;
+        }
+    };
+    next(nextA, a);
+    if (a != b)
+        next(nextB, b);
+    else
+        nextB = nextA;
+    return qMin(nextA, nextB);
+}
+
+void TextSearch::scanLiteral(Job &job, qint64 begin, qint64 end, QVector<Match> &matches, qint64 &found)
+{
+    const uchar *data = job.data;
+    const uchar *pattern = reinterpret_cast<const uchar*>(job.literal.constData());
+    const int length = job.literal.size();
+    const uchar first = pattern[0];
+    const uchar firstUpper = job.caseSensitive || first < 'a' || first > 'z' ? first : uchar(first - 32);
+    qint64 position = begin;
+    const qint64 lastStart = end - length;
+    while (position <= lastStart) {
+        if (job.isStopped(end))
+            return;
+        const qint64 blockEnd = qMin(lastStart + 1, position + kBlockBytes);
+        qint64 nextLower = -1;
+        qint64 nextUpper = -1;
+        while (position < blockEnd) {
+            const qint64 candidate = findEither(data, position, blockEnd, first, firstUpper, nextLower, nextUpper);
+            if (candidate >= blockEnd) {
+                position = blockEnd;
+                break;
+            }
+            bool equal;
+            if (job.caseSensitive) {
+                equal = std::memcmp(data + candidate + 1, pattern + 1, size_t(length - 1)) == 0;
+            } else {
+                equal = true;
+                for (int i = 1; i < length && equal; ++i)
+                    equal = foldAscii(data[candidate + i]) == pattern[i];
+            }
+            if (equal) {
+                ++found;
+                if (job.reserveReport())
+                    matches.append({ candidate, length });
+                position = candidate + length;
+            } else {
+                position = candidate + 1;
+            }
+        }
+    }
+}
+
+void TextSearch::scanRegex(Job &job, qint64 begin, qint64 end, QVector<Match> &matches, qint64 &found)
+{
+    qint64 lineStart = begin;
+    qint64 nextCheck = begin;
+    while (lineStart < end) {
+        if (job.canceled.load(std::memory_order_relaxed))
+            return;
+        if (lineStart >= nextCheck) {
+            if (!job.reaches(end))
+                return;
+            nextCheck = lineStart + kBlockBytes;
+        }
+        const void *newline = std::memchr(job.data + lineStart, '\n', size_t(end - lineStart));
+        const qint64 lineEnd = newline ? static_cast<const uchar*>(newline) - job.data : end;
+        const int bytes = int(qMin<qint64>(lineEnd - lineStart, INT_MAX));
+        const QString line = QString::fromUtf8(reinterpret_cast<const char*>(job.data + lineStart), bytes);
+        // Offsets are UTF-16 positions; they are bytes too unless the line has multibyte text
+        const bool sameOffsets = line.size() == bytes;
+
+        QRegularExpressionMatchIterator it = job.regex.globalMatch(line);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0)
+                continue;
+            ++found;
+            if (!job.reserveReport())
+                continue;
+            if (sameOffsets) {
+                matches.append({ lineStart + match.capturedStart(), match.capturedLength() });
+            } else {
+                const QStringView view(line);
+                const qint64 offset = view.left(match.capturedStart()).toUtf8().size();
+                const int length = view.mid(match.capturedStart(), match.capturedLength()).toUtf8().size();
+                matches.append({ lineStart + offset, length });
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+TextSearch::TextSearch(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+TextSearch::~TextSearch()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool TextSearch::start(const QString &fileName, const QString &pattern, Options options)
+{
+    cancel();
+    if (pattern.isEmpty()) {
+        m_errorString = tr("Nothing to search for");
+        return false;
+    }
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->caseSensitive = options.testFlag(CaseSensitive);
+    // A case-insensitive literal with non-ASCII text needs Unicode case
+    // folding, which the regex engine has
+    job->useRegex = options.testFlag(RegularExpression) || (!job->caseSensitive && !isAscii(pattern));
+    if (job->useRegex) {
+        const QString expression = options.testFlag(RegularExpression) ? pattern : QRegularExpression::escape(pattern);
+        job->regex.setPattern(expression);
+        job->regex.setPatternOptions(job->caseSensitive ? QRegularExpression::NoPatternOption
+                                                        : QRegularExpression::CaseInsensitiveOption);
+        if (!job->regex.isValid()) {
+            m_errorString = tr("Invalid regular expression: %1").arg(job->regex.errorString());
+            return false;
+        }
+        job->regex.optimize();
+    } else {
+        if (pattern.contains(QLatin1Char('\n'))) {
+            m_errorString = tr("Search text cannot span lines");
+            return false;
+        }
+        job->literal = job->caseSensitive ? pattern.toUtf8() : pattern.toLower().toUtf8();
+    }
+
+    job->file.setFileName(fileName);
+    if (!job->file.open(QIODevice::ReadOnly)) {
+        m_errorString = tr("Cannot open %1: %2").arg(fileName, job->file.errorString());
+        return false;
+    }
+    job->size = job->file.size();
+    if (job->size > 0) {
+        job->data = job->file.map(0, job->size);
+        if (!job->data) {
+            m_errorString = tr("Cannot map %1: %2").arg(fileName, job->file.errorString());
+            return false;
+        }
+    }
+    m_errorString.clear();
+    job->timer.start();
+    m_job = job;
+
+    if (job->size == 0) {
+        job->remaining = 1;
+        QMetaObject::invokeMethod(this, [this, job]() { chunkDone(job, QVector<Match>(), 0); }, Qt::QueuedConnection);
+        return true;
+    }
+
+    // Chunks end after a newline so no match is split between two of them
+    QVector<QPair<qint64, qint64>> chunks;
+    for (qint64 begin = 0; begin < job->size;) {
+        qint64 end = qMin(job->size, begin + kChunkBytes);
+        if (end < job->size) {
+            const void *newline = std::memchr(job->data + end, '\n', size_t(job->size - end));
+            end = newline ? static_cast<const uchar*>(newline) - job->data + 1 : job->size;
+        }
+        chunks.append(qMakePair(begin, end));
+        begin = end;
+    }
+    job->remaining = chunks.size();
+    for (const QPair<qint64, qint64> &chunk : qAsConst(chunks)) {
+        const qint64 begin = chunk.first;
+        const qint64 end = chunk.second;
+        m_pool.start([this, job, begin, end]() { scanChunk(job, begin, end); });
+    }
+    return true;
+}
+
+void TextSearch::cancel()
+{
+    if (!m_job)
+        return;
+    m_job->canceled = true;
+    m_job.reset();
+    // Chunks not started yet are dropped; running ones stop at their next block
+    m_pool.clear();
+}
+
+// Runs on a pool thread
+void TextSearch::scanChunk(const std::shared_ptr<Job> &job, qint64 begin, qint64 end)
+{
+    if (job->canceled)
+        return;
+    QVector<Match> matches;
+    qint64 found = 0;
+    if (job->useRegex)
+        scanRegex(*job, begin, end, matches, found);
+    else
+        scanLiteral(*job, begin, end, matches, found);
+    if (job->canceled)
+        return;
+    QMetaObject::invokeMethod(this, [this, job, matches, found]() {
+        chunkDone(job, matches, found);
+    }, Qt::QueuedConnection);
+}
+
+void TextSearch::chunkDone(const std::shared_ptr<Job> &job, const QVector<Match> &matches, qint64 found)
+{
+    // Results of a canceled search can still be queued
+    if (job != m_job)
+        return;
+    job->found += found;
+    if (!matches.isEmpty())
+        emit matchesFound(matches);
+    if (--job->remaining > 0)
+        return;
+
+    const qint64 elapsedUs = qMax<qint64>(1, job->timer.nsecsElapsed() / 1000);
+    m_job.reset();
+    emit finished(job->found, job->size, elapsedUs);
+}
@@ -0,0 +1,72 @@
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+
+// Finds a pattern in a file on worker threads. The file is mapped once
+// when the search starts and only the bytes it had then are searched, so
+// text appended later is not seen. The mapping is not a copy, though:
+// text rewritten in place during the search may or may not be seen, and
+// a file truncated during it ends the search early, since reading past
+// the new end would crash. The mapped range is split into line-aligned
+// chunks, each scanned by one pool thread, and every chunk's matches are
+// reported as soon as it is done, so chunks may arrive out of order.
+// Literal patterns are found with memchr and memcmp, which libc
+// vectorizes; regular expressions are matched a line at a time. Starting
+// a search cancels the one running. Offsets are bytes into the file.
+class TextSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Match
+    {
+        qint64 offset = 0;
+        int length = 0;
+    };
+
+    enum Option {
+        NoOptions = 0x0,
+        CaseSensitive = 0x1,
+        RegularExpression = 0x2
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    explicit TextSearch(QObject *parent = nullptr);
+    ~TextSearch();
+
+    bool start(const QString &fileName, const QString &pattern, Options options = NoOptions);
+    void cancel();
+    bool isRunning() const { return m_job != nullptr; }
+    QString errorString() const { return m_errorString; }
+
+    // Defaults to the ideal thread count
+    void setMaxThreadCount(int count) { m_pool.setMaxThreadCount(qMax(1, count)); }
+    int maxThreadCount() const { return m_pool.maxThreadCount(); }
+
+    // Matches past this many are counted but not reported
+    static const int kMaxReportedMatches = 1 << 20;
+
+signals:
+    void matchesFound(const QVector<TextSearch::Match> &matches);
+    void finished(qint64 matchCount, qint64 bytes, qint64 elapsedUs);
+
+private:
+    struct Job;
+
+    static void scanLiteral(Job &job, qint64 begin, qint64 end, QVector<Match> &matches, qint64 &found);
+    static void scanRegex(Job &job, qint64 begin, qint64 end, QVector<Match> &matches, qint64 &found);
+    void scanChunk(const std::shared_ptr<Job> &job, qint64 begin, qint64 end);
+    void chunkDone(const std::shared_ptr<Job> &job, const QVector<Match> &matches, qint64 found);
+
+    QThreadPool m_pool;
+    std::shared_ptr<Job> m_job;
+    QString m_errorString;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(TextSearch::Options)
+
+#endif // TEXTSEARCH_H
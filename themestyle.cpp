@@ -0,0 +1,150 @@
+#include "themestyle.h"
+#include <QApplication>
+#include <QPainter>
+#include <QStyleOption>
+#include <QWidget>
+
+static const char *const kThemeRoleProperty = "themeRole";
+
+// Metrics and colors of the former layout toolbar style sheet
+static const int kToolBarSpacing = 5;
+static const int kToolBarPadding = 3;
+static const int kButtonPadding = 6;
+static const int kButtonMargin = 2;
+static const int kButtonBorder = 1;
+static const int kButtonMinWidth = 80;
+static const qreal kButtonRadius = 3.0;
+
+static const QColor kToolBarBackground(0xf0, 0xf0, 0xf0);
+static const QColor kToolBarBorder(0xcc, 0xcc, 0xcc);
+static const QColor kButtonBackground(0xe0, 0xe0, 0xe0);
+static const QColor kButtonHover(0xd0, 0xd0, 0xd0);
+static const QColor kButtonPressed(0xc0, 0xc0, 0xc0);
+static const QColor kButtonBorderColor(0xaa, 0xaa, 0xaa);
+
+static ThemeStyle *sharedStyle()
+{
+    static ThemeStyle *style = nullptr;
+    if (!style) {
+        style = new ThemeStyle;
+        style->setParent(qApp);
+    }
+    return style;
+}
+
+ThemeStyle::ThemeStyle(QStyle *baseStyle)
+    : QProxyStyle(baseStyle)
+{
+}
+
+void ThemeStyle::apply(QWidget *widget, Role role)
+{
+    widget->setProperty(kThemeRoleProperty, int(role));
+    if (role == ToolBarButton)
+        widget->setAttribute(Qt::WA_Hover);
+
+    // Without the theme installed application-wide the widget gets the
+    // shared instance, so opting in works either way.
+    if (!qobject_cast<ThemeStyle*>(widget->style()))
+        widget->setStyle(sharedStyle());
+}
+
+ThemeStyle::Role ThemeStyle::role(const QWidget *widget)
+{
+    if (!widget)
+        return NoRole;
+    return Role(widget->property(kThemeRoleProperty).toInt());
+}
+
+void ThemeStyle::polish(QWidget *widget)
+{
+    QProxyStyle::polish(widget);
+    if (role(widget) == ToolBarButton)
+        widget->setAttribute(Qt::WA_Hover);
+}
+
+void ThemeStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option,
+                               QPainter *painter, const QWidget *widget) const
+{
+    if (element == PE_PanelButtonCommand && role(widget) == ToolBarButton) {
+        QColor background = kButtonBackground;
+        if (option->state & (State_Sunken | State_On))
+            background = kButtonPressed;
+        else if (option->state & State_MouseOver)
+            background = kButtonHover;
+
+        const QRectF r = QRectF(option->rect.adjusted(kButtonMargin, kButtonMargin,
+                                                      -kButtonMargin, -kButtonMargin))
+                             .adjusted(0.5, 0.5, -0.5, -0.5);
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(QPen(kButtonBorderColor, kButtonBorder));
+        painter->setBrush(background);
+        painter->drawRoundedRect(r, kButtonRadius, kButtonRadius);
+        painter->restore();
+        return;
+    }
+    if (element == PE_PanelToolBar && role(widget) == LayoutToolBar)
+        return; // drawn in CE_ToolBar
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void ThemeStyle::drawControl(ControlElement element, const QStyleOption *option,
+                             QPainter *painter, const QWidget *widget) const
+{
+    if (element == CE_ToolBar && role(widget) == LayoutToolBar) {
+        const QRect r = option->rect;
+        painter->fillRect(r, kToolBarBackground);
+        painter->setPen(kToolBarBorder);
+        painter->drawLine(r.topLeft(), r.topRight());
+        painter->drawLine(r.bottomLeft(), r.bottomRight());
+        return;
+    }
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
+
+int ThemeStyle::pixelMetric(PixelMetric metric, const QStyleOption *option, const QWidget *widget) const
+{
+    switch (role(widget)) {
+    case LayoutToolBar:
+        if (metric == PM_ToolBarItemSpacing)
+            return kToolBarSpacing;
+        if (metric == PM_ToolBarFrameWidth)
+            return kToolBarPadding;
+        break;
+    case ToolBarButton:
+        if (metric == PM_DefaultFrameWidth)
+            return kButtonBorder;
+        if (metric == PM_ButtonShiftHorizontal || metric == PM_ButtonShiftVertical)
+            return 0;
+        break;
+    default:
+        break;
+    }
+    return QProxyStyle::pixelMetric(metric, option, widget);
+}
+
+QSize ThemeStyle::sizeFromContents(ContentsType type, const QStyleOption *option,
+                                   const QSize &contentsSize, const QWidget *widget) const
+{
+    if (type == CT_PushButton && role(widget) == ToolBarButton) {
+        const int frame = kButtonPadding + kButtonBorder + kButtonMargin;
+        QSize result = contentsSize + QSize(2 * frame, 2 * frame);
+        result.setWidth(qMax(result.width(), kButtonMinWidth + 2 * frame));
+        return result;
+    }
+    return QProxyStyle::sizeFromContents(type, option, contentsSize, widget);
+}
+
+QRect ThemeStyle::subElementRect(SubElement element, const QStyleOption *option, const QWidget *widget) const
+{
+    if (element == SE_PushButtonContents && role(widget) == ToolBarButton) {
+        const int frame = kButtonPadding + kButtonBorder + kButtonMargin;
+        return option->rect.adjusted(frame, frame, -frame, -frame);
+    }
+    if (element == SE_PushButtonFocusRect && role(widget) == ToolBarButton) {
+        const int inset = kButtonMargin + kButtonBorder + 1;
+        return option->rect.adjusted(inset, inset, -inset, -inset);
+    }
+    return QProxyStyle::subElementRect(element, option, widget);
+}
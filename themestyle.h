@@ -0,0 +1,39 @@
+#ifndef THEMESTYLE_H
+#define THEMESTYLE_H
+
+#include <QProxyStyle>
+
+// Native-style theme for the application chrome. Widgets opt in with
+// apply(); everything else is drawn by the base style untouched. This
+// replaces per-widget style sheets, which pull widgets into
+// QStyleSheetStyle and re-resolve CSS on every state change.
+class ThemeStyle : public QProxyStyle
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        NoRole,
+        LayoutToolBar,
+        ToolBarButton
+    };
+
+    explicit ThemeStyle(QStyle *baseStyle = nullptr);
+
+    static void apply(QWidget *widget, Role role);
+    static Role role(const QWidget *widget);
+
+    void polish(QWidget *widget) override;
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option,
+                       QPainter *painter, const QWidget *widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption *option,
+                     QPainter *painter, const QWidget *widget = nullptr) const override;
+    int pixelMetric(PixelMetric metric, const QStyleOption *option = nullptr,
+                    const QWidget *widget = nullptr) const override;
+    QSize sizeFromContents(ContentsType type, const QStyleOption *option,
+                           const QSize &contentsSize, const QWidget *widget = nullptr) const override;
+    QRect subElementRect(SubElement element, const QStyleOption *option,
+                         const QWidget *widget = nullptr) const override;
+};
+
+#endif // THEMESTYLE_H
@@ -0,0 +1,134 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <QtGlobal>
+#include <atomic>
+
+class TripleBufferBase;
+
+// Told on the producer thread when a frame arrives while none is waiting,
+// so a consumer can sleep until there is something to read instead of
+// polling. That is at most once per frame the consumer takes, and never
+// while an unread frame sits in the buffer.
+class TripleBufferListener
+{
+public:
+    virtual ~TripleBufferListener() = default;
+    virtual void framePublished(TripleBufferBase *buffer) = 0;
+};
+
+// Index bookkeeping and counters shared by every TripleBuffer<T>. One
+// producer thread publishes, the GUI thread consumes; neither ever waits
+// on the other. The three slots rotate through one atomic word holding the
+// index of the middle slot and a flag saying it holds an unread frame.
+class TripleBufferBase
+{
+public:
+    // Consumer side: true when a frame newer than current() is waiting
+    bool hasNewFrame() const { return m_state.load(std::memory_order_acquire) & kNewFrame; }
+
+    // Frames published, and frames overwritten before the consumer read them
+    quint64 publishedCount() const { return m_published.load(std::memory_order_relaxed); }
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    // Frames that arrived between the repaint being scheduled and the paint
+    // that read them, so they shared that one repaint
+    quint64 coalescedCount() const { return m_coalesced.load(std::memory_order_relaxed); }
+    quint64 consumedCount() const { return m_consumed.load(std::memory_order_relaxed); }
+
+    // Consumer side. A listener must stay alive until it has been replaced
+    // and the producer is past any publish() that started before.
+    void setListener(TripleBufferListener *listener) { m_listener.store(listener, std::memory_order_release); }
+
+    // Consumer side: a repaint was requested for the waiting frame
+    void markScheduled()
+    {
+        if (!m_scheduled) {
+            m_scheduled = true;
+            m_publishedAtSchedule = publishedCount();
+        }
+    }
+
+protected:
+    static const int kNewFrame = 4;
+
+    // Hands the written back slot over and returns the slot to write next
+    int swapBack(int back)
+    {
+        const int previous = m_state.exchange(back | kNewFrame, std::memory_order_acq_rel);
+        m_published.fetch_add(1, std::memory_order_relaxed);
+        if (previous & kNewFrame) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        } else if (TripleBufferListener *listener = m_listener.load(std::memory_order_acquire)) {
+            listener->framePublished(this);
+        }
+        return previous & 3;
+    }
+
+    // Takes the newest frame if there is one; returns the slot to read
+    int swapFront(int front)
+    {
+        if (!(m_state.load(std::memory_order_relaxed) & kNewFrame))
+            return front;
+        const int previous = m_state.exchange(front, std::memory_order_acq_rel);
+        m_consumed.fetch_add(1, std::memory_order_relaxed);
+        if (m_scheduled) {
+            m_scheduled = false;
+            // The frame that triggered the repaint is not counted
+            const quint64 later = publishedCount() - m_publishedAtSchedule;
+            if (later > 1)
+                m_coalesced.fetch_add(later - 1, std::memory_order_relaxed);
+        }
+        return previous & 3;
+    }
+
+private:
+    std::atomic<int> m_state { 1 };
+    std::atomic<TripleBufferListener*> m_listener { nullptr };
+    std::atomic<quint64> m_published { 0 };
+    std::atomic<quint64> m_dropped { 0 };
+    std::atomic<quint64> m_coalesced { 0 };
+    std::atomic<quint64> m_consumed { 0 };
+    // Consumer thread only
+    bool m_scheduled = false;
+    quint64 m_publishedAtSchedule = 0;
+};
+
+// Lock-free triple buffer for handing frames from one producer thread to
+// the GUI thread. The producer fills writeSlot() and calls publish(); the
+// consumer calls update() and reads current(), always the newest frame.
+// Frames live in three preallocated slots, so neither side allocates as
+// long as T itself does not.
+template <typename T>
+class TripleBuffer : public TripleBufferBase
+{
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T &initial) : m_slots { initial, initial, initial } {}
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Producer side
+    T &writeSlot() { return m_slots[m_back]; }
+    void publish() { m_back = swapBack(m_back); }
+    void publish(const T &frame)
+    {
+        m_slots[m_back] = frame;
+        publish();
+    }
+
+    // Consumer side; returns true when current() changed
+    bool update()
+    {
+        const int previous = m_front;
+        m_front = swapFront(m_front);
+        return m_front != previous;
+    }
+    const T &current() const { return m_slots[m_front]; }
+
+private:
+    T m_slots[3];
+    int m_back = 0;   // producer thread only
+    int m_front = 2;  // consumer thread only
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,279 @@
+#include "widgetstate.h"
+#include "layoutwriter.h"
+#include <QColor>
+#include <QDebug>
+#include <QMetaEnum>
+#include <QObject>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QXmlStreamReader>
+
+std::unordered_map<const QMetaObject*, WidgetState::Table> WidgetState::s_tables;
+
+static QStringList classInfoList(const QMetaObject *metaObject, const char *name)
+{
+    const int index = metaObject->indexOfClassInfo(name);
+    if (index < 0)
+        return QStringList();
+    QStringList values = QString::fromLatin1(metaObject->classInfo(index).value()).split(',', Qt::SkipEmptyParts);
+    for (QString &value : values)
+        value = value.trimmed();
+    return values;
+}
+
+static QVector<int> splitNumbers(const QString &text, int count)
+{
+    const QStringList parts = text.split(',');
+    QVector<int> numbers;
+    if (parts.size() != count)
+        return numbers;
+    for (const QString &part : parts) {
+        bool ok = false;
+        numbers.append(part.toInt(&ok));
+        if (!ok)
+            return QVector<int>();
+    }
+    return numbers;
+}
+
+const WidgetState::Table &WidgetState::tableFor(const QMetaObject *metaObject)
+{
+    auto it = s_tables.find(metaObject);
+    if (it == s_tables.end())
+        it = s_tables.emplace(metaObject, buildTable(metaObject)).first;
+    return it->second;
+}
+
+WidgetState::Table WidgetState::buildTable(const QMetaObject *metaObject)
+{
+    Table table;
+    const QStringList excluded = classInfoList(metaObject, "StateExclude");
+    if (excluded.contains("*"))
+        return table;
+    const QStringList included = classInfoList(metaObject, "StateInclude");
+    const QStringList bases = classInfoList(metaObject, "StateBase");
+
+    // Properties of the base and its ancestors come first in the index range
+    int firstOwn = metaObject->propertyOffset();
+    if (!bases.isEmpty()) {
+        for (const QMetaObject *base = metaObject; base; base = base->superClass()) {
+            if (bases.first() == QLatin1String(base->className())) {
+                firstOwn = base->propertyCount();
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty meta = metaObject->property(i);
+        const QString name = QString::fromLatin1(meta.name());
+        if (i < firstOwn && !included.contains(name))
+            continue;
+        if (excluded.contains(name) || !meta.isReadable() || !meta.isWritable() || !meta.isStored())
+            continue;
+
+        Property property;
+        property.meta = meta;
+        property.name = name;
+        if (meta.isFlagType()) {
+            property.encoding = Flags;
+        } else if (meta.isEnumType()) {
+            property.encoding = Enum;
+        } else {
+            switch (meta.userType()) {
+            case QMetaType::Bool: property.encoding = Bool; break;
+            case QMetaType::Int:
+            case QMetaType::UInt:
+            case QMetaType::LongLong:
+            case QMetaType::ULongLong: property.encoding = Int; break;
+            case QMetaType::Double:
+            case QMetaType::Float: property.encoding = Double; break;
+            case QMetaType::QSize: property.encoding = Size; break;
+            case QMetaType::QPoint: property.encoding = Point; break;
+            case QMetaType::QRect: property.encoding = Rect; break;
+            case QMetaType::QColor: property.encoding = Color; break;
+            case QMetaType::QStringList: property.encoding = StringList; break;
+            default: property.encoding = Text;
+            }
+        }
+        table.byName.insert(name, table.properties.size());
+        table.properties.append(property);
+    }
+    return table;
+}
+
+// Straight into the writer's buffer: no temporary strings for numbers,
+// sizes, colors or enum keys
+void WidgetState::write(LayoutWriter &writer, const Property &property, const QVariant &value)
+{
+    switch (property.encoding) {
+    case Bool:
+        writer.writeLatin1(value.toBool() ? "true" : "false", value.toBool() ? 4 : 5);
+        return;
+    case Int:
+        writer.writeNumber(value.toLongLong());
+        return;
+    case Double:
+        writer.writeDouble(value.toDouble());
+        return;
+    case Size: {
+        const QSize size = value.toSize();
+        writer.writeNumber(size.width());
+        writer.writeLatin1(",", 1);
+        writer.writeNumber(size.height());
+        return;
+    }
+    case Point: {
+        const QPoint point = value.toPoint();
+        writer.writeNumber(point.x());
+        writer.writeLatin1(",", 1);
+        writer.writeNumber(point.y());
+        return;
+    }
+    case Rect: {
+        const QRect rect = value.toRect();
+        writer.writeNumber(rect.x());
+        writer.writeLatin1(",", 1);
+        writer.writeNumber(rect.y());
+        writer.writeLatin1(",", 1);
+        writer.writeNumber(rect.width());
+        writer.writeLatin1(",", 1);
+        writer.writeNumber(rect.height());
+        return;
+    }
+    case Color: {
+        static const char digits[] = "0123456789abcdef";
+        const QRgb rgba = value.value<QColor>().rgba();
+        char hex[9] = { '#' };
+        for (int i = 0; i < 8; ++i)
+            hex[1 + i] = digits[(rgba >> (28 - 4 * i)) & 0xf];
+        writer.writeLatin1(hex, 9);
+        return;
+    }
+    case StringList: {
+        const QStringList list = value.toStringList();
+        for (int i = 0; i < list.size(); ++i) {
+            if (i > 0)
+                writer.writeLatin1("\n", 1);
+            writer.writeCharacters(list.at(i));
+        }
+        return;
+    }
+    case Enum: {
+        const char *key = property.meta.enumerator().valueToKey(value.toInt());
+        if (key)
+            writer.writeLatin1(key, int(qstrlen(key)));
+        return;
+    }
+    case Flags: {
+        // valueToKeys builds a QByteArray, so flags properties do allocate
+        const QByteArray keys = property.meta.enumerator().valueToKeys(value.toInt());
+        writer.writeLatin1(keys.constData(), keys.size());
+        return;
+    }
+    case Text:
+        break;
+    }
+    writer.writeCharacters(value.toString());
+}
+
+QVariant WidgetState::decode(const Property &property, const QString &text)
+{
+    bool ok = true;
+    switch (property.encoding) {
+    case Bool:
+        return text == "true";
+    case Int: {
+        const qlonglong number = text.toLongLong(&ok);
+        return ok ? QVariant(number) : QVariant();
+    }
+    case Double: {
+        const double number = text.toDouble(&ok);
+        return ok ? QVariant(number) : QVariant();
+    }
+    case Size: {
+        const QVector<int> n = splitNumbers(text, 2);
+        return n.isEmpty() ? QVariant() : QVariant(QSize(n[0], n[1]));
+    }
+    case Point: {
+        const QVector<int> n = splitNumbers(text, 2);
+        return n.isEmpty() ? QVariant() : QVariant(QPoint(n[0], n[1]));
+    }
+    case Rect: {
+        const QVector<int> n = splitNumbers(text, 4);
+        return n.isEmpty() ? QVariant() : QVariant(QRect(n[0], n[1], n[2], n[3]));
+    }
+    case Color: {
+        const QColor color(text);
+        return color.isValid() ? QVariant(color) : QVariant();
+    }
+    case StringList:
+        return text.isEmpty() ? QStringList() : text.split('\n');
+    case Enum: {
+        const int value = property.meta.enumerator().keyToValue(text.toLatin1().constData(), &ok);
+        return ok ? QVariant(value) : QVariant();
+    }
+    case Flags: {
+        const int value = property.meta.enumerator().keysToValue(text.toLatin1().constData(), &ok);
+        return ok ? QVariant(value) : QVariant();
+    }
+    case Text:
+        break;
+    }
+    // QMetaProperty::write converts the string to the property's type
+    return text;
+}
+
+void WidgetState::save(LayoutWriter &writer, const QObject *object)
+{
+    if (!object)
+        return;
+    const Table &table = tableFor(object->metaObject());
+    for (const Property &property : table.properties) {
+        const QVariant value = property.meta.read(object);
+        if (!value.isValid())
+            continue;
+        writer.writeStartElement("Property");
+        writer.writeAttribute("name", property.name);
+        write(writer, property, value);
+        writer.writeEndElement();
+    }
+}
+
+bool WidgetState::load(QXmlStreamReader &xmlReader, QObject *object)
+{
+    const QString name = xmlReader.attributes().value("name").toString();
+    return restore(object, name, xmlReader.readElementText());
+}
+
+bool WidgetState::restore(QObject *object, const QString &name, const QString &text)
+{
+    if (!object)
+        return false;
+    const Table &table = tableFor(object->metaObject());
+    const int index = table.byName.value(name, -1);
+    if (index < 0)
+        return false;
+    const Property &property = table.properties.at(index);
+    const QVariant value = decode(property, text);
+    if (!value.isValid() || !property.meta.write(object, value)) {
+        qWarning().noquote() << QString("Cannot restore %1::%2 from \"%3\"")
+                                    .arg(object->metaObject()->className(), name, text);
+        return false;
+    }
+    return true;
+}
+
+QStringList WidgetState::propertyNames(const QMetaObject *metaObject)
+{
+    QStringList names;
+    for (const Property &property : tableFor(metaObject).properties)
+        names.append(property.name);
+    return names;
+}
+
+int WidgetState::cachedClassCount()
+{
+    return int(s_tables.size());
+}
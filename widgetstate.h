@@ -0,0 +1,67 @@
+#ifndef WIDGETSTATE_H
+#define WIDGETSTATE_H
+
+#include <QHash>
+#include <QMetaProperty>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <unordered_map>
+
+class QObject;
+class QXmlStreamReader;
+class LayoutWriter;
+
+// Saves and restores the stored, writable Q_PROPERTYs of dock content
+// widgets as <Property name="...">value</Property> elements. The list of
+// properties and how each one is encoded is worked out once per
+// QMetaObject and cached, so saving many widgets of one class costs no
+// metaobject lookups per call. The cache is only used from the GUI thread.
+//
+// By default only the properties a class declares itself are saved, so a
+// plugin widget deriving from QLabel or QTextEdit does not save what those
+// declare; inherited ones have to be allowed explicitly. A class adjusts
+// that with Q_CLASSINFO:
+//   "StateBase"     the deepest ancestor whose properties are skipped,
+//                   e.g. "QFrame"; everything declared below it is saved
+//   "StateInclude"  comma-separated properties to save even though they
+//                   come from a skipped ancestor
+//   "StateExclude"  comma-separated properties never to save, or "*" to
+//                   opt the class out entirely
+class WidgetState
+{
+public:
+    static void save(LayoutWriter &writer, const QObject *object);
+    // Reads one <Property> element; false if the object has no such property
+    static bool load(QXmlStreamReader &xmlReader, QObject *object);
+    static bool restore(QObject *object, const QString &name, const QString &text);
+
+    static QStringList propertyNames(const QMetaObject *metaObject);
+    static int cachedClassCount();
+
+private:
+    enum Encoding { Text, Bool, Int, Double, Size, Point, Rect, Color, StringList, Enum, Flags };
+
+    struct Property
+    {
+        QMetaProperty meta;
+        QString name;
+        Encoding encoding = Text;
+    };
+
+    struct Table
+    {
+        QVector<Property> properties;
+        QHash<QString, int> byName;
+    };
+
+    static const Table &tableFor(const QMetaObject *metaObject);
+    static Table buildTable(const QMetaObject *metaObject);
+    static void write(LayoutWriter &writer, const Property &property, const QVariant &value);
+    static QVariant decode(const Property &property, const QString &text);
+
+    // Node based, so references from tableFor() survive later insertions
+    static std::unordered_map<const QMetaObject*, Table> s_tables;
+};
+
+#endif // WIDGETSTATE_H
@@ -0,0 +1,73 @@
+#include "workspace.h"
+#include "dockmanager.h"
+#include "layoutmanager.h"
+#include "logview.h"
+#include "memoryaccounting.h"
+#include <QDockWidget>
+#include <QTextEdit>
+#include <QTextDocument>
+
+Workspace::Workspace(QWidget *parent)
+    : QMainWindow(parent, Qt::Widget)
+{
+    setObjectName("Workspace");
+    setDockNestingEnabled(true);
+
+    setupCentralWidget();
+
+    m_dockManager = new DockManager(this);
+    m_layoutManager = new LayoutManager(this);
+
+    // Connect layout manager signals to dock manager
+    connect(m_layoutManager, &LayoutManager::saveDockWidgetsLayoutRequested,
+            m_dockManager, &DockManager::saveDockWidgetsLayout);
+    connect(m_layoutManager, &LayoutManager::loadDockWidgetsLayoutRequested,
+            m_dockManager, &DockManager::loadDockWidgetsLayout);
+    connect(m_layoutManager, &LayoutManager::loadDockWidgetPropertiesRequested,
+            m_dockManager, &DockManager::loadDockWidgetProperties);
+    // The preset cache finds workspaces by this name, so it has to match
+    // what is actually shown, whichever menu the layout came from
+    connect(m_layoutManager, &LayoutManager::layoutLoaded, this, [this](const QString &fileName) {
+        m_presetFile = fileName;
+    });
+}
+
+Workspace::~Workspace()
+{
+    delete m_dockManager;
+    delete m_layoutManager;
+}
+
+void Workspace::setupCentralWidget()
+{
+    // A log of any size can be opened here; it is mapped, not loaded
+    LogView *center = new LogView(this);
+    center->setObjectName("LogView");
+    center->setMinimumSize(400, 205);
+    center->setPlaceholderText(tr("This is the central widget.\n\n"
+                                  "You can dock other widgets around this area.\n"
+                                  "Use the View menu to toggle dock widgets.\n"
+                                  "Layouts can be saved and loaded from the File menu.\n"
+                                  "Use the buttons below to quickly switch between layouts.\n"
+                                  "Open a log file from the File menu to view it here."));
+    setCentralWidget(center);
+}
+
+// An estimate, not a measurement: a fixed cost per object and widget plus
+// the text or line index held by the central widget. Docks are included
+// unless excluded.
+qint64 Workspace::estimatedBytes(bool includeDocks) const
+{
+    QList<const QObject*> exclude;
+    if (!includeDocks) {
+        for (const QDockWidget *dock : findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly))
+            exclude.append(dock);
+    }
+    qint64 bytes = MemoryAccounting::estimateObjectTree(objectName(), this, exclude).bytes;
+
+    if (QTextEdit *textEdit = qobject_cast<QTextEdit*>(centralWidget()))
+        bytes += qint64(textEdit->document()->characterCount()) * qint64(sizeof(QChar)) * 2;
+    else if (LogView *logView = qobject_cast<LogView*>(centralWidget()))
+        bytes += logView->indexBytes();
+    return bytes;
+}
@@ -0,0 +1,38 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <QMainWindow>
+
+class DockManager;
+class LayoutManager;
+
+// One complete dock arrangement: a QMainWindow embedded in the main window
+// with its own central widget, docks and layout manager. Several can be
+// kept alive so switching presets only swaps the visible one.
+class Workspace : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit Workspace(QWidget *parent = nullptr);
+    ~Workspace();
+
+    DockManager *dockManager() const { return m_dockManager; }
+    LayoutManager *layoutManager() const { return m_layoutManager; }
+
+    // Layout file (or "<library>#<layout>") last loaded into this
+    // workspace, empty if none; follows every successful load
+    QString presetFile() const { return m_presetFile; }
+    void setPresetFile(const QString &fileName) { m_presetFile = fileName; }
+
+    qint64 estimatedBytes(bool includeDocks = true) const;
+
+private:
+    void setupCentralWidget();
+
+    DockManager *m_dockManager;
+    LayoutManager *m_layoutManager;
+    QString m_presetFile;
+};
+
+#endif // WORKSPACE_H
@@ -0,0 +1,89 @@
+#include "workspacecache.h"
+#include "workspace.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcWorkspace, "mainwindows.workspace", QtWarningMsg)
+
+WorkspaceCache::WorkspaceCache(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void WorkspaceCache::setCapacity(int capacity)
+{
+    m_capacity = qMax(0, capacity);
+    evict();
+}
+
+Workspace *WorkspaceCache::acquire(const QString &presetFile)
+{
+    for (int i = 0; i < m_workspaces.size(); ++i) {
+        Workspace *workspace = m_workspaces.at(i);
+        if (workspace->presetFile() == presetFile) {
+            m_workspaces.move(i, 0);
+            return workspace;
+        }
+    }
+    return nullptr;
+}
+
+void WorkspaceCache::insert(Workspace *workspace)
+{
+    m_workspaces.removeAll(workspace);
+    m_workspaces.prepend(workspace);
+    evict();
+}
+
+void WorkspaceCache::discard(const QString &fileName, const Workspace *keep)
+{
+    // A Save As path is absolute, a preset name relative
+    const QFileInfo saved(fileName);
+    for (int i = m_workspaces.size() - 1; i >= 0; --i) {
+        Workspace *workspace = m_workspaces.at(i);
+        if (workspace == keep || workspace == m_current || QFileInfo(workspace->presetFile()) != saved)
+            continue;
+        m_workspaces.removeAt(i);
+        qCDebug(lcWorkspace) << "Discarding workspace" << workspace->presetFile() << "after the file was saved over";
+        emit workspaceEvicted(workspace);
+        workspace->deleteLater();
+    }
+}
+
+void WorkspaceCache::evict()
+{
+    // The visible workspace is never evicted, even if it is the oldest
+    for (int i = m_workspaces.size() - 1; i >= 0 && m_workspaces.size() > m_capacity; --i) {
+        Workspace *workspace = m_workspaces.at(i);
+        if (workspace == m_current)
+            continue;
+        m_workspaces.removeAt(i);
+        qCDebug(lcWorkspace) << "Evicting workspace" << workspace->presetFile()
+                             << "estimated" << workspace->estimatedBytes() / 1024 << "KiB";
+        emit workspaceEvicted(workspace);
+        workspace->deleteLater();
+    }
+}
+
+qint64 WorkspaceCache::estimatedBytes() const
+{
+    qint64 bytes = 0;
+    for (const Workspace *workspace : m_workspaces)
+        bytes += workspace->estimatedBytes();
+    return bytes;
+}
+
+QString WorkspaceCache::memoryReport() const
+{
+    QString report = QString("Workspaces: %1 of %2, ~%3 KiB\n")
+                         .arg(m_workspaces.size()).arg(m_capacity)
+                         .arg(estimatedBytes() / 1024);
+    for (const Workspace *workspace : m_workspaces) {
+        report += QString("  %1%2: ~%3 KiB\n")
+                      .arg(workspace->presetFile().isEmpty() ? QString("(unsaved)") : workspace->presetFile())
+                      .arg(workspace == m_current ? " [visible]" : "")
+                      .arg(workspace->estimatedBytes() / 1024);
+    }
+    return report;
+}
@@ -0,0 +1,44 @@
+#ifndef WORKSPACECACHE_H
+#define WORKSPACECACHE_H
+
+#include <QObject>
+#include <QList>
+
+class Workspace;
+
+// Keeps up to capacity() fully laid-out preset workspaces alive and evicts
+// the least recently used one when a new preset needs room.
+class WorkspaceCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WorkspaceCache(QObject *parent = nullptr);
+
+    int capacity() const { return m_capacity; }
+    void setCapacity(int capacity);
+
+    // Cached workspace for a preset, marked most recently used
+    Workspace *acquire(const QString &presetFile);
+    void insert(Workspace *workspace);
+    // Drops every cached workspace loaded from fileName except keep, once
+    // the file has been written over and their arrangement is stale
+    void discard(const QString &fileName, const Workspace *keep);
+    void setCurrent(Workspace *workspace) { m_current = workspace; }
+
+    QList<Workspace*> workspaces() const { return m_workspaces; }
+    qint64 estimatedBytes() const;
+    QString memoryReport() const;
+
+signals:
+    void workspaceEvicted(Workspace *workspace);
+
+private:
+    void evict();
+
+    QList<Workspace*> m_workspaces; // most recently used first
+    Workspace *m_current = nullptr;
+    int m_capacity = 0;
+};
+
+#endif // WORKSPACECACHE_H